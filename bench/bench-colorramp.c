@@ -0,0 +1,122 @@
+/* bench-colorramp.c -- Color ramp benchmarks
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "colorramp.h"
+
+/* Ramps are filled starting from a copy of the identity ramps, like
+   the adjustment methods do with the saved ramps. */
+typedef struct {
+	int size;
+	uint16_t *identity;
+	uint16_t *ramp;
+	float *identity_float;
+	float *ramp_float;
+} colorramp_bench_t;
+
+/* Vary the setting so every call does the full computation. */
+static void
+setting_for(unsigned long i, color_setting_t *setting)
+{
+	setting->temperature = 3000 + (i % 3500);
+	setting->gamma[0] = 0.8;
+	setting->gamma[1] = 0.9;
+	setting->gamma[2] = 1.0;
+	setting->brightness = 0.9;
+}
+
+static void
+run_fill(void *data, unsigned long iterations)
+{
+	colorramp_bench_t *b = data;
+	uint16_t *r = b->ramp;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		color_setting_t setting;
+		setting_for(i, &setting);
+		memcpy(r, b->identity, 3 * b->size * sizeof(uint16_t));
+		colorramp_fill(r, r + b->size, r + 2*b->size, b->size,
+			       &setting);
+	}
+
+	bench_sink += r[b->size - 1];
+}
+
+static void
+run_fill_float(void *data, unsigned long iterations)
+{
+	colorramp_bench_t *b = data;
+	float *r = b->ramp_float;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		color_setting_t setting;
+		setting_for(i, &setting);
+		memcpy(r, b->identity_float, 3 * b->size * sizeof(float));
+		colorramp_fill_float(r, r + b->size, r + 2*b->size, b->size,
+				     &setting);
+	}
+
+	bench_sink += r[b->size - 1];
+}
+
+void
+bench_colorramp(void)
+{
+	static const int sizes[] = { 256, 1024, 4096 };
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		colorramp_bench_t b;
+		b.size = sizes[i];
+		b.identity = malloc(3 * b.size * sizeof(uint16_t));
+		b.ramp = malloc(3 * b.size * sizeof(uint16_t));
+		b.identity_float = malloc(3 * b.size * sizeof(float));
+		b.ramp_float = malloc(3 * b.size * sizeof(float));
+		if (b.identity == NULL || b.ramp == NULL ||
+		    b.identity_float == NULL || b.ramp_float == NULL) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+
+		for (int j = 0; j < 3 * b.size; j++) {
+			int k = j % b.size;
+			b.identity[j] = (double)k / b.size * (UINT16_MAX+1);
+			b.identity_float[j] = (double)k / (b.size - 1);
+		}
+
+		/* Keep the work per size roughly constant. */
+		unsigned long iterations = 4096L * 256 / b.size;
+
+		char param[32];
+		snprintf(param, sizeof(param), "size=%i", b.size);
+		bench_run("colorramp_fill", param, run_fill, &b,
+			  iterations);
+		bench_run("colorramp_fill_float", param, run_fill_float, &b,
+			  iterations);
+
+		free(b.identity);
+		free(b.ramp);
+		free(b.identity_float);
+		free(b.ramp_float);
+	}
+}
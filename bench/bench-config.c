@@ -0,0 +1,128 @@
+/* bench-config.c -- Configuration file benchmarks
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "config-ini.h"
+
+typedef struct {
+	const char *path;
+	int sections;
+	int settings;
+	config_ini_state_t state;
+} config_bench_t;
+
+/* Write a config file with SECTIONS sections of SETTINGS settings
+   each, with comments and blank lines in between. */
+static int
+write_config(const char *path, int sections, int settings)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	for (int i = 0; i < sections; i++) {
+		fprintf(f, "; Section %i\n[section-%i]\n", i, i);
+		for (int j = 0; j < settings; j++) {
+			fprintf(f, "setting-%i = value %i.%i\n", j, i, j);
+		}
+		fputc('\n', f);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void
+run_init(void *data, unsigned long iterations)
+{
+	config_bench_t *b = data;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		config_ini_state_t state;
+		if (config_ini_init(&state, b->path) < 0) exit(EXIT_FAILURE);
+		bench_sink += state.sections != NULL;
+		config_ini_free(&state);
+	}
+}
+
+static void
+run_get_setting(void *data, unsigned long iterations)
+{
+	config_bench_t *b = data;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		char section[32];
+		char name[32];
+		snprintf(section, sizeof(section), "section-%lu",
+			 i % b->sections);
+		snprintf(name, sizeof(name), "setting-%lu",
+			 (i / b->sections) % b->settings);
+		bench_sink += config_ini_get_setting(&b->state, section,
+						     name) != NULL;
+	}
+}
+
+void
+bench_config(void)
+{
+	static const struct {
+		int sections;
+		int settings;
+		unsigned long iterations;
+	} sizes[] = {
+		{ 4, 8, 20000 },
+		{ 100, 100, 200 },
+		{ 1000, 100, 20 }
+	};
+
+	char *path = bench_temp_file("redshift-bench");
+	if (path == NULL) exit(EXIT_FAILURE);
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		config_bench_t b = { path, sizes[i].sections,
+				     sizes[i].settings };
+		if (write_config(path, b.sections, b.settings) < 0) {
+			unlink(path);
+			exit(EXIT_FAILURE);
+		}
+
+		char param[32];
+		snprintf(param, sizeof(param), "lines=%i",
+			 b.sections * (b.settings + 3));
+		bench_run("config_ini_init", param, run_init, &b,
+			  sizes[i].iterations);
+
+		if (config_ini_init(&b.state, path) < 0) {
+			unlink(path);
+			exit(EXIT_FAILURE);
+		}
+		bench_run("config_ini_get_setting", param, run_get_setting,
+			  &b, 1000000);
+		config_ini_free(&b.state);
+	}
+
+	unlink(path);
+	free(path);
+}
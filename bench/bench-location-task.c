@@ -0,0 +1,259 @@
+/* bench-location-task.c -- Concurrent location lookup benchmarks
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#include "bench.h"
+#include "config-ini.h"
+#include "location-task.h"
+
+/* Latency of a provider that does not answer before the deadline
+   (seconds). It returns eventually so abandoned probes finish. */
+#define MOCK_HANG  0.5
+
+#define MOCK_PROVIDERS_MAX  4
+
+/* Location provider that answers after a configurable latency, so the
+   lookup can be timed without D-Bus or network access. */
+typedef struct {
+	double latency;
+	int fail;
+} mock_state_t;
+
+typedef struct {
+	const char *param;
+	int count;
+	double latency[MOCK_PROVIDERS_MAX];
+	int fail[MOCK_PROVIDERS_MAX];
+	double timeout;
+	unsigned long iterations;
+} mock_scenario_t;
+
+typedef struct {
+	const mock_scenario_t *scenario;
+	config_ini_state_t config;
+} mock_run_t;
+
+/* Abandoned probes keep using their provider until they return, so
+   the providers outlive every lookup. */
+static location_provider_t mock_providers[MOCK_PROVIDERS_MAX];
+
+/* Providers started and not yet freed. */
+static int mock_active = 0;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t mock_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int
+mock_count(int delta)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&mock_mutex);
+#endif
+	mock_active += delta;
+	int active = mock_active;
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&mock_mutex);
+#endif
+	return active;
+}
+
+
+static int
+mock_init(mock_state_t *state)
+{
+	state->latency = 0.0;
+	state->fail = 0;
+	return 0;
+}
+
+static int
+mock_start(mock_state_t *state)
+{
+	mock_count(1);
+	return 0;
+}
+
+static void
+mock_free(mock_state_t *state)
+{
+	mock_count(-1);
+}
+
+static void
+mock_print_help(FILE *f)
+{
+}
+
+static int
+mock_set_option(mock_state_t *state, const char *key, const char *value)
+{
+	if (strcmp(key, "latency") == 0) {
+		state->latency = atof(value);
+	} else if (strcmp(key, "fail") == 0) {
+		state->fail = atoi(value);
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+mock_sleep(double seconds)
+{
+	struct timespec ts;
+	ts.tv_sec = (time_t)seconds;
+	ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+	while (nanosleep(&ts, &ts) < 0);
+}
+
+static int
+mock_get_location(mock_state_t *state, location_t *loc)
+{
+	mock_sleep(state->latency);
+	if (state->fail) return -1;
+
+	loc->lat = 55.7;
+	loc->lon = 12.6;
+	return 0;
+}
+
+static const location_provider_t mock_provider = {
+	NULL,
+	(location_provider_init_func *)mock_init,
+	(location_provider_start_func *)mock_start,
+	(location_provider_free_func *)mock_free,
+	(location_provider_print_help_func *)mock_print_help,
+	(location_provider_set_option_func *)mock_set_option,
+	(location_provider_get_location_func *)mock_get_location
+};
+
+/* Time from starting the lookup until a location is taken or the
+   lookup gives up, including abandoning the providers still running. */
+static void
+run_location_task(void *data, unsigned long iterations)
+{
+	mock_run_t *run = data;
+	const mock_scenario_t *scenario = run->scenario;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		location_task_t task;
+		int r = location_task_start(&task, mock_providers,
+					    scenario->count,
+					    sizeof(mock_state_t), 0, NULL,
+					    &run->config, 0,
+					    scenario->timeout, NULL, NULL);
+		if (r < 0) exit(EXIT_FAILURE);
+
+		location_t loc = { NAN, NAN };
+		if (location_task_wait(&task, &loc) == 0) {
+			bench_sink += loc.lat;
+		}
+		location_task_free(&task);
+	}
+}
+
+/* The latency of each provider is set in the configuration file like
+   the options of a real provider. */
+static int
+mock_run_init(mock_run_t *run, const mock_scenario_t *scenario,
+	      const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	run->scenario = scenario;
+	for (int i = 0; i < scenario->count; i++) {
+		double latency = scenario->latency[i] < 0.0 ?
+			MOCK_HANG : scenario->latency[i];
+		fprintf(f, "[%s]\nlatency=%f\nfail=%i\n",
+			mock_providers[i].name, latency, scenario->fail[i]);
+	}
+	fclose(f);
+
+	return config_ini_init(&run->config, path);
+}
+
+void
+bench_location_task(void)
+{
+	/* A negative latency means the provider hangs past the
+	   deadline. The first provider is the preferred one. */
+	static const mock_scenario_t scenarios[] = {
+		{ "providers=1,latency=0", 1, { 0.0 }, { 0 }, 1.0, 1000 },
+		{ "providers=1,latency=10ms", 1, { 0.01 }, { 0 }, 1.0, 50 },
+		{ "providers=2,latency=20ms+1ms", 2, { 0.02, 0.001 },
+		  { 0, 0 }, 1.0, 20 },
+		{ "providers=2,latency=fail5ms+1ms", 2, { 0.005, 0.001 },
+		  { 1, 0 }, 1.0, 50 },
+		{ "providers=2,latency=hang+1ms,timeout=50ms", 2,
+		  { -1.0, 0.001 }, { 0, 0 }, 0.05, 10 },
+		{ "providers=2,latency=hang+hang,timeout=50ms", 2,
+		  { -1.0, -1.0 }, { 0, 0 }, 0.05, 10 }
+	};
+
+	static char *names[MOCK_PROVIDERS_MAX] = {
+		"mock0", "mock1", "mock2", "mock3"
+	};
+	for (int i = 0; i < MOCK_PROVIDERS_MAX; i++) {
+		mock_providers[i] = mock_provider;
+		mock_providers[i].name = names[i];
+	}
+
+	char *path = bench_temp_file("redshift-bench");
+	if (path == NULL) exit(EXIT_FAILURE);
+
+	for (int i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		const mock_scenario_t *scenario = &scenarios[i];
+
+		mock_run_t run;
+		if (mock_run_init(&run, scenario, path) < 0) {
+			unlink(path);
+			exit(EXIT_FAILURE);
+		}
+
+		bench_run("location_task_wait", scenario->param,
+			  run_location_task, &run, scenario->iterations);
+
+		/* Let abandoned providers return before the
+		   configuration goes away. */
+		while (mock_count(0) > 0) mock_sleep(0.01);
+		config_ini_free(&run.config);
+	}
+
+	unlink(path);
+	free(path);
+}
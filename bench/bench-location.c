@@ -0,0 +1,133 @@
+/* bench-location.c -- Location lookup benchmarks
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "citydb.h"
+#include "location-timezone.h"
+
+/* Number of cities in the generated database; about the size of the
+   GeoNames cities1000 set. */
+#define CITY_COUNT  150000
+
+static void
+write_u32(unsigned char *p, uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+/* Write a database of synthetic cities named city000000 and so on,
+   which are already in sorted order. */
+static int
+write_citydb(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	unsigned char header[CITYDB_HEADER_SIZE] = { 0 };
+	memcpy(header, CITYDB_MAGIC, 8);
+	write_u32(header + 8, CITY_COUNT);
+	fwrite(header, 1, sizeof(header), f);
+
+	uint32_t names = CITYDB_HEADER_SIZE + CITY_COUNT * CITYDB_RECORD_SIZE;
+	for (int i = 0; i < CITY_COUNT; i++) {
+		unsigned char record[CITYDB_RECORD_SIZE] = { 0 };
+		write_u32(record, names + i * 11);
+		write_u32(record + 4, (int32_t)((i % 180) - 90) * 100000);
+		write_u32(record + 8, (int32_t)((i % 360) - 180) * 100000);
+		record[12] = 'D';
+		record[13] = 'K';
+		fwrite(record, 1, sizeof(record), f);
+	}
+
+	for (int i = 0; i < CITY_COUNT; i++) {
+		fprintf(f, "city%06i", i);
+		fputc('\0', f);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void
+run_citydb_lookup(void *data, unsigned long iterations)
+{
+	const citydb_t *db = data;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "City%06lu,dk",
+			 (i * 7919) % CITY_COUNT);
+		location_t loc;
+		if (citydb_lookup(db, name, &loc) == 0) bench_sink += loc.lat;
+	}
+}
+
+static void
+run_timezone_lookup(void *data, unsigned long iterations)
+{
+	static const char *zones[] = {
+		"Europe/Copenhagen", "America/New_York", "Asia/Tokyo",
+		"Australia/Sydney", "Africa/Abidjan", "Pacific/Auckland"
+	};
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		location_t loc;
+		const char *zone = zones[i % (sizeof(zones) /
+					      sizeof(zones[0]))];
+		if (location_timezone_lookup(zone, &loc) == 0) {
+			bench_sink += loc.lat;
+		}
+	}
+}
+
+void
+bench_location(void)
+{
+	char *path = bench_temp_file("redshift-bench");
+	if (path == NULL) exit(EXIT_FAILURE);
+
+	citydb_t db;
+	if (write_citydb(path) < 0 || citydb_open(&db, path) < 0) {
+		unlink(path);
+		exit(EXIT_FAILURE);
+	}
+
+	char param[32];
+	snprintf(param, sizeof(param), "cities=%i", CITY_COUNT);
+	bench_run("citydb_lookup", param, run_citydb_lookup, &db, 1000000);
+
+	citydb_close(&db);
+	unlink(path);
+	free(path);
+
+	bench_run("location_timezone_lookup", NULL, run_timezone_lookup,
+		  NULL, 1000000);
+}
@@ -0,0 +1,73 @@
+/* bench-solar.c -- Solar position benchmarks
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "solar.h"
+
+/* 2016-01-01T00:00:00Z */
+#define YEAR_START  1451606400.0
+#define YEAR_SECONDS  (365 * 86400.0)
+
+/* Copenhagen */
+#define LAT  55.7
+#define LON  12.6
+
+/* One sample every ten minutes over a year. */
+#define ELEVATION_STEP  600.0
+
+static void
+run_elevation(void *data, unsigned long iterations)
+{
+	double sum = 0.0;
+	unsigned long steps = YEAR_SECONDS / ELEVATION_STEP;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		double date = YEAR_START + (i % steps) * ELEVATION_STEP;
+		sum += solar_elevation(date, LAT, LON);
+	}
+
+	bench_sink += sum;
+}
+
+/* One table per day over a year. */
+static void
+run_table_fill(void *data, unsigned long iterations)
+{
+	double sum = 0.0;
+
+	for (unsigned long i = 0; i < iterations; i++) {
+		double table[SOLAR_TIME_MAX];
+		double date = YEAR_START + (i % 365) * 86400.0;
+		solar_table_fill(date, LAT, LON, table);
+		sum += table[SOLAR_TIME_SUNRISE];
+	}
+
+	bench_sink += sum;
+}
+
+void
+bench_solar(void)
+{
+	bench_run("solar_elevation", "year", run_elevation, NULL,
+		  YEAR_SECONDS / ELEVATION_STEP);
+	bench_run("solar_table_fill", "year", run_table_fill, NULL,
+		  365 * 20);
+}
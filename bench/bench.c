@@ -0,0 +1,151 @@
+/* bench.c -- Microbenchmarks of redshift hot paths
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+/* Each benchmark is run once to warm up and then REPEATS times. One
+   line of JSON is printed per benchmark with the median, minimum and
+   maximum time per operation in nanoseconds. Inputs are fixed so runs
+   are comparable between builds. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "systemtime.h"
+
+#define DEFAULT_REPEATS  5
+
+volatile double bench_sink = 0.0;
+
+static int repeats = DEFAULT_REPEATS;
+static int quick = 0;
+static const char *filter = NULL;
+
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+void
+bench_run(const char *name, const char *param,
+	  bench_func_t *func, void *data, unsigned long iterations)
+{
+	if (filter != NULL && strstr(name, filter) == NULL) return;
+
+	/* Quick mode only checks that the benchmarks run. */
+	if (quick) {
+		iterations = iterations / 100 > 0 ? iterations / 100 : 1;
+	}
+
+	func(data, iterations / 10 > 0 ? iterations / 10 : 1);
+
+	double times[repeats];
+	for (int i = 0; i < repeats; i++) {
+		double start, end;
+		systemtime_get_monotonic_time(&start);
+		func(data, iterations);
+		systemtime_get_monotonic_time(&end);
+		times[i] = (end - start) * 1e9 / iterations;
+	}
+
+	qsort(times, repeats, sizeof(double), compare_double);
+
+	printf("{\"name\":\"%s\"", name);
+	if (param != NULL) printf(",\"param\":\"%s\"", param);
+	printf(",\"iterations\":%lu,\"repeats\":%i,"
+	       "\"median_ns\":%.1f,\"min_ns\":%.1f,\"max_ns\":%.1f}\n",
+	       iterations, repeats, times[repeats / 2], times[0],
+	       times[repeats - 1]);
+	fflush(stdout);
+}
+
+char *
+bench_temp_file(const char *prefix)
+{
+	const char *dir = getenv("TMPDIR");
+	if (dir == NULL || dir[0] == '\0') dir = "/tmp";
+
+	size_t size = strlen(dir) + strlen(prefix) + 16;
+	char *path = malloc(size);
+	if (path == NULL) return NULL;
+	snprintf(path, size, "%s/%s.XXXXXX", dir, prefix);
+
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		perror("mkstemp");
+		free(path);
+		return NULL;
+	}
+	close(fd);
+
+	return path;
+}
+
+static void
+print_help(const char *program_name)
+{
+	printf("Usage: %s [-q] [-r REPEATS] [FILTER]\n\n"
+	       "  -q\t\tQuick run with few iterations\n"
+	       "  -r REPEATS\tNumber of timed runs (default %i)\n"
+	       "  FILTER\tOnly run benchmarks with names containing"
+	       " FILTER\n", program_name, DEFAULT_REPEATS);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int opt;
+	while ((opt = getopt(argc, argv, "hqr:")) != -1) {
+		switch (opt) {
+		case 'h':
+			print_help(argv[0]);
+			exit(EXIT_SUCCESS);
+		case 'q':
+			quick = 1;
+			repeats = 1;
+			break;
+		case 'r':
+			repeats = atoi(optarg);
+			if (repeats < 1) repeats = 1;
+			break;
+		default:
+			print_help(argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind < argc) filter = argv[optind];
+
+	bench_colorramp();
+	bench_solar();
+	bench_config();
+	bench_location();
+	bench_location_task();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+/* bench.h -- Microbenchmark harness header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_BENCH_H
+#define REDSHIFT_BENCH_H
+
+/* Run the operation ITERATIONS times. */
+typedef void bench_func_t(void *data, unsigned long iterations);
+
+/* Time FUNC and print one line of JSON with the time per operation.
+   PARAM describes the input (e.g. "size=256") and may be NULL. */
+void bench_run(const char *name, const char *param,
+	       bench_func_t *func, void *data, unsigned long iterations);
+
+/* Write a temporary file for the benchmark. Returns NULL on error;
+   the returned path must be removed and freed by the caller. */
+char *bench_temp_file(const char *prefix);
+
+/* Results are accumulated here so the work cannot be optimized away. */
+extern volatile double bench_sink;
+
+void bench_colorramp(void);
+void bench_solar(void);
+void bench_config(void);
+void bench_location(void);
+void bench_location_task(void);
+
+
+#endif /* ! REDSHIFT_BENCH_H */
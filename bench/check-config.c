@@ -0,0 +1,266 @@
+/* check-config.c -- Configuration file parser corpus check
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+/* Every file in the corpus is parsed as is and then with a fixed
+   series of random mutations (flipped bytes, inserted separators and
+   truncation). Files named ok-* must parse and bad-* must be
+   rejected. Whenever a file parses, the hash index must agree with a
+   linear search of the section and setting lists. Run it under
+   AddressSanitizer to also catch memory errors. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "config-ini.h"
+
+#define MUTATIONS  200
+#define MAX_MUTATION_BYTES  8
+
+static uint32_t seed = 1;
+
+
+/* Uniform random number below N (xorshift32). */
+static size_t
+random_below(size_t n)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return n > 0 ? seed % n : 0;
+}
+
+static const char *
+find_setting(const config_ini_state_t *state, const char *section,
+	     const char *name)
+{
+	/* Both lists are in reverse file order, so the first match is
+	   the one that was set last. */
+	for (const config_ini_section_t *s = state->sections; s != NULL;
+	     s = s->next) {
+		if (strcasecmp(s->name, section) != 0) continue;
+		for (const config_ini_setting_t *t = s->settings; t != NULL;
+		     t = t->next) {
+			if (strcasecmp(t->name, name) == 0) return t->value;
+		}
+	}
+
+	return NULL;
+}
+
+/* Compare lookups through the index with a linear search. Returns
+   -1 on a mismatch. */
+static int
+check_index(config_ini_state_t *state)
+{
+	for (config_ini_section_t *s = state->sections; s != NULL;
+	     s = s->next) {
+		config_ini_section_t *first = state->sections;
+		while (strcasecmp(first->name, s->name) != 0) {
+			first = first->next;
+		}
+		if (config_ini_get_section(state, s->name) != first) {
+			return -1;
+		}
+
+		for (config_ini_setting_t *t = s->settings; t != NULL;
+		     t = t->next) {
+			if (config_ini_get_setting(state, s->name, t->name) !=
+			    find_setting(state, s->name, t->name)) {
+				return -1;
+			}
+		}
+
+		if (config_ini_get_setting(state, s->name,
+					   "no such setting") != NULL) {
+			return -1;
+		}
+	}
+
+	if (config_ini_get_section(state, "no such section") != NULL) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Parse DATA through a temporary file. Returns 1 if it was parsed,
+   0 if it was rejected and -1 if the index is inconsistent. */
+static int
+check_data(const char *path, const char *data, size_t size)
+{
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	fwrite(data, 1, size, f);
+	fclose(f);
+
+	config_ini_state_t state;
+	if (config_ini_init(&state, path) < 0) return 0;
+
+	int r = check_index(&state) < 0 ? -1 : 1;
+	config_ini_free(&state);
+	return r;
+}
+
+static char *
+read_file(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	char *data = malloc(len + MAX_MUTATION_BYTES + 1);
+	if (data == NULL || fread(data, 1, len, f) != (size_t)len) {
+		perror(path);
+		free(data);
+		fclose(f);
+		return NULL;
+	}
+
+	fclose(f);
+	*size = len;
+	return data;
+}
+
+/* Change a few bytes of DATA in place, possibly growing it by up to
+   MAX_MUTATION_BYTES, or truncate it. */
+static size_t
+mutate(char *data, size_t size)
+{
+	static const char special[] = "[]=;\n\r\t \0";
+
+	int count = 1 + random_below(MAX_MUTATION_BYTES);
+	for (int i = 0; i < count; i++) {
+		size_t pos = random_below(size + 1);
+		switch (random_below(4)) {
+		case 0:
+			/* Insert a byte that means something. */
+			memmove(&data[pos + 1], &data[pos], size - pos);
+			data[pos] = special[random_below(sizeof(special))];
+			size += 1;
+			break;
+		case 1:
+			if (pos < size) data[pos] = random_below(256);
+			break;
+		case 2:
+			if (pos < size) {
+				memmove(&data[pos], &data[pos + 1],
+					size - pos - 1);
+				size -= 1;
+			}
+			break;
+		default:
+			if (i == 0) return pos;
+			break;
+		}
+	}
+
+	return size;
+}
+
+static int
+check_file(const char *corpus_path, const char *temp_path)
+{
+	size_t size;
+	char *data = read_file(corpus_path, &size);
+	if (data == NULL) return -1;
+
+	const char *name = strrchr(corpus_path, '/');
+	name = name != NULL ? name + 1 : corpus_path;
+	int expected = strncmp(name, "bad-", 4) != 0;
+
+	int failed = 0;
+	int r = check_data(temp_path, data, size);
+	if (r < 0) {
+		printf("%s: index does not match the lists\n", name);
+		failed = 1;
+	} else if (r != expected) {
+		printf("%s: %s\n", name, expected ? "rejected" :
+		       "accepted");
+		failed = 1;
+	}
+
+	char *copy = malloc(size + MAX_MUTATION_BYTES + 1);
+	if (copy == NULL) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < MUTATIONS; i++) {
+		memcpy(copy, data, size);
+		size_t copy_size = mutate(copy, size);
+		if (check_data(temp_path, copy, copy_size) < 0) {
+			printf("%s: mutation %i: index does not match the"
+			       " lists\n", name, i);
+			failed = 1;
+		}
+	}
+
+	free(copy);
+	free(data);
+	return failed ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		printf("Usage: %s FILE...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *dir = getenv("TMPDIR");
+	if (dir == NULL || dir[0] == '\0') dir = "/tmp";
+
+	char temp_path[4096];
+	snprintf(temp_path, sizeof(temp_path),
+		 "%s/redshift-check-config.XXXXXX", dir);
+	int fd = mkstemp(temp_path);
+	if (fd < 0) {
+		perror("mkstemp");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	int failures = 0;
+	for (int i = 1; i < argc; i++) {
+		if (check_file(argv[i], temp_path) < 0) failures += 1;
+	}
+
+	unlink(temp_path);
+
+	printf("%i of %i corpus files failed\n", failures, argc - 1);
+	return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
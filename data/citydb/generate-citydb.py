@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# generate-citydb.py -- City database generator
+# This file is part of Redshift.
+
+# Redshift is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+
+# Redshift is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+# Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+
+
+'''Generate the city database used by the manual location provider.
+
+Reads a GeoNames dump such as cities15000.txt (tab separated, see
+http://download.geonames.org/export/dump/readme.txt) and writes the
+sorted binary format described in src/citydb.h.
+
+Usage: generate-citydb.py INPUT OUTPUT
+'''
+
+import struct
+import sys
+
+MAGIC = b'RSCITY1\n'
+
+
+def read_cities(path):
+    '''Return (name, lat, lon, country, population) for each city.'''
+    cities = []
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            fields = line.rstrip('\n').split('\t')
+            if len(fields) < 15:
+                continue
+
+            # Names are matched case-insensitively on the ASCII name.
+            name = fields[2]
+            if not name or ',' in name or \
+               any(ord(c) >= 128 for c in name):
+                continue
+
+            country = fields[8].encode('ascii')
+            if len(country) != 2:
+                continue
+
+            cities.append((name,
+                           round(float(fields[4]) * 100000),
+                           round(float(fields[5]) * 100000),
+                           country,
+                           int(fields[14] or 0)))
+
+    # Sort by name, most populous first among cities with the same
+    # name, which is the order the lookup in citydb.c expects.
+    cities.sort(key=lambda c: (c[0].lower(), -c[4]))
+    return cities
+
+
+def write_database(path, cities):
+    header_size = 16
+    record_size = 16
+    names_offset = header_size + record_size * len(cities)
+
+    records = []
+    names = []
+    offset = names_offset
+    for name, lat, lon, country, _ in cities:
+        records.append(struct.pack('<Iii2sH', offset, lat, lon, country, 0))
+        encoded = name.encode('ascii') + b'\0'
+        names.append(encoded)
+        offset += len(encoded)
+
+    with open(path, 'wb') as f:
+        f.write(MAGIC + struct.pack('<II', len(cities), 0))
+        f.write(b''.join(records))
+        f.write(b''.join(names))
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('Usage: {} INPUT OUTPUT'.format(sys.argv[0]))
+
+    write_database(sys.argv[2], read_cities(sys.argv[1]))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,159 @@
+/* background.c -- Background task source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+# include <poll.h>
+# include <fcntl.h>
+#endif
+
+#include "background.h"
+
+
+#if defined(HAVE_PTHREAD_H) && !defined(_WIN32)
+
+static void *
+background_thread(void *arg)
+{
+	background_t *bg = arg;
+	bg->result = bg->func(bg->data);
+
+	/* Closing the write end makes the read end readable (end of
+	   file) which lets the main loop poll for completion. */
+	close(bg->write_fd);
+	bg->write_fd = -1;
+
+	return NULL;
+}
+
+/* Run FUNC(DATA) in a separate thread. The file descriptor in BG
+   becomes readable once it returns. */
+int
+background_start(background_t *bg, background_func_t *func, void *data)
+{
+	bg->func = func;
+	bg->data = data;
+	bg->result = -1;
+	bg->running = 0;
+
+	int fds[2];
+	int r = pipe(fds);
+	if (r < 0) {
+		perror("pipe");
+		return -1;
+	}
+
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+	bg->fd = fds[0];
+	bg->write_fd = fds[1];
+
+	r = pthread_create(&bg->thread, NULL, background_thread, bg);
+	if (r != 0) {
+		errno = r;
+		perror("pthread_create");
+		close(bg->fd);
+		close(bg->write_fd);
+		return -1;
+	}
+
+	bg->running = 1;
+	return 0;
+}
+
+/* Return non-zero if the task has finished. */
+int
+background_done(const background_t *bg)
+{
+	if (!bg->running) return 1;
+
+	struct pollfd pfd = { bg->fd, POLLIN, 0 };
+	int r = poll(&pfd, 1, 0);
+	return r > 0;
+}
+
+/* Wait for the task to finish and return its result. */
+int
+background_join(background_t *bg)
+{
+	if (bg->running) {
+		pthread_join(bg->thread, NULL);
+		close(bg->fd);
+		bg->fd = -1;
+		bg->running = 0;
+	}
+
+	return bg->result;
+}
+
+/* Stop waiting for the task. It keeps running and its resources are
+   released when it returns, so DATA must stay valid until then. */
+void
+background_detach(background_t *bg)
+{
+	if (bg->running) {
+		pthread_detach(bg->thread);
+		close(bg->fd);
+		bg->fd = -1;
+		bg->running = 0;
+	}
+}
+
+#else /* ! HAVE_PTHREAD_H || _WIN32 */
+
+/* Without threads the task simply runs to completion here. */
+int
+background_start(background_t *bg, background_func_t *func, void *data)
+{
+	bg->func = func;
+	bg->data = data;
+	bg->running = 0;
+	bg->fd = -1;
+	bg->write_fd = -1;
+	bg->result = func(data);
+	return 0;
+}
+
+int
+background_done(const background_t *bg)
+{
+	return 1;
+}
+
+int
+background_join(background_t *bg)
+{
+	return bg->result;
+}
+
+void
+background_detach(background_t *bg)
+{
+}
+
+#endif
@@ -0,0 +1,55 @@
+/* background.h -- Background task header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_BACKGROUND_H
+#define REDSHIFT_BACKGROUND_H
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+typedef int background_func_t(void *data);
+
+typedef struct {
+	background_func_t *func;
+	void *data;
+	int result;
+	int running;
+
+	/* Becomes readable when the task has finished. */
+	int fd;
+	int write_fd;
+#ifdef HAVE_PTHREAD_H
+	pthread_t thread;
+#endif
+} background_t;
+
+
+int background_start(background_t *bg, background_func_t *func,
+		     void *data);
+int background_done(const background_t *bg);
+int background_join(background_t *bg);
+void background_detach(background_t *bg);
+
+
+#endif /* ! REDSHIFT_BACKGROUND_H */
@@ -0,0 +1,199 @@
+/* citydb.c -- City database source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
+#include "citydb.h"
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+
+static uint32_t
+read_u32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int
+ascii_tolower(int c)
+{
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/* Compare the first LEN characters of KEY with the NUL-terminated
+   name at offset OFFSET in the database, ignoring ASCII case. */
+static int
+compare_name(const citydb_t *db, const char *key, size_t len,
+	     uint32_t offset)
+{
+	const unsigned char *a = (const unsigned char *)key;
+	const unsigned char *b = db->data + offset;
+	const unsigned char *end = db->data + db->size;
+
+	for (size_t i = 0; i < len; i++, b++) {
+		if (b >= end || *b == '\0') return 1;
+		int d = ascii_tolower(a[i]) - ascii_tolower(*b);
+		if (d != 0) return d;
+	}
+
+	return b < end && *b != '\0' ? -1 : 0;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+
+/* Map the database at PATH read-only. */
+int
+citydb_open(citydb_t *db, const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		perror("fstat");
+		close(fd);
+		return -1;
+	}
+
+	if (st.st_size < CITYDB_HEADER_SIZE) {
+		fprintf(stderr, _("Invalid city database `%s'.\n"), path);
+		close(fd);
+		return -1;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+
+	db->data = data;
+	db->size = st.st_size;
+	db->count = read_u32(db->data + 8);
+
+	if (memcmp(db->data, CITYDB_MAGIC, 8) != 0 ||
+	    db->count > (db->size - CITYDB_HEADER_SIZE) /
+	    CITYDB_RECORD_SIZE) {
+		fprintf(stderr, _("Invalid city database `%s'.\n"), path);
+		citydb_close(db);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+citydb_close(citydb_t *db)
+{
+	munmap((void *)db->data, db->size);
+	db->data = NULL;
+}
+
+#else /* ! HAVE_SYS_MMAN_H */
+
+int
+citydb_open(citydb_t *db, const char *path)
+{
+	fputs(_("City database is not supported on this platform.\n"),
+	      stderr);
+	return -1;
+}
+
+void
+citydb_close(citydb_t *db)
+{
+}
+
+#endif /* ! HAVE_SYS_MMAN_H */
+
+/* Find the city NAME, optionally followed by a comma and a two
+   letter country code (e.g. `Paris,FR'). If several cities have the
+   same name the most populous is used. */
+int
+citydb_lookup(const citydb_t *db, const char *name, location_t *loc)
+{
+	const char *country = strchr(name, ',');
+	size_t len = country != NULL ? (size_t)(country - name) :
+		strlen(name);
+	if (country != NULL) {
+		country += 1;
+		while (*country == ' ') country += 1;
+	}
+
+	const unsigned char *records = db->data + CITYDB_HEADER_SIZE;
+
+	/* Find the first record with the name. */
+	unsigned int lo = 0;
+	unsigned int hi = db->count;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		uint32_t offset = read_u32(records +
+					   mid * CITYDB_RECORD_SIZE);
+		if (compare_name(db, name, len, offset) > 0) lo = mid + 1;
+		else hi = mid;
+	}
+
+	for (unsigned int i = lo; i < db->count; i++) {
+		const unsigned char *record = records +
+			i * CITYDB_RECORD_SIZE;
+		if (compare_name(db, name, len, read_u32(record)) != 0) {
+			break;
+		}
+
+		if (country != NULL &&
+		    (ascii_tolower(country[0]) !=
+		     ascii_tolower(record[12]) ||
+		     ascii_tolower(country[1]) !=
+		     ascii_tolower(record[13]) ||
+		     country[1] == '\0' || country[2] != '\0')) {
+			continue;
+		}
+
+		loc->lat = (int32_t)read_u32(record + 4) / 100000.0;
+		loc->lon = (int32_t)read_u32(record + 8) / 100000.0;
+		return 0;
+	}
+
+	return -1;
+}
@@ -0,0 +1,59 @@
+/* citydb.h -- City database header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_CITYDB_H
+#define REDSHIFT_CITYDB_H
+
+#include <stddef.h>
+
+#include "redshift.h"
+
+/* The database is generated by data/citydb/generate-citydb.py. It
+   starts with a header followed by records sorted by name (ASCII,
+   case-insensitive, most populous first) and the names. All integers
+   are little endian.
+
+   Header:  char magic[8]; uint32 count; uint32 reserved;
+   Record:  uint32 name_offset; int32 lat; int32 lon;
+            char country[2]; uint16 reserved;
+
+   Coordinates are in units of 1/100000 degree and name offsets are
+   relative to the start of the file. */
+#ifndef CITYDB_PATH
+# define CITYDB_PATH  "/usr/share/redshift/cities.db"
+#endif
+
+#define CITYDB_MAGIC  "RSCITY1\n"
+#define CITYDB_HEADER_SIZE  16
+#define CITYDB_RECORD_SIZE  16
+
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+	unsigned int count;
+} citydb_t;
+
+
+int citydb_open(citydb_t *db, const char *path);
+void citydb_close(citydb_t *db);
+
+int citydb_lookup(const citydb_t *db, const char *name, location_t *loc);
+
+
+#endif /* ! REDSHIFT_CITYDB_H */
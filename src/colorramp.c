@@ -18,7 +18,9 @@
    Copyright (c) 2013  Ingo Thies <ithies@astro.uni-bonn.de>
 */
 
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "redshift.h"
@@ -325,3 +327,82 @@ colorramp_fill_float(float *gamma_r, float *gamma_g, float *gamma_b,
 }
 
 #undef F
+
+
+/* Number of ramps kept by colorramp_fill_pure(). */
+#define RAMP_CACHE_SIZE  8
+
+typedef struct {
+	int size;
+	color_setting_t setting;
+	unsigned long used;
+	uint16_t *ramps;
+} ramp_cache_entry_t;
+
+static ramp_cache_entry_t ramp_cache[RAMP_CACHE_SIZE];
+static unsigned long ramp_cache_clock = 0;
+
+static int
+setting_equal(const color_setting_t *a, const color_setting_t *b)
+{
+	return a->temperature == b->temperature &&
+		a->brightness == b->brightness &&
+		a->gamma[0] == b->gamma[0] &&
+		a->gamma[1] == b->gamma[1] &&
+		a->gamma[2] == b->gamma[2];
+}
+
+/* Fill ramps of SIZE entries for SETTING, starting from the identity
+   ramp. The result only depends on the size and setting, so recent
+   results are cached: CRTCs of equal size and settings that are
+   requested again (e.g. while an interactive override is dragged
+   back and forth) only cost a copy. */
+void
+colorramp_fill_pure(uint16_t *gamma_r, uint16_t *gamma_g, uint16_t *gamma_b,
+		    int size, const color_setting_t *setting)
+{
+	ramp_cache_entry_t *victim = &ramp_cache[0];
+
+	ramp_cache_clock += 1;
+	for (int i = 0; i < RAMP_CACHE_SIZE; i++) {
+		ramp_cache_entry_t *e = &ramp_cache[i];
+		if (e->ramps != NULL && e->size == size &&
+		    setting_equal(&e->setting, setting)) {
+			e->used = ramp_cache_clock;
+			memcpy(gamma_r, &e->ramps[0*size], size*sizeof(uint16_t));
+			memcpy(gamma_g, &e->ramps[1*size], size*sizeof(uint16_t));
+			memcpy(gamma_b, &e->ramps[2*size], size*sizeof(uint16_t));
+			return;
+		}
+
+		if (e->used < victim->used) victim = e;
+	}
+
+	/* Initialize gamma ramps to pure state */
+	for (int i = 0; i < size; i++) {
+		uint16_t value = (double)i/size * (UINT16_MAX+1);
+		gamma_r[i] = value;
+		gamma_g[i] = value;
+		gamma_b[i] = value;
+	}
+
+	colorramp_fill(gamma_r, gamma_g, gamma_b, size, setting);
+
+	/* Replace the least recently used entry. Failing to
+	   allocate only means the result is not cached. */
+	if (victim->ramps == NULL || victim->size != size) {
+		free(victim->ramps);
+		victim->ramps = malloc(3*size*sizeof(uint16_t));
+		if (victim->ramps == NULL) {
+			victim->size = 0;
+			return;
+		}
+		victim->size = size;
+	}
+
+	victim->setting = *setting;
+	victim->used = ramp_cache_clock;
+	memcpy(&victim->ramps[0*size], gamma_r, size*sizeof(uint16_t));
+	memcpy(&victim->ramps[1*size], gamma_g, size*sizeof(uint16_t));
+	memcpy(&victim->ramps[2*size], gamma_b, size*sizeof(uint16_t));
+}
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -39,11 +40,11 @@
 #endif
 
 #define MAX_CONFIG_PATH  4096
-#define MAX_LINE_LENGTH   512
 
 
+/* Open the configuration file and store its path in FOUND. */
 static FILE *
-open_config_file(const char *filepath)
+open_config_file(const char *filepath, char *found, size_t size)
 {
 	FILE *f = NULL;
 
@@ -119,6 +120,7 @@ open_config_file(const char *filepath)
 		}
 #endif
 
+		if (f != NULL) snprintf(found, size, "%s", cp);
 		return f;
 	} else {
 		f = fopen(filepath, "r");
@@ -126,174 +128,321 @@ open_config_file(const char *filepath)
 			perror("fopen");
 			return NULL;
 		}
+		snprintf(found, size, "%s", filepath);
 	}
 
 	return f;
 }
 
+/* Entry of the hash index. Sections are indexed by name with SETTING
+   set to NULL, settings by section and setting name. */
+typedef struct {
+	const config_ini_section_t *section;
+	const config_ini_setting_t *setting;
+} config_ini_index_entry_t;
+
+/* Case-insensitive FNV-1a hash of NAME continuing from HASH. */
+static unsigned int
+hash_name(unsigned int hash, const char *name)
+{
+	for (const char *p = name; *p != '\0'; p++) {
+		hash ^= (unsigned char)tolower((unsigned char)*p);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+#define HASH_INIT  2166136261u
+
+static unsigned int
+hash_setting(const char *section, const char *name)
+{
+	/* Separate the names so `a'+`bc' differs from `ab'+`c'. */
+	unsigned int hash = hash_name(HASH_INIT, section);
+	hash = (hash ^ 0xff) * 16777619u;
+	return hash_name(hash, name);
+}
+
+/* Find the slot for the section or setting in the index. */
+static config_ini_index_entry_t *
+index_find(const config_ini_state_t *state, unsigned int hash,
+	   const char *section, const char *name)
+{
+	config_ini_index_entry_t *index = state->index;
+	unsigned int mask = state->index_size - 1;
+
+	for (unsigned int i = hash & mask;; i = (i + 1) & mask) {
+		config_ini_index_entry_t *entry = &index[i];
+		if (entry->section == NULL) return entry;
+		if (strcasecmp(entry->section->name, section) != 0) continue;
+
+		if (name == NULL && entry->setting == NULL) return entry;
+		if (name != NULL && entry->setting != NULL &&
+		    strcasecmp(entry->setting->name, name) == 0) {
+			return entry;
+		}
+	}
+}
+
+/* Count sections and settings so the arena can be sized before
+   parsing. Every line is at most one of either. */
+static void
+count_lines(const char *text, size_t size, size_t *sections,
+	    size_t *settings)
+{
+	*sections = 0;
+	*settings = 0;
+
+	const char *end = text + size;
+	const char *line = text;
+	while (line < end) {
+		const char *next = memchr(line, '\n', end - line);
+		if (next == NULL) next = end;
+
+		while (line < next && (*line == ' ' || *line == '\t')) {
+			line += 1;
+		}
+
+		if (line < next && *line == '[') *sections += 1;
+		else if (line < next && *line != ';') *settings += 1;
+
+		line = next + 1;
+	}
+}
+
+/* Read the whole file at once into a single arena that also holds
+   the sections, settings and hash index. Names and values point into
+   the text of the file which is terminated in place. */
 int
 config_ini_init(config_ini_state_t *state, const char *filepath)
 {
 	config_ini_section_t *section = NULL;
 	state->sections = NULL;
+	state->path = NULL;
+	state->arena = NULL;
+	state->index = NULL;
+	state->index_size = 0;
 
-	FILE *f = open_config_file(filepath);
+	char found[MAX_CONFIG_PATH];
+	FILE *f = open_config_file(filepath, found, sizeof(found));
 	if (f == NULL) {
 		/* Only a serious error if a file was explicitly requested. */
 		if (filepath != NULL) return -1;
 		return 0;
 	}
 
-	char line[MAX_LINE_LENGTH];
-	char *s;
+	/* Remember the file so it can be watched for changes. */
+	state->path = strdup(found);
+
+	struct stat st;
+	if (fstat(fileno(f), &st) < 0) {
+		perror("fstat");
+		fclose(f);
+		config_ini_free(state);
+		return -1;
+	}
 
+	/* Read the file in one go. The size is only a hint since the
+	   file may be a pipe. */
+	size_t capacity = st.st_size > 0 ? (size_t)st.st_size + 1 : 4096;
+	size_t size = 0;
+	char *text = NULL;
 	while (1) {
+		char *buffer = realloc(text, capacity);
+		if (buffer == NULL) {
+			free(text);
+			fclose(f);
+			config_ini_free(state);
+			return -1;
+		}
+		text = buffer;
+
+		size += fread(text + size, 1, capacity - size - 1, f);
+		if (size < capacity - 1) break;
+		capacity *= 2;
+	}
+
+	int error = ferror(f);
+	fclose(f);
+	if (error) {
+		fputs(_("Unable to read config file.\n"), stderr);
+		free(text);
+		config_ini_free(state);
+		return -1;
+	}
+
+	text[size] = '\0';
+
+	size_t section_count, setting_count;
+	count_lines(text, size, &section_count, &setting_count);
+
+	unsigned int index_size = 8;
+	while (index_size < 2 * (section_count + setting_count)) {
+		index_size *= 2;
+	}
+
+	/* Lay out the arena: nodes first for alignment, then text. */
+	size_t sections_size = section_count * sizeof(config_ini_section_t);
+	size_t settings_size = setting_count * sizeof(config_ini_setting_t);
+	size_t index_bytes = index_size * sizeof(config_ini_index_entry_t);
+	size_t nodes_size = index_bytes + sections_size + settings_size;
+
+	char *arena = realloc(text, nodes_size + size + 1);
+	if (arena == NULL) {
+		free(text);
+		config_ini_free(state);
+		return -1;
+	}
+
+	memmove(arena + nodes_size, arena, size + 1);
+	memset(arena, 0, index_bytes);
+
+	state->arena = arena;
+	state->index = (config_ini_index_entry_t *)arena;
+	state->index_size = index_size;
+
+	config_ini_section_t *next_section =
+		(config_ini_section_t *)(arena + index_bytes);
+	config_ini_setting_t *next_setting =
+		(config_ini_setting_t *)(arena + index_bytes + sections_size);
+	text = arena + nodes_size;
+
+	char *end = text + size;
+	char *line = text;
+	while (line < end) {
 		/* Handle the file input linewise. */
-		char *r = fgets(line, sizeof(line), f);
-		if (r == NULL) break;
+		char *eol = memchr(line, '\n', end - line);
+		if (eol == NULL) eol = end;
+		*eol = '\0';
 
 		/* Strip leading blanks and trailing newline. */
-		s = line + strspn(line, " \t");
+		char *s = line + strspn(line, " \t");
 		s[strcspn(s, "\r\n")] = '\0';
+		line = eol + 1;
 
 		/* Skip comments and empty lines. */
 		if (s[0] == ';' || s[0] == '\0') continue;
 
 		if (s[0] == '[') {
 			/* Read name of section. */
-			const char *name = s+1;
-			char *end = strchr(s, ']');
-			if (end == NULL || end[1] != '\0' || end == name) {
+			char *name = s+1;
+			char *name_end = strchr(s, ']');
+			if (name_end == NULL || name_end[1] != '\0' ||
+			    name_end == name) {
 				fputs(_("Malformed section header in config"
 					" file.\n"), stderr);
-				fclose(f);
 				config_ini_free(state);
 				return -1;
 			}
 
-			*end = '\0';
-
-			/* Create section. */
-			section = malloc(sizeof(config_ini_section_t));
-			if (section == NULL) {
-				fclose(f);
-				config_ini_free(state);
-				return -1;
-			}
+			*name_end = '\0';
 
 			/* Insert into section list. */
-			section->name = NULL;
+			section = next_section++;
+			section->name = name;
 			section->settings = NULL;
 			section->next = state->sections;
 			state->sections = section;
 
-			/* Copy section name. */
-			section->name = malloc(end - name + 1);
-			if (section->name == NULL) {
-				fclose(f);
-				config_ini_free(state);
-				return -1;
-			}
-
-			memcpy(section->name, name, end - name + 1);
+			/* A later section of the same name replaces the
+			   earlier one. */
+			config_ini_index_entry_t *entry =
+				index_find(state, hash_name(HASH_INIT, name),
+					   name, NULL);
+			entry->section = section;
+			entry->setting = NULL;
 		} else {
 			/* Split assignment at equals character. */
-			char *end = strchr(s, '=');
-			if (end == NULL || end == s) {
+			char *eq = strchr(s, '=');
+			if (eq == NULL || eq == s) {
 				fputs(_("Malformed assignment in config"
 					" file.\n"), stderr);
-				fclose(f);
 				config_ini_free(state);
 				return -1;
 			}
 
-			*end = '\0';
-			char *value = end + 1;
+			*eq = '\0';
 
 			if (section == NULL) {
 				fputs(_("Assignment outside section in config"
 					" file.\n"), stderr);
-				fclose(f);
-				config_ini_free(state);
-				return -1;
-			}
-
-			/* Create section. */
-			config_ini_setting_t *setting =
-				malloc(sizeof(config_ini_setting_t));
-			if (setting == NULL) {
-				fclose(f);
 				config_ini_free(state);
 				return -1;
 			}
 
-			/* Insert into section list. */
-			setting->name = NULL;
-			setting->value = NULL;
+			/* Insert into setting list. */
+			config_ini_setting_t *setting = next_setting++;
+			setting->name = s;
+			setting->value = eq + 1;
 			setting->next = section->settings;
 			section->settings = setting;
 
-			/* Copy name of setting. */
-			setting->name = malloc(end - s + 1);
-			if (setting->name == NULL) {
-				fclose(f);
-				config_ini_free(state);
-				return -1;
-			}
-
-			memcpy(setting->name, s, end - s + 1);
-
-			/* Copy setting value. */
-			size_t value_len = strlen(value) + 1;
-			setting->value = malloc(value_len);
-			if (setting->value == NULL) {
-				fclose(f);
-				config_ini_free(state);
-				return -1;
-			}
-
-			memcpy(setting->value, value, value_len);
+			config_ini_index_entry_t *entry =
+				index_find(state,
+					   hash_setting(section->name, s),
+					   section->name, s);
+			entry->section = section;
+			entry->setting = setting;
 		}
 	}
 
-	fclose(f);
-
 	return 0;
 }
 
 void
 config_ini_free(config_ini_state_t *state)
 {
-	config_ini_section_t *section = state->sections;
-
-	while (section != NULL) {
-		config_ini_setting_t *setting = section->settings;
-		config_ini_section_t *section_prev = section;
-
-		while (setting != NULL) {
-			config_ini_setting_t *setting_prev = setting;
-			free(setting->name);
-			free(setting->value);
-			setting = setting->next;
-			free(setting_prev);
-		}
+	free(state->arena);
+	state->arena = NULL;
+	state->sections = NULL;
+	state->index = NULL;
 
-		free(section->name);
-		section = section->next;
-		free(section_prev);
-	}
+	free(state->path);
+	state->path = NULL;
 }
 
 config_ini_section_t *
 config_ini_get_section(config_ini_state_t *state, const char *name)
 {
-	config_ini_section_t *section = state->sections;
-	while (section != NULL) {
-		if (strcasecmp(section->name, name) == 0) {
-			return section;
+	if (state->index == NULL) return NULL;
+
+	const config_ini_index_entry_t *entry =
+		index_find(state, hash_name(HASH_INIT, name), name, NULL);
+	return (config_ini_section_t *)entry->section;
+}
+
+/* Return the value of setting NAME in SECTION, or NULL if it is not
+   set. If the file sets it more than once the last one is used. */
+const char *
+config_ini_get_setting(config_ini_state_t *state, const char *section,
+		       const char *name)
+{
+	if (state->index == NULL) return NULL;
+
+	const config_ini_index_entry_t *entry =
+		index_find(state, hash_setting(section, name),
+			   section, name);
+	return entry->setting != NULL ? entry->setting->value : NULL;
+}
+
+/* Return non-zero if both sections contain the same settings in the
+   same order. A missing section equals an empty one. */
+int
+config_ini_section_equal(const config_ini_section_t *a,
+			 const config_ini_section_t *b)
+{
+	const config_ini_setting_t *sa = a != NULL ? a->settings : NULL;
+	const config_ini_setting_t *sb = b != NULL ? b->settings : NULL;
+
+	while (sa != NULL && sb != NULL) {
+		if (strcasecmp(sa->name, sb->name) != 0 ||
+		    strcmp(sa->value, sb->value) != 0) {
+			return 0;
 		}
-		section = section->next;
+		sa = sa->next;
+		sb = sb->next;
 	}
 
-	return NULL;
+	return sa == NULL && sb == NULL;
 }
@@ -37,6 +37,15 @@ struct _config_ini_section {
 
 typedef struct {
 	config_ini_section_t *sections;
+
+	/* File the configuration was read from, or NULL. */
+	char *path;
+
+	/* The text of the file, sections, settings and hash index all
+	   live in this single allocation. */
+	char *arena;
+	void *index;
+	unsigned int index_size;
 } config_ini_state_t;
 
 
@@ -45,5 +54,9 @@ void config_ini_free(config_ini_state_t *state);
 
 config_ini_section_t *config_ini_get_section(config_ini_state_t *state,
 					     const char *name);
+const char *config_ini_get_setting(config_ini_state_t *state,
+				   const char *section, const char *name);
+int config_ini_section_equal(const config_ini_section_t *a,
+			     const config_ini_section_t *b);
 
 #endif /* ! REDSHIFT_CONFIG_INI_H */
@@ -0,0 +1,151 @@
+/* dirwatch.c -- Directory change notification source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
+
+#include "dirwatch.h"
+
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* Editors either rewrite a file or move a new file in place. */
+#define DIRWATCH_EVENTS \
+	(IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | \
+	 IN_DELETE | IN_ATTRIB)
+
+int
+dirwatch_init(dirwatch_t *watch, const char *dir, const char *name)
+{
+	watch->name = NULL;
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd < 0) return -1;
+
+	if (inotify_add_watch(watch->fd, dir, DIRWATCH_EVENTS) < 0) {
+		close(watch->fd);
+		watch->fd = -1;
+		return -1;
+	}
+
+	if (name != NULL) {
+		watch->name = strdup(name);
+		if (watch->name == NULL) {
+			dirwatch_free(watch);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Read pending events. Returns 1 if a watched file changed, 0 if
+   not and -1 on error. */
+int
+dirwatch_read(dirwatch_t *watch)
+{
+	char buffer[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	int changed = 0;
+
+	while (1) {
+		ssize_t len = read(watch->fd, buffer, sizeof(buffer));
+		if (len < 0) {
+			if (errno == EAGAIN) break;
+			if (errno == EINTR) continue;
+			perror("read");
+			return -1;
+		} else if (len == 0) {
+			break;
+		}
+
+		for (char *p = buffer; p < buffer + len;) {
+			const struct inotify_event *event =
+				(const struct inotify_event *)p;
+			if (watch->name == NULL ||
+			    (event->len > 0 &&
+			     strcmp(event->name, watch->name) == 0)) {
+				changed = 1;
+			}
+			p += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	return changed;
+}
+
+#else /* ! HAVE_SYS_INOTIFY_H */
+
+int
+dirwatch_init(dirwatch_t *watch, const char *dir, const char *name)
+{
+	watch->fd = -1;
+	watch->name = NULL;
+	return -1;
+}
+
+int
+dirwatch_read(dirwatch_t *watch)
+{
+	return 0;
+}
+
+#endif /* ! HAVE_SYS_INOTIFY_H */
+
+/* Watch the file at PATH. The directory is watched since the file
+   may be replaced. */
+int
+dirwatch_init_file(dirwatch_t *watch, const char *path)
+{
+	char *dir = strdup(path);
+	if (dir == NULL) return -1;
+
+	const char *name = path;
+	char *sep = strrchr(dir, '/');
+	if (sep == NULL) {
+		strcpy(dir, ".");
+	} else {
+		name = path + (sep - dir) + 1;
+		if (sep == dir) sep += 1;
+		*sep = '\0';
+	}
+
+	int r = dirwatch_init(watch, dir, name);
+	free(dir);
+	return r;
+}
+
+void
+dirwatch_free(dirwatch_t *watch)
+{
+	if (watch->fd >= 0) close(watch->fd);
+	watch->fd = -1;
+	free(watch->name);
+	watch->name = NULL;
+}
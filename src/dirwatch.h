@@ -0,0 +1,38 @@
+/* dirwatch.h -- Directory change notification header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_DIRWATCH_H
+#define REDSHIFT_DIRWATCH_H
+
+/* Watch a directory for files that are written, replaced or
+   removed. If NAME is set only changes to that file are reported. */
+typedef struct {
+	int fd;
+	char *name;
+} dirwatch_t;
+
+
+int dirwatch_init(dirwatch_t *watch, const char *dir, const char *name);
+int dirwatch_init_file(dirwatch_t *watch, const char *path);
+void dirwatch_free(dirwatch_t *watch);
+
+int dirwatch_read(dirwatch_t *watch);
+
+
+#endif /* ! REDSHIFT_DIRWATCH_H */
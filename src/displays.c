@@ -0,0 +1,188 @@
+/* displays.c -- Multiple display management source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+# include <dirent.h>
+#endif
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "displays.h"
+
+/* Directory of local X server sockets. */
+#define X11_SOCKET_DIR  "/tmp/.X11-unix"
+
+
+static int
+display_list_add(display_list_t *list, const char *name, size_t len)
+{
+	char **names = realloc(list->names,
+			       (list->count + 1) * sizeof(char *));
+	if (names == NULL) {
+		perror("realloc");
+		return -1;
+	}
+	list->names = names;
+
+	char *s = malloc(len + 1);
+	if (s == NULL) {
+		perror("malloc");
+		return -1;
+	}
+	memcpy(s, name, len);
+	s[len] = '\0';
+
+	list->names[list->count++] = s;
+	return 0;
+}
+
+#ifndef _WIN32
+
+static int
+display_number_compare(const void *a, const void *b)
+{
+	long x = atol(*(char * const *)a + 1);
+	long y = atol(*(char * const *)b + 1);
+	return (x > y) - (x < y);
+}
+
+/* Add a display for every local X server socket `X<N>'. */
+static int
+displays_discover(display_list_t *list)
+{
+	DIR *dir = opendir(X11_SOCKET_DIR);
+	if (dir == NULL) {
+		perror("opendir");
+		fprintf(stderr, _("Unable to discover displays in `%s'.\n"),
+			X11_SOCKET_DIR);
+		return -1;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		const char *s = entry->d_name;
+		if (s[0] != 'X' || s[1] == '\0' ||
+		    strspn(&s[1], "0123456789") != strlen(&s[1])) {
+			continue;
+		}
+
+		char name[32];
+		int len = snprintf(name, sizeof(name), ":%s", &s[1]);
+		if (len >= (int)sizeof(name)) continue;
+
+		int r = display_list_add(list, name, len);
+		if (r < 0) {
+			closedir(dir);
+			return -1;
+		}
+	}
+
+	closedir(dir);
+
+	qsort(list->names, list->count, sizeof(char *),
+	      display_number_compare);
+
+	return 0;
+}
+
+#else /* _WIN32 */
+
+static int
+displays_discover(display_list_t *list)
+{
+	fputs(_("Display discovery is not supported on this platform.\n"),
+	      stderr);
+	return -1;
+}
+
+#endif /* _WIN32 */
+
+/* Parse SPEC which is either a comma separated list of display names
+   or `auto' to use every local X server. */
+int
+displays_parse(display_list_t *list, const char *spec)
+{
+	list->names = NULL;
+	list->count = 0;
+
+	int r;
+	if (strcasecmp(spec, "auto") == 0) {
+		r = displays_discover(list);
+	} else {
+		r = 0;
+		while (*spec != '\0' && r == 0) {
+			size_t len = strcspn(spec, ",");
+			if (len > 0) r = display_list_add(list, spec, len);
+			spec += len;
+			if (*spec == ',') spec += 1;
+		}
+	}
+
+	if (r < 0) {
+		displays_free(list);
+		return -1;
+	}
+
+	if (list->count == 0) {
+		fputs(_("No displays to adjust.\n"), stderr);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+displays_free(display_list_t *list)
+{
+	for (int i = 0; i < list->count; i++) free(list->names[i]);
+	free(list->names);
+	list->names = NULL;
+	list->count = 0;
+}
+
+/* Return resident memory of this process in kilobytes, or -1 if it
+   is unknown. */
+long
+displays_get_rss(void)
+{
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f == NULL) return -1;
+
+	long size, resident;
+	int r = fscanf(f, "%ld %ld", &size, &resident);
+	fclose(f);
+	if (r != 2) return -1;
+
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+	return -1;
+#endif
+}
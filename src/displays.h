@@ -0,0 +1,36 @@
+/* displays.h -- Multiple display management header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_DISPLAYS_H
+#define REDSHIFT_DISPLAYS_H
+
+/* List of display names to serve from one process. */
+typedef struct {
+	char **names;
+	int count;
+} display_list_t;
+
+
+int displays_parse(display_list_t *list, const char *spec);
+void displays_free(display_list_t *list);
+
+long displays_get_rss(void);
+
+
+#endif /* ! REDSHIFT_DISPLAYS_H */
@@ -51,6 +51,9 @@ drm_init(drm_state_t *state)
 	state->res = NULL;
 	state->crtcs = NULL;
 
+	state->stats.round_trips = 0;
+	state->stats.bytes_sent = 0;
+
 	return 0;
 }
 
@@ -269,22 +272,24 @@ drm_set_temperature(drm_state_t *state, const color_setting_t *setting)
 			last_gamma_size = crtcs->gamma_size;
 		}
 
-		/* Initialize gamma ramps to pure state */
-		int ramp_size = crtcs->gamma_size;
-		for (int i = 0; i < ramp_size; i++) {
-			uint16_t value = (double)i/ramp_size * (UINT16_MAX+1);
-			r_gamma[i] = value;
-			g_gamma[i] = value;
-			b_gamma[i] = value;
-		}
-
-		colorramp_fill(r_gamma, g_gamma, b_gamma, crtcs->gamma_size,
-			       setting);
+		colorramp_fill_pure(r_gamma, g_gamma, b_gamma,
+				    crtcs->gamma_size, setting);
 		drmModeCrtcSetGamma(state->fd, crtcs->crtc_id, crtcs->gamma_size,
 				    r_gamma, g_gamma, b_gamma);
+
+		/* One ioctl with the lookup table header and the ramps */
+		state->stats.round_trips += 1;
+		state->stats.bytes_sent += sizeof(struct drm_mode_crtc_lut) +
+			6 * crtcs->gamma_size;
 	}
 
 	free(r_gamma);
 
 	return 0;
 }
+
+void
+drm_get_stats(drm_state_t *state, gamma_method_stats_t *stats)
+{
+	*stats = state->stats;
+}
@@ -43,6 +43,7 @@ typedef struct {
 	int fd;
 	drmModeRes* res;
 	drm_crtc_state_t* crtcs;
+	gamma_method_stats_t stats;
 } drm_state_t;
 
 
@@ -56,6 +57,7 @@ int drm_set_option(drm_state_t *state, const char *key, const char *value);
 void drm_restore(drm_state_t *state);
 int drm_set_temperature(drm_state_t *state,
 			const color_setting_t *setting);
+void drm_get_stats(drm_state_t *state, gamma_method_stats_t *stats);
 
 
 #endif /* ! REDSHIFT_GAMMA_DRM_H */
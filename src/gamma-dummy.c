@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef ENABLE_NLS
 # include <libintl.h>
@@ -27,29 +28,30 @@
 # define _(s) s
 #endif
 
-#include "redshift.h"
+#include "gamma-dummy.h"
 
 
 int
-gamma_dummy_init(void *state)
+gamma_dummy_init(gamma_dummy_state_t *state)
 {
+	state->quiet = 0;
 	return 0;
 }
 
 int
-gamma_dummy_start(void *state)
+gamma_dummy_start(gamma_dummy_state_t *state)
 {
 	fputs(_("WARNING: Using dummy gamma method! Display will not be affected by this gamma method.\n"), stderr);
 	return 0;
 }
 
 void
-gamma_dummy_restore(void *state)
+gamma_dummy_restore(gamma_dummy_state_t *state)
 {
 }
 
 void
-gamma_dummy_free(void *state)
+gamma_dummy_free(gamma_dummy_state_t *state)
 {
 }
 
@@ -58,18 +60,35 @@ gamma_dummy_print_help(FILE *f)
 {
 	fputs(_("Does not affect the display but prints the color temperature to the terminal.\n"), f);
 	fputs("\n", f);
+
+	/* TRANSLATORS: Dummy help output
+	   left column must not be translated */
+	fputs(_("  quiet=1\tDo not print the color temperature\n"), f);
+	fputs("\n", f);
 }
 
 int
-gamma_dummy_set_option(void *state, const char *key, const char *value)
+gamma_dummy_set_option(gamma_dummy_state_t *state, const char *key,
+		       const char *value)
 {
+	/* Accepted so the dummy method can stand in for the X methods
+	   when serving several displays. */
+	if (strcasecmp(key, "display") == 0) return 0;
+
+	if (strcasecmp(key, "quiet") == 0) {
+		state->quiet = atoi(value);
+		return 0;
+	}
+
 	fprintf(stderr, _("Unknown method parameter: `%s'.\n"), key);
 	return -1;
 }
 
 int
-gamma_dummy_set_temperature(void *state, const color_setting_t *setting)
+gamma_dummy_set_temperature(gamma_dummy_state_t *state,
+			    const color_setting_t *setting)
 {
+	if (state->quiet) return 0;
 	printf(_("Temperature: %i\n"), setting->temperature);
 	return 0;
 }
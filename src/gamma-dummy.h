@@ -23,15 +23,21 @@
 #include "redshift.h"
 
 
-int gamma_dummy_init(void *state);
-int gamma_dummy_start(void *state);
-void gamma_dummy_free(void *state);
+typedef struct {
+	int quiet;
+} gamma_dummy_state_t;
+
+
+int gamma_dummy_init(gamma_dummy_state_t *state);
+int gamma_dummy_start(gamma_dummy_state_t *state);
+void gamma_dummy_free(gamma_dummy_state_t *state);
 
 void gamma_dummy_print_help(FILE *f);
-int gamma_dummy_set_option(void *state, const char *key, const char *value);
+int gamma_dummy_set_option(gamma_dummy_state_t *state, const char *key,
+			   const char *value);
 
-void gamma_dummy_restore(void *state);
-int gamma_dummy_set_temperature(void *state,
+void gamma_dummy_restore(gamma_dummy_state_t *state);
+int gamma_dummy_set_temperature(gamma_dummy_state_t *state,
 				const color_setting_t *setting);
 
 
@@ -46,7 +46,11 @@ int
 randr_init(randr_state_t *state)
 {
 	/* Initialize state. */
-	state->screen_num = -1;
+	state->display_name = NULL;
+	state->conn = NULL;
+	state->all_screens = 0;
+	state->screen_num_count = 0;
+	state->screen_nums = NULL;
 	state->crtc_num = NULL;
 
 	state->crtc_num_count = 0;
@@ -55,10 +59,27 @@ randr_init(randr_state_t *state)
 
 	state->preserve = 0;
 
+	state->stats.round_trips = 0;
+	state->stats.bytes_sent = 0;
+
+	return 0;
+}
+
+int
+randr_start(randr_state_t *state)
+{
 	xcb_generic_error_t *error;
 
-	/* Open X server connection */
-	state->conn = xcb_connect(NULL, &state->preferred_screen);
+	/* Open X server connection. This is done here rather than in
+	   randr_init() so the display can be chosen with an option. */
+	state->conn = xcb_connect(state->display_name,
+				  &state->preferred_screen);
+	if (xcb_connection_has_error(state->conn)) {
+		fprintf(stderr, _("Unable to connect to X display `%s'.\n"),
+			state->display_name != NULL ?
+			state->display_name : "");
+		return -1;
+	}
 
 	/* Query RandR version */
 	xcb_randr_query_version_cookie_t ver_cookie =
@@ -73,7 +94,6 @@ randr_init(randr_state_t *state)
 		int ec = (error != 0) ? error->error_code : -1;
 		fprintf(stderr, _("`%s' returned error %d\n"),
 			"RANDR Query Version", ec);
-		xcb_disconnect(state->conn);
 		return -1;
 	}
 
@@ -82,95 +102,150 @@ randr_init(randr_state_t *state)
 		fprintf(stderr, _("Unsupported RANDR version (%u.%u)\n"),
 			ver_reply->major_version, ver_reply->minor_version);
 		free(ver_reply);
-		xcb_disconnect(state->conn);
 		return -1;
 	}
 
 	free(ver_reply);
 
-	return 0;
-}
-
-int
-randr_start(randr_state_t *state)
-{
-	xcb_generic_error_t *error;
-
-	int screen_num = state->screen_num;
-	if (screen_num < 0) screen_num = state->preferred_screen;
-
-	/* Get screen */
+	/* Select screens. Without the screen option only the default
+	   screen of the display is adjusted. */
 	const xcb_setup_t *setup = xcb_get_setup(state->conn);
-	xcb_screen_iterator_t iter = xcb_setup_roots_iterator(setup);
-	state->screen = NULL;
-
-	for (int i = 0; iter.rem > 0; i++) {
-		if (i == screen_num) {
-			state->screen = iter.data;
-			break;
-		}
-		xcb_screen_next(&iter);
+	int screen_count = xcb_setup_roots_length(setup);
+
+	int *screen_nums = state->screen_nums;
+	int count = state->screen_num_count;
+	if (state->all_screens) {
+		count = screen_count;
+		screen_nums = NULL;
+	} else if (count == 0) {
+		count = 1;
+		screen_nums = &state->preferred_screen;
 	}
 
-	if (state->screen == NULL) {
-		fprintf(stderr, _("Screen %i could not be found.\n"),
-			screen_num);
+	xcb_screen_t **screens = calloc(count, sizeof(xcb_screen_t *));
+	if (screens == NULL) {
+		perror("calloc");
 		return -1;
 	}
 
-	/* Get list of CRTCs for the screen */
-	xcb_randr_get_screen_resources_current_cookie_t res_cookie =
-		xcb_randr_get_screen_resources_current(state->conn,
-						       state->screen->root);
-	xcb_randr_get_screen_resources_current_reply_t *res_reply =
-		xcb_randr_get_screen_resources_current_reply(state->conn,
-							     res_cookie,
-							     &error);
+	for (int i = 0; i < count; i++) {
+		int screen_num = screen_nums != NULL ? screen_nums[i] : i;
 
-	if (error) {
-		fprintf(stderr, _("`%s' returned error %d\n"),
-			"RANDR Get Screen Resources Current",
-			error->error_code);
-		return -1;
+		xcb_screen_iterator_t iter = xcb_setup_roots_iterator(setup);
+		for (int j = 0; iter.rem > 0; j++) {
+			if (j == screen_num) {
+				screens[i] = iter.data;
+				break;
+			}
+			xcb_screen_next(&iter);
+		}
+
+		if (screens[i] == NULL) {
+			fprintf(stderr, _("Screen %i could not be found.\n"),
+				screen_num);
+			free(screens);
+			return -1;
+		}
 	}
 
-	state->crtc_count = res_reply->num_crtcs;
-	state->crtcs = calloc(state->crtc_count, sizeof(randr_crtc_state_t));
-	if (state->crtcs == NULL) {
+	/* Get list of CRTCs for all screens. Every request is sent
+	   before waiting for the first reply so the number of round
+	   trips does not grow with the number of screens. */
+	xcb_randr_get_screen_resources_current_cookie_t *res_cookies =
+		malloc(count * sizeof(*res_cookies));
+	if (res_cookies == NULL) {
 		perror("malloc");
-		state->crtc_count = 0;
+		free(screens);
 		return -1;
 	}
 
-	xcb_randr_crtc_t *crtcs =
-		xcb_randr_get_screen_resources_current_crtcs(res_reply);
+	for (int i = 0; i < count; i++) {
+		res_cookies[i] = xcb_randr_get_screen_resources_current(
+			state->conn, screens[i]->root);
+	}
 
-	/* Save CRTC identifier in state */
-	for (int i = 0; i < state->crtc_count; i++) {
-		state->crtcs[i].crtc = crtcs[i];
+	free(screens);
+
+	for (int i = 0; i < count; i++) {
+		xcb_randr_get_screen_resources_current_reply_t *res_reply =
+			xcb_randr_get_screen_resources_current_reply(
+				state->conn, res_cookies[i], &error);
+
+		if (error) {
+			fprintf(stderr, _("`%s' returned error %d\n"),
+				"RANDR Get Screen Resources Current",
+				error->error_code);
+			free(res_cookies);
+			return -1;
+		}
+
+		int num_crtcs = res_reply->num_crtcs;
+		randr_crtc_state_t *crtcs =
+			realloc(state->crtcs, (state->crtc_count + num_crtcs) *
+				sizeof(randr_crtc_state_t));
+		if (crtcs == NULL) {
+			perror("realloc");
+			free(res_reply);
+			free(res_cookies);
+			return -1;
+		}
+		state->crtcs = crtcs;
+
+		xcb_randr_crtc_t *res_crtcs =
+			xcb_randr_get_screen_resources_current_crtcs(res_reply);
+
+		/* Save CRTC identifier in state */
+		for (int j = 0; j < num_crtcs; j++) {
+			randr_crtc_state_t *crtc =
+				&state->crtcs[state->crtc_count++];
+			crtc->crtc = res_crtcs[j];
+			crtc->ramp_size = 0;
+			crtc->saved_ramps = NULL;
+		}
+
+		free(res_reply);
 	}
 
-	free(res_reply);
+	free(res_cookies);
 
 	/* Save size and gamma ramps of all CRTCs.
 	   Current gamma ramps are saved so we can restore them
-	   at program exit. */
+	   at program exit. Again, all requests are sent up front. */
+	xcb_randr_get_crtc_gamma_size_cookie_t *size_cookies =
+		malloc(state->crtc_count * sizeof(*size_cookies));
+	xcb_randr_get_crtc_gamma_cookie_t *gamma_cookies =
+		malloc(state->crtc_count * sizeof(*gamma_cookies));
+	if ((size_cookies == NULL || gamma_cookies == NULL) &&
+	    state->crtc_count > 0) {
+		perror("malloc");
+		free(size_cookies);
+		free(gamma_cookies);
+		return -1;
+	}
+
 	for (int i = 0; i < state->crtc_count; i++) {
 		xcb_randr_crtc_t crtc = state->crtcs[i].crtc;
+		size_cookies[i] = xcb_randr_get_crtc_gamma_size(state->conn,
+								crtc);
+		gamma_cookies[i] = xcb_randr_get_crtc_gamma(state->conn,
+							    crtc);
+	}
 
-		/* Request size of gamma ramps */
-		xcb_randr_get_crtc_gamma_size_cookie_t gamma_size_cookie =
-			xcb_randr_get_crtc_gamma_size(state->conn, crtc);
+	int r = 0;
+	for (int i = 0; i < state->crtc_count && r == 0; i++) {
+		r = -1;
+
+		/* Size of gamma ramps */
 		xcb_randr_get_crtc_gamma_size_reply_t *gamma_size_reply =
 			xcb_randr_get_crtc_gamma_size_reply(state->conn,
-							    gamma_size_cookie,
+							    size_cookies[i],
 							    &error);
 
 		if (error) {
 			fprintf(stderr, _("`%s' returned error %d\n"),
 				"RANDR Get CRTC Gamma Size",
 				error->error_code);
-			return -1;
+			break;
 		}
 
 		unsigned int ramp_size = gamma_size_reply->size;
@@ -181,21 +256,19 @@ randr_start(randr_state_t *state)
 		if (ramp_size == 0) {
 			fprintf(stderr, _("Gamma ramp size too small: %i\n"),
 				ramp_size);
-			return -1;
+			break;
 		}
 
-		/* Request current gamma ramps */
-		xcb_randr_get_crtc_gamma_cookie_t gamma_get_cookie =
-			xcb_randr_get_crtc_gamma(state->conn, crtc);
+		/* Current gamma ramps */
 		xcb_randr_get_crtc_gamma_reply_t *gamma_get_reply =
 			xcb_randr_get_crtc_gamma_reply(state->conn,
-						       gamma_get_cookie,
+						       gamma_cookies[i],
 						       &error);
 
 		if (error) {
 			fprintf(stderr, _("`%s' returned error %d\n"),
 				"RANDR Get CRTC Gamma", error->error_code);
-			return -1;
+			break;
 		}
 
 		uint16_t *gamma_r =
@@ -211,7 +284,7 @@ randr_start(randr_state_t *state)
 		if (state->crtcs[i].saved_ramps == NULL) {
 			perror("malloc");
 			free(gamma_get_reply);
-			return -1;
+			break;
 		}
 
 		/* Copy gamma ramps into CRTC state */
@@ -223,15 +296,62 @@ randr_start(randr_state_t *state)
 		       ramp_size*sizeof(uint16_t));
 
 		free(gamma_get_reply);
+		r = 0;
 	}
 
-	return 0;
+	free(size_cookies);
+	free(gamma_cookies);
+
+	return r;
+}
+
+/* Wait for the results of COUNT gamma updates sent in one batch.
+   Only the first check waits for the server; the remaining results
+   arrive with the same round trip. */
+static int
+randr_check_batch(randr_state_t *state, const xcb_void_cookie_t *cookies,
+		  const int *crtc_nums, int count)
+{
+	int r = 0;
+	for (int i = 0; i < count; i++) {
+		xcb_generic_error_t *error =
+			xcb_request_check(state->conn, cookies[i]);
+		if (error) {
+			fprintf(stderr, _("`%s' returned error %d\n"),
+				"RANDR Set CRTC Gamma", error->error_code);
+			fprintf(stderr, _("Unable to set CRTC %i\n"),
+				crtc_nums[i]);
+			free(error);
+			r = -1;
+		}
+	}
+
+	/* A lost connection makes every check above return no error,
+	   so report it separately. */
+	if (xcb_connection_has_error(state->conn)) {
+		fprintf(stderr, _("Lost connection to X display `%s'.\n"),
+			state->display_name != NULL ?
+			state->display_name : "");
+		r = -1;
+	}
+
+	return r;
 }
 
 void
 randr_restore(randr_state_t *state)
 {
-	xcb_generic_error_t *error;
+	if (state->crtc_count == 0) return;
+
+	xcb_void_cookie_t *cookies =
+		malloc(state->crtc_count * sizeof(xcb_void_cookie_t));
+	int *crtc_nums = malloc(state->crtc_count * sizeof(int));
+	if (cookies == NULL || crtc_nums == NULL) {
+		perror("malloc");
+		free(cookies);
+		free(crtc_nums);
+		return;
+	}
 
 	/* Restore CRTC gamma ramps */
 	for (int i = 0; i < state->crtc_count; i++) {
@@ -243,18 +363,17 @@ randr_restore(randr_state_t *state)
 		uint16_t *gamma_b = &state->crtcs[i].saved_ramps[2*ramp_size];
 
 		/* Set gamma ramps */
-		xcb_void_cookie_t gamma_set_cookie =
-			xcb_randr_set_crtc_gamma_checked(state->conn, crtc,
-							 ramp_size, gamma_r,
-							 gamma_g, gamma_b);
-		error = xcb_request_check(state->conn, gamma_set_cookie);
-
-		if (error) {
-			fprintf(stderr, _("`%s' returned error %d\n"),
-				"RANDR Set CRTC Gamma", error->error_code);
-			fprintf(stderr, _("Unable to restore CRTC %i\n"), i);
-		}
+		cookies[i] = xcb_randr_set_crtc_gamma_checked(state->conn,
+							      crtc, ramp_size,
+							      gamma_r, gamma_g,
+							      gamma_b);
+		crtc_nums[i] = i;
 	}
+
+	randr_check_batch(state, cookies, crtc_nums, state->crtc_count);
+
+	free(cookies);
+	free(crtc_nums);
 }
 
 void
@@ -266,9 +385,11 @@ randr_free(randr_state_t *state)
 	}
 	free(state->crtcs);
 	free(state->crtc_num);
+	free(state->screen_nums);
+	free(state->display_name);
 
 	/* Close connection */
-	xcb_disconnect(state->conn);
+	if (state->conn != NULL) xcb_disconnect(state->conn);
 }
 
 void
@@ -279,7 +400,9 @@ randr_print_help(FILE *f)
 
 	/* TRANSLATORS: RANDR help output
 	   left column must not be translated */
-	fputs(_("  screen=N\t\tX screen to apply adjustments to\n"
+	fputs(_("  display=NAME\tX display to connect to\n"
+		"  screen=N\t\tList of comma separated X screens to apply\n"
+		"  \t\tadjustments to, or `all'\n"
 		"  crtc=N\tList of comma separated CRTCs to apply adjustments to\n"
 		"  preserve={0,1}\tWhether existing gamma should be"
 		" preserved\n"),
@@ -290,8 +413,48 @@ randr_print_help(FILE *f)
 int
 randr_set_option(randr_state_t *state, const char *key, const char *value)
 {
-	if (strcasecmp(key, "screen") == 0) {
-		state->screen_num = atoi(value);
+	if (strcasecmp(key, "display") == 0) {
+		free(state->display_name);
+		state->display_name = strdup(value);
+		if (state->display_name == NULL) {
+			perror("strdup");
+			return -1;
+		}
+	} else if (strcasecmp(key, "screen") == 0) {
+		free(state->screen_nums);
+		state->screen_nums = NULL;
+		state->screen_num_count = 0;
+		state->all_screens = strcasecmp(value, "all") == 0;
+		if (state->all_screens) return 0;
+
+		const char *local_value = value;
+		while (1) {
+			char *tail;
+			errno = 0;
+			long parsed = strtol(local_value, &tail, 0);
+			if (errno != 0 || tail == local_value || parsed < 0) {
+				fprintf(stderr, _("Unable to read screen"
+						  " number: `%s'.\n"), value);
+				return -1;
+			}
+
+			int *nums = realloc(state->screen_nums,
+					    (state->screen_num_count + 1) *
+					    sizeof(int));
+			if (nums == NULL) {
+				perror("realloc");
+				return -1;
+			}
+			state->screen_nums = nums;
+			state->screen_nums[state->screen_num_count++] = parsed;
+
+			local_value = tail;
+			if (*local_value == ',') {
+				local_value += 1;
+			} else {
+				break;
+			}
+		}
 	} else if (strcasecmp(key, "crtc") == 0) {
 		char *tail;
 
@@ -347,96 +510,97 @@ randr_set_option(randr_state_t *state, const char *key, const char *value)
 	return 0;
 }
 
-static int
-randr_set_temperature_for_crtc(randr_state_t *state, int crtc_num,
-			       const color_setting_t *setting)
+int
+randr_set_temperature(randr_state_t *state,
+		      const color_setting_t *setting)
 {
-	xcb_generic_error_t *error;
+	/* If no CRTC numbers have been specified,
+	   set temperature on all CRTCs. */
+	int count = state->crtc_num_count;
+	if (count == 0) count = state->crtc_count;
+	if (count == 0) return 0;
+
+	unsigned int max_ramp_size = 0;
+	for (int i = 0; i < count; i++) {
+		int crtc_num = state->crtc_num_count == 0 ? i :
+			state->crtc_num[i];
+		if (crtc_num >= state->crtc_count || crtc_num < 0) {
+			fprintf(stderr, _("CRTC %d does not exist. "),
+				crtc_num);
+			if (state->crtc_count > 1) {
+				fprintf(stderr, _("Valid CRTCs are [0-%d].\n"),
+					state->crtc_count-1);
+			} else {
+				fprintf(stderr, _("Only CRTC 0 exists.\n"));
+			}
 
-	if (crtc_num >= state->crtc_count || crtc_num < 0) {
-		fprintf(stderr, _("CRTC %d does not exist. "),
-			crtc_num);
-		if (state->crtc_count > 1) {
-			fprintf(stderr, _("Valid CRTCs are [0-%d].\n"),
-				state->crtc_count-1);
-		} else {
-			fprintf(stderr, _("Only CRTC 0 exists.\n"));
+			return -1;
 		}
 
-		return -1;
+		if (state->crtcs[crtc_num].ramp_size > max_ramp_size) {
+			max_ramp_size = state->crtcs[crtc_num].ramp_size;
+		}
 	}
 
-	xcb_randr_crtc_t crtc = state->crtcs[crtc_num].crtc;
-	unsigned int ramp_size = state->crtcs[crtc_num].ramp_size;
-
-	/* Create new gamma ramps */
-	uint16_t *gamma_ramps = malloc(3*ramp_size*sizeof(uint16_t));
-	if (gamma_ramps == NULL) {
+	/* The request data is copied by xcb when the request is
+	   queued, so a single buffer serves all CRTCs. */
+	uint16_t *gamma_ramps = malloc(3*max_ramp_size*sizeof(uint16_t));
+	xcb_void_cookie_t *cookies = malloc(count * sizeof(xcb_void_cookie_t));
+	int *crtc_nums = malloc(count * sizeof(int));
+	if (gamma_ramps == NULL || cookies == NULL || crtc_nums == NULL) {
 		perror("malloc");
+		free(gamma_ramps);
+		free(cookies);
+		free(crtc_nums);
 		return -1;
 	}
 
-	uint16_t *gamma_r = &gamma_ramps[0*ramp_size];
-	uint16_t *gamma_g = &gamma_ramps[1*ramp_size];
-	uint16_t *gamma_b = &gamma_ramps[2*ramp_size];
-
-	if (state->preserve) {
-		/* Initialize gamma ramps from saved state */
-		memcpy(gamma_ramps, state->crtcs[crtc_num].saved_ramps,
-		       3*ramp_size*sizeof(uint16_t));
-	} else {
-		/* Initialize gamma ramps to pure state */
-		for (int i = 0; i < ramp_size; i++) {
-			uint16_t value = (double)i/ramp_size * (UINT16_MAX+1);
-			gamma_r[i] = value;
-			gamma_g[i] = value;
-			gamma_b[i] = value;
+	/* Queue updates of every CRTC on every screen and wait for
+	   them together. */
+	for (int i = 0; i < count; i++) {
+		int crtc_num = state->crtc_num_count == 0 ? i :
+			state->crtc_num[i];
+		xcb_randr_crtc_t crtc = state->crtcs[crtc_num].crtc;
+		unsigned int ramp_size = state->crtcs[crtc_num].ramp_size;
+
+		uint16_t *gamma_r = &gamma_ramps[0*ramp_size];
+		uint16_t *gamma_g = &gamma_ramps[1*ramp_size];
+		uint16_t *gamma_b = &gamma_ramps[2*ramp_size];
+
+		if (state->preserve) {
+			/* Initialize gamma ramps from saved state */
+			memcpy(gamma_ramps, state->crtcs[crtc_num].saved_ramps,
+			       3*ramp_size*sizeof(uint16_t));
+			colorramp_fill(gamma_r, gamma_g, gamma_b, ramp_size,
+				       setting);
+		} else {
+			colorramp_fill_pure(gamma_r, gamma_g, gamma_b,
+					    ramp_size, setting);
 		}
-	}
 
-	colorramp_fill(gamma_r, gamma_g, gamma_b, ramp_size,
-		       setting);
+		/* Set new gamma ramps */
+		cookies[i] = xcb_randr_set_crtc_gamma_checked(state->conn,
+							      crtc, ramp_size,
+							      gamma_r, gamma_g,
+							      gamma_b);
+		crtc_nums[i] = crtc_num;
 
-	/* Set new gamma ramps */
-	xcb_void_cookie_t gamma_set_cookie =
-		xcb_randr_set_crtc_gamma_checked(state->conn, crtc,
-						 ramp_size, gamma_r,
-						 gamma_g, gamma_b);
-	error = xcb_request_check(state->conn, gamma_set_cookie);
-
-	if (error) {
-		fprintf(stderr, _("`%s' returned error %d\n"),
-			"RANDR Set CRTC Gamma", error->error_code);
-		free(gamma_ramps);
-		return -1;
+		/* Request header and three ramps padded to four bytes */
+		state->stats.bytes_sent += 12 + ((6*ramp_size + 3) & ~3);
 	}
 
+	int r = randr_check_batch(state, cookies, crtc_nums, count);
+	state->stats.round_trips += 1;
+
 	free(gamma_ramps);
+	free(cookies);
+	free(crtc_nums);
 
-	return 0;
+	return r;
 }
 
-int
-randr_set_temperature(randr_state_t *state,
-		      const color_setting_t *setting)
+void
+randr_get_stats(randr_state_t *state, gamma_method_stats_t *stats)
 {
-	int r;
-
-	/* If no CRTC numbers have been specified,
-	   set temperature on all CRTCs. */
-	if (state->crtc_num_count == 0) {
-		for (int i = 0; i < state->crtc_count; i++) {
-			r = randr_set_temperature_for_crtc(state, i,
-							   setting);
-			if (r < 0) return -1;
-		}
-	} else {
-		for (int i = 0; i < state->crtc_num_count; ++i) {
-			r = randr_set_temperature_for_crtc(
-				state, state->crtc_num[i], setting);
-			if (r < 0) return -1;
-		}
-	}
-
-	return 0;
+	*stats = state->stats;
 }
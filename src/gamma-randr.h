@@ -36,15 +36,18 @@ typedef struct {
 } randr_crtc_state_t;
 
 typedef struct {
+	char *display_name;
 	xcb_connection_t *conn;
-	xcb_screen_t *screen;
 	int preferred_screen;
 	int preserve;
-	int screen_num;
+	int all_screens;
+	int screen_num_count;
+	int *screen_nums;
 	int crtc_num_count;
 	int* crtc_num;
 	unsigned int crtc_count;
 	randr_crtc_state_t *crtcs;
+	gamma_method_stats_t stats;
 } randr_state_t;
 
 
@@ -58,6 +61,7 @@ int randr_set_option(randr_state_t *state, const char *key, const char *value);
 void randr_restore(randr_state_t *state);
 int randr_set_temperature(randr_state_t *state,
 			  const color_setting_t *setting);
+void randr_get_stats(randr_state_t *state, gamma_method_stats_t *stats);
 
 
 #endif /* ! REDSHIFT_GAMMA_RANDR_H */
@@ -0,0 +1,342 @@
+/* gamma-shm.c -- Shared memory gamma publishing source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#ifndef O_CLOEXEC
+# define O_CLOEXEC  02000000
+#endif
+
+#include "gamma-shm.h"
+#include "colorramp.h"
+
+#define DEFAULT_RAMP_SIZE  1024
+#define MAX_RAMP_SIZE  65536
+#define MAX_OUTPUTS  64
+
+#define NEUTRAL_TEMP  6500
+
+/* Ramps start on cache line boundaries. */
+#define RAMP_ALIGN  64
+
+#define MAX_SHM_PATH  4096
+
+
+/* Order stores to the mapping as seen by other processes. */
+#if defined(__GNUC__)
+# define write_barrier()  __sync_synchronize()
+#else
+# define write_barrier()
+#endif
+
+
+int
+gamma_shm_init(gamma_shm_state_t *state)
+{
+	state->path = NULL;
+	state->display = NULL;
+	state->output_count = 1;
+	state->ramp_size = DEFAULT_RAMP_SIZE;
+
+	state->fd = -1;
+	state->map = NULL;
+	state->map_size = 0;
+	state->header = NULL;
+
+	state->stats.round_trips = 0;
+	state->stats.bytes_sent = 0;
+
+	return 0;
+}
+
+static redshift_shm_output_t *
+get_output(gamma_shm_state_t *state, int index)
+{
+	return (redshift_shm_output_t *)((char *)state->map +
+					 sizeof(redshift_shm_header_t)) +
+		index;
+}
+
+static uint16_t *
+get_ramps(gamma_shm_state_t *state, int index)
+{
+	return (uint16_t *)((char *)state->map +
+			    get_output(state, index)->offset);
+}
+
+/* Default path in the runtime directory, one file per display. */
+static int
+get_default_path(gamma_shm_state_t *state)
+{
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+	if (dir == NULL || dir[0] == '\0') {
+		fputs(_("XDG_RUNTIME_DIR is not set; use the path"
+			" option.\n"), stderr);
+		return -1;
+	}
+
+	char path[MAX_SHM_PATH];
+	if (state->display != NULL) {
+		snprintf(path, sizeof(path), "%s/redshift-gamma-%s", dir,
+			 state->display);
+	} else {
+		snprintf(path, sizeof(path), "%s/redshift-gamma", dir);
+	}
+
+	state->path = strdup(path);
+	if (state->path == NULL) {
+		perror("strdup");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+gamma_shm_start(gamma_shm_state_t *state)
+{
+	if (state->path == NULL && get_default_path(state) < 0) return -1;
+
+	size_t offset = sizeof(redshift_shm_header_t) +
+		state->output_count * sizeof(redshift_shm_output_t);
+	size_t ramps_size = 3 * state->ramp_size * sizeof(uint16_t);
+	size_t first_ramp = (offset + RAMP_ALIGN - 1) & ~(RAMP_ALIGN - 1);
+	size_t stride = (ramps_size + RAMP_ALIGN - 1) & ~(RAMP_ALIGN - 1);
+	state->map_size = first_ramp + state->output_count * stride;
+
+	/* The file is set up under a temporary name and renamed into
+	   place, so consumers never see it half initialized and those
+	   still mapping a previous file keep a valid mapping. */
+	char tmp_path[MAX_SHM_PATH];
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX",
+		     state->path) >= (int)sizeof(tmp_path)) {
+		fprintf(stderr, _("Path is too long: %s\n"), state->path);
+		return -1;
+	}
+
+	state->fd = mkstemp(tmp_path);
+	if (state->fd < 0) {
+		perror(tmp_path);
+		return -1;
+	}
+	fcntl(state->fd, F_SETFD, FD_CLOEXEC);
+
+	if (fchmod(state->fd, 0644) < 0 ||
+	    ftruncate(state->fd, state->map_size) < 0) {
+		perror("ftruncate");
+		unlink(tmp_path);
+		return -1;
+	}
+
+	state->map = mmap(NULL, state->map_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED, state->fd, 0);
+	if (state->map == MAP_FAILED) {
+		perror("mmap");
+		state->map = NULL;
+		unlink(tmp_path);
+		return -1;
+	}
+
+	redshift_shm_header_t *header = state->map;
+	state->header = header;
+
+	header->magic = REDSHIFT_SHM_MAGIC;
+	header->version = REDSHIFT_SHM_VERSION;
+	header->header_size = sizeof(redshift_shm_header_t);
+	header->output_count = state->output_count;
+	header->output_size = sizeof(redshift_shm_output_t);
+	header->generation = 0;
+
+	for (int i = 0; i < state->output_count; i++) {
+		redshift_shm_output_t *output = get_output(state, i);
+		output->ramp_size = state->ramp_size;
+		output->offset = first_ramp + i * stride;
+	}
+
+	gamma_shm_restore(state);
+
+	if (rename(tmp_path, state->path) < 0) {
+		perror(state->path);
+		unlink(tmp_path);
+		munmap(state->map, state->map_size);
+		state->map = NULL;
+		state->header = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+gamma_shm_free(gamma_shm_state_t *state)
+{
+	if (state->map != NULL) {
+		munmap(state->map, state->map_size);
+		state->map = NULL;
+		state->header = NULL;
+
+		/* Consumers keep their mapping; new ones should not find
+		   a file that is no longer updated. */
+		unlink(state->path);
+	}
+
+	if (state->fd >= 0) {
+		close(state->fd);
+		state->fd = -1;
+	}
+
+	free(state->path);
+	state->path = NULL;
+	free(state->display);
+	state->display = NULL;
+}
+
+void
+gamma_shm_print_help(FILE *f)
+{
+	fputs(_("Publish gamma ramps in shared memory for compositors"
+		" and other consumers.\n"), f);
+	fputs("\n", f);
+
+	/* TRANSLATORS: Shm help output
+	   left column must not be translated */
+	fputs(_("  path=PATH\tFile to publish the ramps in (default"
+		" $XDG_RUNTIME_DIR/redshift-gamma)\n"
+		"  outputs=N\tNumber of outputs (default 1)\n"
+		"  size=N\tGamma ramp size of the outputs (default 1024)\n"),
+	      f);
+	fputs("\n", f);
+	fputs(_("The layout of the file is described in"
+		" redshift/redshift-shm.h.\n"), f);
+	fputs("\n", f);
+}
+
+int
+gamma_shm_set_option(gamma_shm_state_t *state, const char *key,
+		     const char *value)
+{
+	if (strcasecmp(key, "path") == 0) {
+		free(state->path);
+		state->path = strdup(value);
+		if (state->path == NULL) {
+			perror("strdup");
+			return -1;
+		}
+	} else if (strcasecmp(key, "display") == 0) {
+		free(state->display);
+		state->display = strdup(value);
+		if (state->display == NULL) {
+			perror("strdup");
+			return -1;
+		}
+	} else if (strcasecmp(key, "outputs") == 0) {
+		state->output_count = atoi(value);
+		if (state->output_count < 1 ||
+		    state->output_count > MAX_OUTPUTS) {
+			fprintf(stderr, _("Number of outputs must be between"
+					  " 1 and %d.\n"), MAX_OUTPUTS);
+			return -1;
+		}
+	} else if (strcasecmp(key, "size") == 0) {
+		state->ramp_size = atoi(value);
+		if (state->ramp_size < 2 ||
+		    state->ramp_size > MAX_RAMP_SIZE) {
+			fprintf(stderr, _("Gamma ramp size must be between"
+					  " 2 and %d.\n"), MAX_RAMP_SIZE);
+			return -1;
+		}
+	} else {
+		fprintf(stderr, _("Unknown method parameter: `%s'.\n"), key);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Publish SETTING. The ramps are computed in place, so consumers
+   reading the mapping get them without another copy. */
+static void
+publish(gamma_shm_state_t *state, const color_setting_t *setting)
+{
+	redshift_shm_header_t *header = state->header;
+
+	header->generation += 1;
+	write_barrier();
+
+	header->temperature = setting->temperature;
+	header->brightness = setting->brightness;
+	memcpy(header->gamma, setting->gamma, sizeof(header->gamma));
+
+	int size = state->ramp_size;
+	for (int i = 0; i < state->output_count; i++) {
+		uint16_t *ramps = get_ramps(state, i);
+		colorramp_fill_pure(&ramps[0], &ramps[size], &ramps[2*size],
+				    size, setting);
+	}
+
+	write_barrier();
+	header->generation += 1;
+
+	state->stats.bytes_sent += sizeof(redshift_shm_header_t) +
+		state->output_count * 3 * size * sizeof(uint16_t);
+}
+
+void
+gamma_shm_restore(gamma_shm_state_t *state)
+{
+	if (state->header == NULL) return;
+
+	/* Neutral setting gives identity ramps. */
+	color_setting_t neutral = { NEUTRAL_TEMP, { 1.0, 1.0, 1.0 }, 1.0 };
+	publish(state, &neutral);
+}
+
+int
+gamma_shm_set_temperature(gamma_shm_state_t *state,
+			  const color_setting_t *setting)
+{
+	publish(state, setting);
+	return 0;
+}
+
+void
+gamma_shm_get_stats(gamma_shm_state_t *state, gamma_method_stats_t *stats)
+{
+	*stats = state->stats;
+}
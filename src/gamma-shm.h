@@ -0,0 +1,60 @@
+/* gamma-shm.h -- Shared memory gamma publishing header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_GAMMA_SHM_H
+#define REDSHIFT_GAMMA_SHM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "redshift.h"
+#include "redshift-shm.h"
+
+
+typedef struct {
+	char *path;
+	char *display;
+	int output_count;
+	int ramp_size;
+
+	int fd;
+	void *map;
+	size_t map_size;
+	redshift_shm_header_t *header;
+
+	gamma_method_stats_t stats;
+} gamma_shm_state_t;
+
+
+int gamma_shm_init(gamma_shm_state_t *state);
+int gamma_shm_start(gamma_shm_state_t *state);
+void gamma_shm_free(gamma_shm_state_t *state);
+
+void gamma_shm_print_help(FILE *f);
+int gamma_shm_set_option(gamma_shm_state_t *state, const char *key,
+			 const char *value);
+
+void gamma_shm_restore(gamma_shm_state_t *state);
+int gamma_shm_set_temperature(gamma_shm_state_t *state,
+			      const color_setting_t *setting);
+void gamma_shm_get_stats(gamma_shm_state_t *state,
+			 gamma_method_stats_t *stats);
+
+
+#endif /* ! REDSHIFT_GAMMA_SHM_H */
@@ -0,0 +1,320 @@
+/* gamma-sim.c -- Simulated gamma adjustment source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "gamma-sim.h"
+#include "colorramp.h"
+#include "systemtime.h"
+
+#define DEFAULT_RAMP_SIZE  256
+#define MAX_RAMP_SIZE  65536
+
+/* Mismatches beyond this are only counted. */
+#define MAX_REPORTED_MISMATCHES  5
+
+
+int
+gamma_sim_init(gamma_sim_state_t *state)
+{
+	state->crtc_count = 1;
+	state->sizes[0] = DEFAULT_RAMP_SIZE;
+	state->size_count = 1;
+	state->latency = 0.0;
+	state->jitter = 0.0;
+	state->failure_rate = 0.0;
+	state->seed = 1;
+	state->validate = 1;
+
+	state->crtcs = NULL;
+	state->reference = NULL;
+
+	state->failures = 0;
+	state->mismatches = 0;
+	state->stats.round_trips = 0;
+	state->stats.bytes_sent = 0;
+
+	return 0;
+}
+
+int
+gamma_sim_start(gamma_sim_state_t *state)
+{
+	/* Spread small seeds over all bits, xorshift starts slowly
+	   from values with few bits set. */
+	state->seed *= 2654435761u;
+	if (state->seed == 0) state->seed = 1;
+
+	state->crtcs = calloc(state->crtc_count, sizeof(gamma_sim_crtc_t));
+	if (state->crtcs == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	/* Sizes are assigned to the CRTCs in turn. CRTCs start out
+	   with identity ramps which are restored at exit. */
+	int max_size = 0;
+	for (int i = 0; i < state->crtc_count; i++) {
+		gamma_sim_crtc_t *crtc = &state->crtcs[i];
+		crtc->size = state->sizes[i % state->size_count];
+		crtc->ramps = malloc(6 * crtc->size * sizeof(uint16_t));
+		if (crtc->ramps == NULL) {
+			perror("malloc");
+			return -1;
+		}
+		crtc->saved = crtc->ramps + 3 * crtc->size;
+
+		for (int j = 0; j < crtc->size; j++) {
+			uint16_t value = (double)j/crtc->size * (UINT16_MAX+1);
+			crtc->saved[j] = value;
+			crtc->saved[crtc->size + j] = value;
+			crtc->saved[2*crtc->size + j] = value;
+		}
+		memcpy(crtc->ramps, crtc->saved,
+		       3 * crtc->size * sizeof(uint16_t));
+
+		if (crtc->size > max_size) max_size = crtc->size;
+	}
+
+	state->reference = malloc(3 * max_size * sizeof(uint16_t));
+	if (state->reference == NULL) {
+		perror("malloc");
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+gamma_sim_free(gamma_sim_state_t *state)
+{
+	if (state->crtcs != NULL) {
+		for (int i = 0; i < state->crtc_count; i++) {
+			free(state->crtcs[i].ramps);
+		}
+		free(state->crtcs);
+		state->crtcs = NULL;
+	}
+
+	free(state->reference);
+	state->reference = NULL;
+
+	if (state->mismatches > 0 || state->failures > 0) {
+		fprintf(stderr, _("Simulated CRTCs: %lu requests,"
+				  " %lu failed, %lu invalid ramps.\n"),
+			state->stats.round_trips, state->failures,
+			state->mismatches);
+	}
+}
+
+void
+gamma_sim_print_help(FILE *f)
+{
+	fputs(_("Simulate CRTCs for testing without a display.\n"), f);
+	fputs("\n", f);
+
+	/* TRANSLATORS: Sim help output
+	   left column must not be translated */
+	fputs(_("  crtcs=N\tNumber of CRTCs (default 1)\n"
+		"  size=N[,N...]\tGamma ramp sizes, assigned to the CRTCs in"
+		" turn\n"
+		"  latency=MS\tDelay of every request\n"
+		"  jitter=MS\tRandom variation of the delay\n"
+		"  failure=P\tProbability that a request fails; like a"
+		" lost display,\n"
+		"  \t\ta failure stops adjustment of the display\n"
+		"  seed=N\tSeed of the random variation\n"
+		"  validate={0,1}\tCheck every ramp against a reference"
+		" computation\n"),
+	      f);
+	fputs("\n", f);
+}
+
+int
+gamma_sim_set_option(gamma_sim_state_t *state, const char *key,
+		     const char *value)
+{
+	if (strcasecmp(key, "crtcs") == 0) {
+		state->crtc_count = atoi(value);
+		if (state->crtc_count < 1) {
+			fputs(_("Number of CRTCs must be positive.\n"),
+			      stderr);
+			return -1;
+		}
+	} else if (strcasecmp(key, "size") == 0) {
+		const char *s = value;
+		state->size_count = 0;
+		while (*s != '\0') {
+			char *tail;
+			long size = strtol(s, &tail, 0);
+			if (tail == s || size < 2 || size > MAX_RAMP_SIZE ||
+			    state->size_count == GAMMA_SIM_MAX_SIZES) {
+				fprintf(stderr, _("Invalid ramp sizes:"
+						  " `%s'.\n"), value);
+				return -1;
+			}
+			state->sizes[state->size_count++] = size;
+			s = *tail == ',' ? tail + 1 : tail;
+			if (*tail != ',' && *tail != '\0') {
+				fprintf(stderr, _("Invalid ramp sizes:"
+						  " `%s'.\n"), value);
+				return -1;
+			}
+		}
+		if (state->size_count == 0) {
+			fprintf(stderr, _("Invalid ramp sizes: `%s'.\n"),
+				value);
+			return -1;
+		}
+	} else if (strcasecmp(key, "latency") == 0) {
+		state->latency = atof(value) / 1000.0;
+	} else if (strcasecmp(key, "jitter") == 0) {
+		state->jitter = atof(value) / 1000.0;
+	} else if (strcasecmp(key, "failure") == 0) {
+		state->failure_rate = atof(value);
+	} else if (strcasecmp(key, "seed") == 0) {
+		state->seed = strtoul(value, NULL, 0);
+		if (state->seed == 0) state->seed = 1;
+	} else if (strcasecmp(key, "validate") == 0) {
+		state->validate = atoi(value);
+	} else if (strcasecmp(key, "display") == 0) {
+		/* Accepted so the method can stand in for the X methods
+		   when serving several displays. */
+	} else {
+		fprintf(stderr, _("Unknown method parameter: `%s'.\n"), key);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+gamma_sim_restore(gamma_sim_state_t *state)
+{
+	for (int i = 0; i < state->crtc_count; i++) {
+		gamma_sim_crtc_t *crtc = &state->crtcs[i];
+		memcpy(crtc->ramps, crtc->saved,
+		       3 * crtc->size * sizeof(uint16_t));
+	}
+}
+
+/* Uniform random number in [0, 1) (xorshift32), reproducible from the
+   seed option. */
+static double
+sim_random(gamma_sim_state_t *state)
+{
+	uint32_t x = state->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	state->seed = x;
+	return (x - 1) / 4294967296.0;
+}
+
+/* Compare the ramps submitted to CRTC with a fresh computation from
+   the identity ramp, bypassing the ramp cache. */
+static int
+validate_ramps(gamma_sim_state_t *state, int index,
+	       const gamma_sim_crtc_t *crtc, const color_setting_t *setting)
+{
+	int size = crtc->size;
+	uint16_t *ref = state->reference;
+	for (int i = 0; i < size; i++) {
+		uint16_t value = (double)i/size * (UINT16_MAX+1);
+		ref[i] = value;
+		ref[size + i] = value;
+		ref[2*size + i] = value;
+	}
+	colorramp_fill(&ref[0], &ref[size], &ref[2*size], size, setting);
+
+	if (memcmp(ref, crtc->ramps, 3 * size * sizeof(uint16_t)) == 0) {
+		return 0;
+	}
+
+	state->mismatches += 1;
+	if (state->mismatches <= MAX_REPORTED_MISMATCHES) {
+		for (int i = 0; i < 3 * size; i++) {
+			if (ref[i] == crtc->ramps[i]) continue;
+			fprintf(stderr, _("CRTC %d received an invalid ramp"
+					  " for %dK: entry %d is %u instead"
+					  " of %u.\n"),
+				index, setting->temperature, i,
+				crtc->ramps[i], ref[i]);
+			break;
+		}
+	}
+
+	return -1;
+}
+
+int
+gamma_sim_set_temperature(gamma_sim_state_t *state,
+			  const color_setting_t *setting)
+{
+	int r = 0;
+
+	for (int i = 0; i < state->crtc_count; i++) {
+		gamma_sim_crtc_t *crtc = &state->crtcs[i];
+
+		/* Submit ramps as a real method would. */
+		colorramp_fill_pure(&crtc->ramps[0], &crtc->ramps[crtc->size],
+				    &crtc->ramps[2*crtc->size], crtc->size,
+				    setting);
+
+		state->stats.round_trips += 1;
+		state->stats.bytes_sent += 6 * crtc->size;
+
+		double delay = state->latency;
+		if (state->jitter > 0.0) {
+			delay += (2.0*sim_random(state) - 1.0) *
+				state->jitter;
+		}
+		if (delay > 0.0) systemtime_sleep(delay);
+
+		if (state->failure_rate > 0.0 &&
+		    sim_random(state) < state->failure_rate) {
+			state->failures += 1;
+			r = -1;
+			continue;
+		}
+
+		if (state->validate &&
+		    validate_ramps(state, i, crtc, setting) < 0) {
+			r = -1;
+		}
+	}
+
+	return r;
+}
+
+void
+gamma_sim_get_stats(gamma_sim_state_t *state, gamma_method_stats_t *stats)
+{
+	*stats = state->stats;
+}
@@ -0,0 +1,74 @@
+/* gamma-sim.h -- Simulated gamma adjustment header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_GAMMA_SIM_H
+#define REDSHIFT_GAMMA_SIM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "redshift.h"
+
+#define GAMMA_SIM_MAX_SIZES  16
+
+
+typedef struct {
+	int size;
+	uint16_t *ramps;
+	uint16_t *saved;
+} gamma_sim_crtc_t;
+
+typedef struct {
+	int crtc_count;
+	int sizes[GAMMA_SIM_MAX_SIZES];
+	int size_count;
+
+	/* Delay of every request and its random variation (seconds),
+	   and the probability that a request fails. */
+	double latency;
+	double jitter;
+	double failure_rate;
+	uint32_t seed;
+	int validate;
+
+	gamma_sim_crtc_t *crtcs;
+	uint16_t *reference;
+
+	unsigned long failures;
+	unsigned long mismatches;
+	gamma_method_stats_t stats;
+} gamma_sim_state_t;
+
+
+int gamma_sim_init(gamma_sim_state_t *state);
+int gamma_sim_start(gamma_sim_state_t *state);
+void gamma_sim_free(gamma_sim_state_t *state);
+
+void gamma_sim_print_help(FILE *f);
+int gamma_sim_set_option(gamma_sim_state_t *state, const char *key,
+			 const char *value);
+
+void gamma_sim_restore(gamma_sim_state_t *state);
+int gamma_sim_set_temperature(gamma_sim_state_t *state,
+			      const color_setting_t *setting);
+void gamma_sim_get_stats(gamma_sim_state_t *state,
+			 gamma_method_stats_t *stats);
+
+
+#endif /* ! REDSHIFT_GAMMA_SIM_H */
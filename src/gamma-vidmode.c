@@ -17,6 +17,10 @@
    Copyright (c) 2010-2014  Jon Lund Steffensen <jonlst@gmail.com>
 */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -37,21 +41,31 @@
 #include "colorramp.h"
 
 
+#ifdef HAVE_XSETIOERROREXITHANDLER
+/* Called by Xlib in place of exit() when the connection to the X
+   server is lost, so the display can fail without taking the other
+   displays down with it. Later requests on it are ignored by Xlib. */
+static void
+vidmode_io_error_exit(Display *display, void *data)
+{
+	vidmode_state_t *state = data;
+	state->io_error = 1;
+}
+#endif
+
 int
 vidmode_init(vidmode_state_t *state)
 {
+	state->display_name = NULL;
+	state->display = NULL;
 	state->screen_num = -1;
 	state->saved_ramps = NULL;
+	state->io_error = 0;
 
 	state->preserve = 0;
 
-	/* Open display */
-	state->display = XOpenDisplay(NULL);
-	if (state->display == NULL) {
-		fprintf(stderr, _("X request failed: %s\n"),
-			"XOpenDisplay");
-		return -1;
-	}
+	state->stats.round_trips = 0;
+	state->stats.bytes_sent = 0;
 
 	return 0;
 }
@@ -60,6 +74,19 @@ int
 vidmode_start(vidmode_state_t *state)
 {
 	int r;
+
+	/* Open display */
+	state->display = XOpenDisplay(state->display_name);
+	if (state->display == NULL) {
+		fprintf(stderr, _("X request failed: %s\n"),
+			"XOpenDisplay");
+		return -1;
+	}
+
+#ifdef HAVE_XSETIOERROREXITHANDLER
+	XSetIOErrorExitHandler(state->display, vidmode_io_error_exit, state);
+#endif
+
 	int screen_num = state->screen_num;
 
 	if (screen_num < 0) screen_num = DefaultScreen(state->display);
@@ -118,9 +145,10 @@ vidmode_free(vidmode_state_t *state)
 {
 	/* Free saved ramps */
 	free(state->saved_ramps);
+	free(state->display_name);
 
 	/* Close display connection */
-	XCloseDisplay(state->display);
+	if (state->display != NULL) XCloseDisplay(state->display);
 }
 
 void
@@ -131,7 +159,8 @@ vidmode_print_help(FILE *f)
 
 	/* TRANSLATORS: VidMode help output
 	   left column must not be translated */
-	fputs(_("  screen=N\t\tX screen to apply adjustments to\n"
+	fputs(_("  display=NAME\tX display to connect to\n"
+		"  screen=N\t\tX screen to apply adjustments to\n"
 		"  preserve={0,1}\tWhether existing gamma should be"
 		" preserved\n"),
 	      f);
@@ -141,7 +170,14 @@ vidmode_print_help(FILE *f)
 int
 vidmode_set_option(vidmode_state_t *state, const char *key, const char *value)
 {
-	if (strcasecmp(key, "screen") == 0) {
+	if (strcasecmp(key, "display") == 0) {
+		free(state->display_name);
+		state->display_name = strdup(value);
+		if (state->display_name == NULL) {
+			perror("strdup");
+			return -1;
+		}
+	} else if (strcasecmp(key, "screen") == 0) {
 		state->screen_num = atoi(value);
 	} else if (strcasecmp(key, "preserve") == 0) {
 		state->preserve = atoi(value);
@@ -191,20 +227,13 @@ vidmode_set_temperature(vidmode_state_t *state,
 		/* Initialize gamma ramps from saved state */
 		memcpy(gamma_ramps, state->saved_ramps,
 		       3*state->ramp_size*sizeof(uint16_t));
+		colorramp_fill(gamma_r, gamma_g, gamma_b, state->ramp_size,
+			       setting);
 	} else {
-		/* Initialize gamma ramps to pure state */
-		for (int i = 0; i < state->ramp_size; i++) {
-			uint16_t value = (double)i/state->ramp_size *
-				(UINT16_MAX+1);
-			gamma_r[i] = value;
-			gamma_g[i] = value;
-			gamma_b[i] = value;
-		}
+		colorramp_fill_pure(gamma_r, gamma_g, gamma_b,
+				    state->ramp_size, setting);
 	}
 
-	colorramp_fill(gamma_r, gamma_g, gamma_b, state->ramp_size,
-		       setting);
-
 	/* Set new gamma ramps */
 	r = XF86VidModeSetGammaRamp(state->display, state->screen_num,
 				    state->ramp_size, gamma_r, gamma_g,
@@ -216,7 +245,26 @@ vidmode_set_temperature(vidmode_state_t *state,
 		return -1;
 	}
 
+	/* The request is sent without waiting for a reply, which is
+	   also where a lost connection shows up. Each ramp is padded
+	   to four bytes. */
+	XFlush(state->display);
+	state->stats.bytes_sent += 8 + 3*((2*state->ramp_size + 3) & ~3);
+
 	free(gamma_ramps);
 
+	if (state->io_error) {
+		fprintf(stderr, _("Lost connection to X display `%s'.\n"),
+			state->display_name != NULL ?
+			state->display_name : "");
+		return -1;
+	}
+
 	return 0;
 }
+
+void
+vidmode_get_stats(vidmode_state_t *state, gamma_method_stats_t *stats)
+{
+	*stats = state->stats;
+}
@@ -28,11 +28,14 @@
 #include <X11/Xlib.h>
 
 typedef struct {
+	char *display_name;
 	Display *display;
 	int preserve;
 	int screen_num;
 	int ramp_size;
 	uint16_t *saved_ramps;
+	int io_error;
+	gamma_method_stats_t stats;
 } vidmode_state_t;
 
 
@@ -47,6 +50,7 @@ int vidmode_set_option(vidmode_state_t *state, const char *key,
 void vidmode_restore(vidmode_state_t *state);
 int vidmode_set_temperature(vidmode_state_t *state,
 			    const color_setting_t *setting);
+void vidmode_get_stats(vidmode_state_t *state, gamma_method_stats_t *stats);
 
 
 #endif /* ! REDSHIFT_GAMMA_VIDMODE_H */
@@ -172,20 +172,13 @@ w32gdi_set_temperature(w32gdi_state_t *state,
 		/* Initialize gamma ramps from saved state */
 		memcpy(gamma_ramps, state->saved_ramps,
 		       3*GAMMA_RAMP_SIZE*sizeof(WORD));
+		colorramp_fill(gamma_r, gamma_g, gamma_b, GAMMA_RAMP_SIZE,
+			       setting);
 	} else {
-		/* Initialize gamma ramps to pure state */
-		for (int i = 0; i < GAMMA_RAMP_SIZE; i++) {
-			WORD value = (double)i/GAMMA_RAMP_SIZE *
-				(UINT16_MAX+1);
-			gamma_r[i] = value;
-			gamma_g[i] = value;
-			gamma_b[i] = value;
-		}
+		colorramp_fill_pure(gamma_r, gamma_g, gamma_b,
+				    GAMMA_RAMP_SIZE, setting);
 	}
 
-	colorramp_fill(gamma_r, gamma_g, gamma_b, GAMMA_RAMP_SIZE,
-		       setting);
-
 	/* Set new gamma ramps */
 	r = SetDeviceGammaRamp(hDC, gamma_ramps);
 	if (!r) {
@@ -17,17 +17,43 @@
    Copyright (c) 2014  Jon Lund Steffensen <jonlst@gmail.com>
 */
 
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
 #include <errno.h>
 #ifndef _WIN32
 # include <pwd.h>
+# include <signal.h>
+# include <sys/wait.h>
+#endif
+#ifdef HAVE_SPAWN_H
+# include <spawn.h>
+#endif
+#ifdef HAVE_DLFCN_H
+# include <dlfcn.h>
 #endif
 
 #include "hooks.h"
 #include "redshift.h"
+#include "signals.h"
+#include "systemtime.h"
+#include "probes.h"
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
 
 #define MAX_HOOK_PATH  4096
 
@@ -41,73 +67,819 @@ static const char *period_names[] = {
 };
 
 
-/* Try to open the directory containing hooks. HP is a string
-   of MAX_HOOK_PATH length that will be filled with the path
-   of the returned directory. */
-static DIR *
-open_hooks_dir(char *hp)
+/* Find the directory containing hooks. HP is a string of
+   MAX_HOOK_PATH length that will be filled with the path. */
+static int
+get_hooks_dir(char *hp)
 {
 	char *env;
 
 	if ((env = getenv("XDG_CONFIG_HOME")) != NULL &&
 	    env[0] != '\0') {
 		snprintf(hp, MAX_HOOK_PATH, "%s/redshift/hooks", env);
-		return opendir(hp);
+		return 0;
 	}
 
 	if ((env = getenv("HOME")) != NULL &&
 	    env[0] != '\0') {
 		snprintf(hp, MAX_HOOK_PATH, "%s/.config/redshift/hooks", env);
-		return opendir(hp);
+		return 0;
 	}
 
 #ifndef _WIN32
 	struct passwd *pwd = getpwuid(getuid());
 	snprintf(hp, MAX_HOOK_PATH, "%s/.config/redshift/hooks", pwd->pw_dir);
-	return opendir(hp);
+	return 0;
 #else
-	return NULL;
+	return -1;
 #endif
 }
 
-/* Run hooks with a signal that the period changed. */
-void
-hooks_signal_period_change(period_t prev_period, period_t period)
+static void
+free_hook_list(hook_t *hooks, int count)
 {
-	char hooksdir_path[MAX_HOOK_PATH];
-	DIR *hooks_dir = open_hooks_dir(hooksdir_path);
-	if (hooks_dir == NULL) return;
+	for (int i = 0; i < count; i++) free(hooks[i].path);
+	free(hooks);
+}
+
+/* Return non-zero if NAME is the file name of a plugin. */
+static int
+is_plugin_name(const char *name)
+{
+	size_t len = strlen(name);
+	return len > 3 && strcmp(&name[len-3], ".so") == 0;
+}
+
+static int
+compare_paths(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Read the executables and plugins in the hooks directory into a
+   sorted list of paths. Returns the number of paths. */
+static int
+read_hooks_dir(const char *dir, char ***paths)
+{
+	*paths = NULL;
+
+	DIR *hooks_dir = opendir(dir);
+	if (hooks_dir == NULL) return 0;
 
+	int count = 0;
+	int size = 0;
 	struct dirent* ent;
 	while ((ent = readdir(hooks_dir)) != NULL) {
 		/* Skip hidden and special files (., ..) */
 		if (ent->d_name[0] == '\0' || ent->d_name[0] == '.') continue;
 
-		char *hook_name = ent->d_name;
 		char hook_path[MAX_HOOK_PATH];
 		snprintf(hook_path, sizeof(hook_path), "%s/%s",
-			 hooksdir_path, hook_name);
+			 dir, ent->d_name);
+
+		/* Only executables can be run. */
+		struct stat st;
+		if (stat(hook_path, &st) < 0 || !S_ISREG(st.st_mode) ||
+		    (!is_plugin_name(ent->d_name) &&
+		     access(hook_path, X_OK) < 0)) {
+			continue;
+		}
+
+		if (count == size) {
+			size = size > 0 ? 2 * size : 8;
+			char **p = realloc(*paths, size * sizeof(char *));
+			if (p == NULL) break;
+			*paths = p;
+		}
+
+		char *path = strdup(hook_path);
+		if (path == NULL) break;
+		(*paths)[count++] = path;
+	}
+
+	closedir(hooks_dir);
+
+	/* Run hooks in a predictable order. */
+	qsort(*paths, count, sizeof(char *), compare_paths);
+
+	return count;
+}
+
+#ifdef HAVE_DLFCN_H
+
+/* Load the plugin at PLUGIN->path. Returns -1 if it cannot be used. */
+static int
+load_plugin(hook_plugin_t *plugin)
+{
+	/* Plugin symbols are kept local so plugins cannot clash with
+	   each other. */
+	plugin->handle = dlopen(plugin->path, RTLD_NOW | RTLD_LOCAL);
+	if (plugin->handle == NULL) {
+		fprintf(stderr, _("Unable to load plugin `%s': %s\n"),
+			plugin->name, dlerror());
+		return -1;
+	}
+
+	const int *abi_version = dlsym(plugin->handle,
+				       "redshift_plugin_abi_version");
+	if (abi_version != NULL &&
+	    *abi_version != REDSHIFT_PLUGIN_ABI_VERSION) {
+		fprintf(stderr, _("Plugin `%s' was built for another"
+				  " version of Redshift.\n"),
+			plugin->name);
+		dlclose(plugin->handle);
+		plugin->handle = NULL;
+		return -1;
+	}
+
+	plugin->on_period_change = (redshift_plugin_period_change_func *)
+		dlsym(plugin->handle, "on_period_change");
+	plugin->on_setting_change = (redshift_plugin_setting_change_func *)
+		dlsym(plugin->handle, "on_setting_change");
+	if (plugin->on_period_change == NULL &&
+	    plugin->on_setting_change == NULL) {
+		fprintf(stderr, _("Plugin `%s' has no callbacks.\n"),
+			plugin->name);
+		dlclose(plugin->handle);
+		plugin->handle = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+unload_plugin(hook_plugin_t *plugin)
+{
+	if (plugin->handle != NULL) dlclose(plugin->handle);
+	free(plugin->path);
+}
+
+#else /* ! HAVE_DLFCN_H */
+
+static int
+load_plugin(hook_plugin_t *plugin)
+{
+	fprintf(stderr, _("Plugins are not supported; ignoring `%s'.\n"),
+		plugin->name);
+	return -1;
+}
+
+static void
+unload_plugin(hook_plugin_t *plugin)
+{
+	free(plugin->path);
+}
+
+#endif /* ! HAVE_DLFCN_H */
+
+/* Load the plugins in PATHS that are not loaded already and unload
+   plugins that were removed. Plugins that cannot be loaded are kept
+   disabled so they are not retried until the directory changes. */
+static void
+update_plugins(hooks_state_t *state, char **paths, int count)
+{
+	hook_plugin_t *plugins = count > 0 ?
+		calloc(count, sizeof(hook_plugin_t)) : NULL;
+	if (count > 0 && plugins == NULL) {
+		perror("calloc");
+		for (int i = 0; i < count; i++) free(paths[i]);
+		return;
+	}
+
+	for (int i = 0; i < count; i++) {
+		hook_plugin_t *plugin = &plugins[i];
+
+		int j;
+		for (j = 0; j < state->plugin_count; j++) {
+			hook_plugin_t *old = &state->plugins[j];
+			if (old->path != NULL &&
+			    strcmp(old->path, paths[i]) == 0) break;
+		}
+
+		if (j < state->plugin_count) {
+			*plugin = state->plugins[j];
+			state->plugins[j].path = NULL;
+			free(paths[i]);
+		} else {
+			plugin->path = paths[i];
+			plugin->name = strrchr(plugin->path, '/') + 1;
+			if (load_plugin(plugin) < 0) plugin->disabled = 1;
+		}
+	}
+
+	for (int j = 0; j < state->plugin_count; j++) {
+		if (state->plugins[j].path != NULL) {
+			unload_plugin(&state->plugins[j]);
+		}
+	}
+	free(state->plugins);
+
+	state->plugins = plugins;
+	state->plugin_count = count;
+}
+
+/* Read the hooks directory again. Hooks that are still present keep
+   their state and statistics. Hooks that disappeared are kept until
+   their process has been reaped. */
+static void
+scan_hooks_dir(hooks_state_t *state)
+{
+	char **paths;
+	int count = read_hooks_dir(state->dir, &paths);
+
+	/* Plugins are kept apart from the executables. */
+	char **plugin_paths = count > 0 ? malloc(count * sizeof(char *)) :
+		NULL;
+	int plugin_count = 0;
+	int path_count = 0;
+	for (int i = 0; i < count; i++) {
+		if (!is_plugin_name(strrchr(paths[i], '/') + 1)) {
+			paths[path_count++] = paths[i];
+		} else if (plugin_paths != NULL) {
+			plugin_paths[plugin_count++] = paths[i];
+		} else {
+			free(paths[i]);
+		}
+	}
+	count = path_count;
+
+	update_plugins(state, plugin_paths, plugin_count);
+	free(plugin_paths);
+
+	int size = count + state->hook_count;
+	hook_t *hooks = size > 0 ? calloc(size, sizeof(hook_t)) : NULL;
+	if (size > 0 && hooks == NULL) {
+		perror("calloc");
+		for (int i = 0; i < count; i++) free(paths[i]);
+		free(paths);
+		return;
+	}
+
+	int hook_count = 0;
+	for (int i = 0; i < count; i++) {
+		hook_t *hook = &hooks[hook_count++];
+
+		int j;
+		for (j = 0; j < state->hook_count; j++) {
+			hook_t *old = &state->hooks[j];
+			if (old->path != NULL &&
+			    strcmp(old->path, paths[i]) == 0) break;
+		}
+
+		if (j < state->hook_count) {
+			*hook = state->hooks[j];
+			hook->removed = 0;
+			state->hooks[j].path = NULL;
+			free(paths[i]);
+		} else {
+			hook->path = paths[i];
+			hook->name = strrchr(hook->path, '/') + 1;
+		}
+	}
+	free(paths);
+
+	for (int j = 0; j < state->hook_count; j++) {
+		hook_t *old = &state->hooks[j];
+		if (old->path != NULL && old->pid > 0) {
+			hook_t *hook = &hooks[hook_count++];
+			*hook = *old;
+			hook->removed = 1;
+			hook->pending = 0;
+			old->path = NULL;
+		}
+	}
+
+	free_hook_list(state->hooks, state->hook_count);
+	state->hooks = hooks;
+	state->hook_count = hook_count;
+	state->stale = 0;
+}
+
+/* Watch the hooks directory, or if it does not exist the nearest
+   existing parent directory for the creation of the next component
+   of the path. WATCHING is left unset if notifications are not
+   available. */
+static void
+watch_hooks_dir(hooks_state_t *state)
+{
+	state->watching = 0;
+	state->watching_dir = 0;
+
+	char path[MAX_HOOK_PATH];
+	snprintf(path, sizeof(path), "%s", state->dir);
+
+	const char *name = NULL;
+	while (1) {
+		if (dirwatch_init(&state->watch, path, name) == 0) break;
+
+		/* The directory exists, so notifications failed. */
+		if (access(path, F_OK) == 0) return;
+
+		char *sep = strrchr(path, '/');
+		if (sep == NULL || sep == path) return;
+		*sep = '\0';
+		name = sep + 1;
+	}
+
+	state->watching = 1;
+	state->watching_dir = name == NULL;
+
+	/* The directory may have been created before the watch was
+	   added. */
+	if (!state->watching_dir && access(state->dir, F_OK) == 0) {
+		dirwatch_free(&state->watch);
+		watch_hooks_dir(state);
+	}
+}
+
+/* Read the hooks directory again if it changed. A missing directory
+   means there are no hooks and costs nothing until it is created. */
+static void
+refresh_hooks(hooks_state_t *state)
+{
+	if (!state->watching) {
+		state->stale = 1;
+	} else if (dirwatch_read(&state->watch) != 0) {
+		/* A parent was created, or the directory was removed. */
+		if (!state->watching_dir || access(state->dir, F_OK) != 0) {
+			dirwatch_free(&state->watch);
+			watch_hooks_dir(state);
+		}
+		state->stale = 1;
+	}
+	if (state->stale) scan_hooks_dir(state);
+}
+
+/* Record the outcome of a plugin call that returned R and began at
+   STARTED. A plugin that keeps failing or stalling the main loop is
+   disabled. */
+static void
+plugin_call_done(hook_plugin_t *plugin, int r, double started)
+{
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) now = started;
+
+	double duration = now - started;
+	hook_stats_t *stats = &plugin->stats;
+	stats->runs += 1;
+	stats->last_status = r;
+	stats->last_duration = duration;
+	stats->total_duration += duration;
+	if (duration > stats->max_duration) stats->max_duration = duration;
+
+	int error = 0;
+	if (r < 0) {
+		stats->failures += 1;
+		error = 1;
+	}
+	if (duration > HOOK_PLUGIN_CALL_BUDGET) {
+		stats->timeouts += 1;
+		error = 1;
+	}
+
+	plugin->errors = error ? plugin->errors + 1 : 0;
+	if (plugin->errors >= HOOK_PLUGIN_MAX_ERRORS) {
+		fprintf(stderr, _("Plugin `%s' failed %i times in a row;"
+				  " disabling it.\n"),
+			plugin->name, plugin->errors);
+		plugin->disabled = 1;
+		plugin->pending = 0;
+	}
+}
+
+static void
+call_setting_change(hook_plugin_t *plugin,
+		    const redshift_plugin_setting_t *setting)
+{
+	double started;
+	if (systemtime_get_monotonic_time(&started) < 0) started = 0.0;
+
+	plugin->pending = 0;
+	plugin->last_call = started;
+
+	int r = plugin->on_setting_change(setting);
+	plugin_call_done(plugin, r, started);
+}
+
+/* Deliver pending settings to plugins whose interval has passed, or
+   to all plugins if FLUSH is set. */
+static void
+flush_plugin_settings(hooks_state_t *state, int flush)
+{
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) return;
+
+	for (int i = 0; i < state->plugin_count; i++) {
+		hook_plugin_t *plugin = &state->plugins[i];
+		if (!plugin->pending || plugin->disabled) continue;
+		if (!flush &&
+		    now < plugin->last_call + state->plugin_interval) {
+			continue;
+		}
+
+		redshift_plugin_setting_t setting = plugin->pending_setting;
+		call_setting_change(plugin, &setting);
+	}
+}
+
+int
+hooks_init(hooks_state_t *state)
+{
+	state->dir = NULL;
+	state->watching = 0;
+	state->watching_dir = 0;
+	state->stale = 1;
+	state->hooks = NULL;
+	state->hook_count = 0;
+	state->plugins = NULL;
+	state->plugin_count = 0;
+	state->timeout = DEFAULT_HOOK_TIMEOUT;
+	state->concurrency = DEFAULT_HOOK_CONCURRENCY;
+	state->plugin_interval = DEFAULT_HOOK_PLUGIN_INTERVAL;
+	state->running_count = 0;
+
+	char hooksdir_path[MAX_HOOK_PATH];
+	if (get_hooks_dir(hooksdir_path) < 0) return 0;
+
+	state->dir = strdup(hooksdir_path);
+	if (state->dir == NULL) {
+		perror("strdup");
+		return -1;
+	}
+
+	/* Without notifications the directory is read on every period
+	   change. */
+	watch_hooks_dir(state);
+
+	return 0;
+}
+
+/* Hooks that are still running are left alone. Plugins receive the
+   last setting before they are unloaded. */
+void
+hooks_free(hooks_state_t *state)
+{
+	flush_plugin_settings(state, 1);
+
+	if (state->watching) dirwatch_free(&state->watch);
+	free_hook_list(state->hooks, state->hook_count);
+	state->hooks = NULL;
+	state->hook_count = 0;
+	for (int i = 0; i < state->plugin_count; i++) {
+		unload_plugin(&state->plugins[i]);
+	}
+	free(state->plugins);
+	state->plugins = NULL;
+	state->plugin_count = 0;
+	free(state->dir);
+	state->dir = NULL;
+}
+
+#if defined(HAVE_SPAWN_H) && !defined(_WIN32)
+
+extern char **environ;
+
+/* Start HOOK without waiting for it. Standard output is closed so the
+   hook cannot interfere with the normal output. The hook gets its own
+   process group so it can be killed along with its children. */
+static pid_t
+spawn_hook(const hook_t *hook, period_t prev_period, period_t period)
+{
+	char *argv[] = {
+		(char *)hook->name, "period-changed",
+		(char *)period_names[prev_period],
+		(char *)period_names[period], NULL
+	};
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addclose(&actions, STDOUT_FILENO);
+
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&attr, 0);
+
+	pid_t pid;
+	int r = posix_spawn(&pid, hook->path, &actions, &attr, argv,
+			    environ);
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	if (r != 0) {
+		errno = r;
+		perror("posix_spawn");
+		return -1;
+	}
+
+	return pid;
+}
+
+#elif !defined(_WIN32)
+
+static pid_t
+spawn_hook(const hook_t *hook, period_t prev_period, period_t period)
+{
+	pid_t pid = fork();
+	if (pid == (pid_t)-1) {
+		perror("fork");
+		return -1;
+	} else if (pid == 0) { /* Child */
+		setpgid(0, 0);
+		close(STDOUT_FILENO);
+
+		execl(hook->path, hook->name, "period-changed",
+		      period_names[prev_period], period_names[period], NULL);
+		perror("execl");
+
+		/* Only reached on error */
+		_exit(EXIT_FAILURE);
+	}
+
+	return pid;
+}
+
+#endif
+
+#ifndef _WIN32
+
+/* Start hooks with a pending transition that are not already running,
+   as long as the concurrency limit allows. */
+static void
+dispatch_hooks(hooks_state_t *state)
+{
+	for (int i = 0; i < state->hook_count; i++) {
+		if (state->concurrency > 0 &&
+		    state->running_count >= state->concurrency) break;
+
+		hook_t *hook = &state->hooks[i];
+		if (!hook->pending || hook->pid > 0 || hook->removed) {
+			continue;
+		}
+
+		hook->pending = 0;
+
+		pid_t pid = spawn_hook(hook, hook->pending_prev,
+				       hook->pending_period);
+		if (pid < 0) {
+			hook->stats.runs += 1;
+			hook->stats.failures += 1;
+			continue;
+		}
+
+		double now;
+		if (systemtime_get_monotonic_time(&now) < 0) now = 0.0;
+
+		hook->pid = pid;
+		hook->started = now;
+		hook->deadline = state->timeout > 0.0 ?
+			now + state->timeout : 0.0;
+		hook->killed = 0;
+		state->running_count += 1;
+	}
+}
+
+#endif
+
+/* Run hooks with a signal that the period changed. A hook that is
+   still busy with an earlier change receives only the latest
+   transition once it exits. */
+void
+hooks_signal_period_change(hooks_state_t *state,
+			   period_t prev_period, period_t period)
+{
+	REDSHIFT_PROBE2(period_change, period_names[prev_period],
+			period_names[period]);
 
 #ifndef _WIN32
-		/* Fork and exec the hook. We close stdout
-		   so the hook cannot interfere with the normal
-		   output. */
-		pid_t pid = fork();
-		if (pid == (pid_t)-1) {
-			perror("fork");
+	if (state == NULL || state->dir == NULL) return;
+
+	refresh_hooks(state);
+
+	for (int i = 0; i < state->plugin_count; i++) {
+		hook_plugin_t *plugin = &state->plugins[i];
+		if (plugin->disabled || plugin->on_period_change == NULL) {
+			continue;
+		}
+
+		double started;
+		if (systemtime_get_monotonic_time(&started) < 0) {
+			started = 0.0;
+		}
+
+		int r = plugin->on_period_change(period_names[prev_period],
+						 period_names[period]);
+		plugin_call_done(plugin, r, started);
+	}
+
+	for (int i = 0; i < state->hook_count; i++) {
+		hook_t *hook = &state->hooks[i];
+		if (hook->removed) continue;
+
+		if (hook->pending) {
+			hook->pending_period = period;
+			hook->stats.coalesced += 1;
+
+			/* Flipped back before the hook saw the change. */
+			if (hook->pending_prev == hook->pending_period) {
+				hook->pending = 0;
+			}
+		} else {
+			hook->pending = 1;
+			hook->pending_prev = prev_period;
+			hook->pending_period = period;
+		}
+	}
+
+	dispatch_hooks(state);
+#endif
+}
+
+/* Pass a new color setting to plugins. Plugins that received a
+   setting less than plugin_interval ago get the latest setting when
+   the interval has passed. This runs for every step of a fade, so
+   only the plugins already loaded are used; the directory is read
+   on period changes and when the watch reports a change. */
+void
+hooks_signal_setting_change(hooks_state_t *state,
+			    const color_setting_t *setting)
+{
+	if (state == NULL || state->dir == NULL) return;
+
+	redshift_plugin_setting_t plugin_setting = {
+		setting->temperature, setting->brightness,
+		{ setting->gamma[0], setting->gamma[1], setting->gamma[2] }
+	};
+
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) now = 0.0;
+
+	for (int i = 0; i < state->plugin_count; i++) {
+		hook_plugin_t *plugin = &state->plugins[i];
+		if (plugin->disabled || plugin->on_setting_change == NULL) {
 			continue;
-		} else if (pid == 0) { /* Child */
-			close(STDOUT_FILENO);
+		}
+
+		if (now < plugin->last_call + state->plugin_interval) {
+			if (plugin->pending) plugin->stats.coalesced += 1;
+			plugin->pending = 1;
+			plugin->pending_setting = plugin_setting;
+			continue;
+		}
+
+		call_setting_change(plugin, &plugin_setting);
+	}
+}
+
+/* Return file descriptor that becomes readable when a hook exits, or
+   -1 if no hook is running. */
+int
+hooks_get_fd(const hooks_state_t *state)
+{
+	if (state == NULL || state->running_count == 0) return -1;
+	return signals_get_child_fd();
+}
+
+/* Return file descriptor that becomes readable when the hooks
+   directory may have changed, or -1 if it is not watched. */
+int
+hooks_get_watch_fd(const hooks_state_t *state)
+{
+	if (state == NULL || !state->watching) return -1;
+	return state->watch.fd;
+}
+
+/* Load and unload hooks and plugins after the watch reported a
+   change. */
+void
+hooks_handle_watch(hooks_state_t *state)
+{
+	refresh_hooks(state);
+}
+
+/* Store in DEADLINE (monotonic seconds) the time when the next hook
+   times out or a pending plugin setting is due. Returns -1 if there
+   is no such deadline. */
+int
+hooks_get_deadline(const hooks_state_t *state, double *deadline)
+{
+	int found = 0;
+
+	if (state == NULL) return -1;
+
+	for (int i = 0; i < state->hook_count; i++) {
+		const hook_t *hook = &state->hooks[i];
+		if (hook->pid <= 0 || hook->deadline <= 0.0) continue;
+		if (!found || hook->deadline < *deadline) {
+			*deadline = hook->deadline;
+			found = 1;
+		}
+	}
+
+	for (int i = 0; i < state->plugin_count; i++) {
+		const hook_plugin_t *plugin = &state->plugins[i];
+		if (!plugin->pending || plugin->disabled) continue;
+		double due = plugin->last_call + state->plugin_interval;
+		if (!found || due < *deadline) {
+			*deadline = due;
+			found = 1;
+		}
+	}
+
+	return found ? 0 : -1;
+}
+
+/* Collect hooks that exited, record their statistics and start hooks
+   that were waiting for them. */
+void
+hooks_reap(hooks_state_t *state)
+{
+#ifndef _WIN32
+	signals_clear_child();
+
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) now = 0.0;
+
+	for (int i = 0; i < state->hook_count; i++) {
+		hook_t *hook = &state->hooks[i];
+		if (hook->pid <= 0) continue;
+
+		int status;
+		pid_t r = waitpid(hook->pid, &status, WNOHANG);
+		if (r == 0 || (r < 0 && errno == EINTR)) continue;
+
+		int exit_status = -1;
+		if (r > 0 && WIFEXITED(status)) {
+			exit_status = WEXITSTATUS(status);
+		} else if (r > 0 && WIFSIGNALED(status)) {
+			exit_status = 128 + WTERMSIG(status);
+		}
+
+		double duration = now - hook->started;
+		hook_stats_t *stats = &hook->stats;
+		stats->runs += 1;
+		if (hook->killed) {
+			stats->timeouts += 1;
+		} else if (exit_status != 0) {
+			stats->failures += 1;
+		}
+		stats->last_status = exit_status;
+		stats->last_duration = duration;
+		stats->total_duration += duration;
+		if (duration > stats->max_duration) {
+			stats->max_duration = duration;
+		}
 
-			int r = execl(hook_path, hook_name,
-				      "period-changed",
-				      period_names[prev_period],
-				      period_names[period], NULL);
-			if (r < 0 && errno != EACCES) perror("execl");
+		hook->pid = 0;
+		state->running_count -= 1;
+	}
 
-			/* Only reached on error */
-			_exit(EXIT_FAILURE);
+	/* Forget hooks that were removed from the directory. */
+	int count = 0;
+	for (int i = 0; i < state->hook_count; i++) {
+		hook_t *hook = &state->hooks[i];
+		if (hook->removed && hook->pid <= 0) {
+			free(hook->path);
+			continue;
 		}
+		state->hooks[count++] = *hook;
+	}
+	state->hook_count = count;
+
+	dispatch_hooks(state);
 #endif
+}
+
+/* Deliver plugin settings that are due and terminate hooks that ran
+   past their deadline. Hooks are asked to terminate first and killed
+   if they are still running after HOOK_KILL_GRACE seconds. */
+void
+hooks_handle_deadline(hooks_state_t *state)
+{
+	flush_plugin_settings(state, 0);
+
+#ifndef _WIN32
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) return;
+
+	for (int i = 0; i < state->hook_count; i++) {
+		hook_t *hook = &state->hooks[i];
+		if (hook->pid <= 0 || hook->deadline <= 0.0 ||
+		    now < hook->deadline) {
+			continue;
+		}
+
+		if (!hook->killed) {
+			fprintf(stderr, _("Hook `%s' timed out after %.1f"
+					  " seconds; terminating.\n"),
+				hook->name, now - hook->started);
+			kill(-hook->pid, SIGTERM);
+			hook->killed = 1;
+			hook->deadline = now + HOOK_KILL_GRACE;
+		} else {
+			kill(-hook->pid, SIGKILL);
+			hook->deadline = 0.0;
+		}
 	}
+#endif
 }
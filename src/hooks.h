@@ -17,13 +17,126 @@
    Copyright (c) 2014  Jon Lund Steffensen <jonlst@gmail.com>
 */
 
+
 #ifndef REDSHIFT_HOOKS_H
 #define REDSHIFT_HOOKS_H
 
+#include <sys/types.h>
+
 #include "redshift.h"
+#include "redshift-plugin.h"
+#include "dirwatch.h"
+
+/* Default number of seconds a hook may run before it is killed. */
+#define DEFAULT_HOOK_TIMEOUT  30.0
+
+/* Default number of hooks allowed to run at the same time. */
+#define DEFAULT_HOOK_CONCURRENCY  4
+
+/* Default minimum number of seconds between setting changes delivered
+   to a plugin. */
+#define DEFAULT_HOOK_PLUGIN_INTERVAL  0.2
+
+/* A plugin call taking longer than this many seconds counts as an
+   error. */
+#define HOOK_PLUGIN_CALL_BUDGET  0.05
+
+/* Plugins are disabled after this many consecutive errors. */
+#define HOOK_PLUGIN_MAX_ERRORS  3
+
+/* Seconds between asking a timed out hook to terminate and killing
+   it. */
+#define HOOK_KILL_GRACE  2.0
+
+/* Statistics about the runs of a hook. */
+typedef struct {
+	unsigned int runs;
+	unsigned int failures;
+	unsigned int timeouts;
+	unsigned int coalesced;
+	int last_status;
+	double last_duration;
+	double total_duration;
+	double max_duration;
+} hook_stats_t;
+
+/* An executable in the hooks directory. At most one process runs per
+   hook; period changes that arrive meanwhile are coalesced into a
+   single pending transition. */
+typedef struct {
+	char *path;
+	const char *name;
+	int removed;
+
+	pid_t pid;
+	double started;
+	double deadline;
+	int killed;
+
+	int pending;
+	period_t pending_prev;
+	period_t pending_period;
+
+	hook_stats_t stats;
+} hook_t;
+
+/* A shared object in the hooks directory. Runs count callback calls
+   and timeouts count calls that exceeded HOOK_PLUGIN_CALL_BUDGET. */
+typedef struct {
+	char *path;
+	const char *name;
+
+	void *handle;
+	redshift_plugin_period_change_func *on_period_change;
+	redshift_plugin_setting_change_func *on_setting_change;
+	int errors;
+	int disabled;
+
+	double last_call;
+	int pending;
+	redshift_plugin_setting_t pending_setting;
+
+	hook_stats_t stats;
+} hook_plugin_t;
+
+/* Hooks and plugins found in the hooks directory. The directory is only read
+   again when it changed. While it does not exist the nearest existing parent
+   is watched for its creation (WATCHING_DIR is unset). */
+typedef struct {
+	char *dir;
+	dirwatch_t watch;
+	int watching;
+	int watching_dir;
+	int stale;
+
+	hook_t *hooks;
+	int hook_count;
+
+	hook_plugin_t *plugins;
+	int plugin_count;
+
+	/* Limits; a timeout of zero lets hooks run indefinitely. */
+	double timeout;
+	int concurrency;
+	double plugin_interval;
+	int running_count;
+} hooks_state_t;
+
+
+int hooks_init(hooks_state_t *state);
+void hooks_free(hooks_state_t *state);
+
+void hooks_signal_period_change(hooks_state_t *state,
+				period_t prev_period, period_t period);
+void hooks_signal_setting_change(hooks_state_t *state,
+				 const color_setting_t *setting);
 
-void hooks_signal_period_change(period_t prev_period,
-				period_t period);
+int hooks_get_fd(const hooks_state_t *state);
+int hooks_get_watch_fd(const hooks_state_t *state);
+void hooks_handle_watch(hooks_state_t *state);
+int hooks_get_deadline(const hooks_state_t *state, double *deadline);
+void hooks_reap(hooks_state_t *state);
+void hooks_handle_deadline(hooks_state_t *state);
 
 
 #endif /* ! REDSHIFT_HOOKS_H */
@@ -0,0 +1,284 @@
+/* idle-bench.c -- Idle wakeup benchmark source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "idle-bench.h"
+#include "systemtime.h"
+
+#define SECONDS_PER_HOUR  3600.0
+
+
+void
+idle_bench_init(idle_bench_t *bench, double duration)
+{
+	memset(bench, 0, sizeof(idle_bench_t));
+	bench->duration = duration;
+}
+
+#ifdef __linux__
+/* Read the value of the line starting with KEY in a /proc file of
+   "key: value" lines. */
+static int
+read_proc_field(const char *path, const char *key, unsigned long *value)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) return -1;
+
+	size_t len = strlen(key);
+	char line[256];
+	int r = -1;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strncmp(line, key, len) == 0 && line[len] == ':') {
+			*value = strtoul(&line[len+1], NULL, 10);
+			r = 0;
+			break;
+		}
+	}
+
+	fclose(f);
+	return r;
+}
+#endif
+
+/* The counters in /proc/self/status and /proc/self/schedstat are
+   those of the main thread, which runs the main loop. */
+static void
+take_sample(idle_bench_sample_t *sample, const metrics_t *metrics)
+{
+	memset(sample, 0, sizeof(idle_bench_sample_t));
+
+#ifdef __linux__
+	sample->have_io =
+		read_proc_field("/proc/self/io", "syscr",
+				&sample->read_calls) == 0 &&
+		read_proc_field("/proc/self/io", "syscw",
+				&sample->write_calls) == 0;
+
+	sample->have_switches =
+		read_proc_field("/proc/self/status",
+				"voluntary_ctxt_switches",
+				&sample->voluntary_switches) == 0 &&
+		read_proc_field("/proc/self/status",
+				"nonvoluntary_ctxt_switches",
+				&sample->involuntary_switches) == 0;
+
+	/* Time on the CPU, time waiting to run, and the number of
+	   times the thread was run. */
+	FILE *f = fopen("/proc/self/schedstat", "r");
+	if (f != NULL) {
+		unsigned long long run_time, wait_time;
+		sample->have_schedstat =
+			fscanf(f, "%llu %llu %lu", &run_time, &wait_time,
+			       &sample->runs) == 3;
+		fclose(f);
+	}
+#endif
+
+	if (systemtime_get_cpu_time(&sample->cpu_time) < 0) {
+		sample->cpu_time = 0.0;
+	}
+	if (systemtime_get_monotonic_time(&sample->monotonic) < 0) {
+		sample->monotonic = 0.0;
+	}
+
+	sample->ticks = metrics->ticks;
+	sample->writes = metrics->writes;
+	sample->wakeups = metrics->wakeups;
+	memcpy(sample->wakeup_causes, metrics->wakeup_causes,
+	       sizeof(sample->wakeup_causes));
+}
+
+/* Start measuring, unless already started. */
+void
+idle_bench_begin(idle_bench_t *bench, const metrics_t *metrics)
+{
+	if (bench->started) return;
+	take_sample(&bench->start, metrics);
+	bench->started = 1;
+}
+
+/* Return non-zero once the benchmark has run for its duration. */
+int
+idle_bench_done(idle_bench_t *bench, const metrics_t *metrics)
+{
+	if (!bench->started) return 0;
+	if (bench->finished) return 1;
+
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) return 0;
+	if (now < bench->start.monotonic + bench->duration) return 0;
+
+	take_sample(&bench->end, metrics);
+	bench->finished = 1;
+	return 1;
+}
+
+/* Store in DEADLINE the time (seconds since epoch, NOW being the
+   current time) at which the benchmark ends. Returns -1 if there is
+   no such time yet. */
+int
+idle_bench_get_deadline(const idle_bench_t *bench, double now,
+			double *deadline)
+{
+	if (bench == NULL || !bench->started) return -1;
+
+	double mono;
+	if (systemtime_get_monotonic_time(&mono) < 0) return -1;
+
+	*deadline = now + bench->start.monotonic + bench->duration - mono;
+	return 0;
+}
+
+static void
+print_row(const char *label, double total, double hours)
+{
+	printf("%-24s %12.0f %12.1f\n", label, total, total / hours);
+}
+
+/* Print the usage counters as totals and per hour. Returns -1 if the
+   benchmark did not finish or went over the budget. */
+int
+idle_bench_print(const idle_bench_t *bench, const char *method,
+		 output_jsonl_state_t *jsonl)
+{
+	if (!bench->finished) {
+		fputs(_("Idle benchmark did not finish.\n"), stderr);
+		return -1;
+	}
+
+	const idle_bench_sample_t *a = &bench->start;
+	const idle_bench_sample_t *b = &bench->end;
+
+	double elapsed = b->monotonic - a->monotonic;
+	double hours = elapsed / SECONDS_PER_HOUR;
+
+	unsigned long wakeups = b->wakeups - a->wakeups;
+	unsigned long causes[METRICS_WAKEUP_CAUSES];
+	for (int i = 0; i < METRICS_WAKEUP_CAUSES; i++) {
+		causes[i] = b->wakeup_causes[i] - a->wakeup_causes[i];
+	}
+
+	unsigned long voluntary = b->voluntary_switches -
+		a->voluntary_switches;
+	unsigned long involuntary = b->involuntary_switches -
+		a->involuntary_switches;
+	unsigned long switches = voluntary + involuntary;
+	unsigned long runs = b->runs - a->runs;
+	unsigned long read_calls = b->read_calls - a->read_calls;
+	unsigned long write_calls = b->write_calls - a->write_calls;
+	double cpu = b->cpu_time - a->cpu_time;
+
+	int over_wakeups = wakeups / hours > IDLE_BENCH_BUDGET_WAKEUPS;
+	int over_switches = b->have_switches &&
+		switches / hours > IDLE_BENCH_BUDGET_SWITCHES;
+	int over_cpu = cpu / hours > IDLE_BENCH_BUDGET_CPU;
+
+	if (jsonl != NULL) {
+		char causes_json[256] = "";
+		size_t len = 0;
+		for (int i = 0; i < METRICS_WAKEUP_CAUSES; i++) {
+			len += snprintf(&causes_json[len],
+					sizeof(causes_json) - len,
+					"%s\"%s\":%lu", i > 0 ? "," : "",
+					metrics_wakeup_name(i), causes[i]);
+		}
+
+		char proc[256] = "";
+		len = 0;
+		if (b->have_switches) {
+			len += snprintf(&proc[len], sizeof(proc) - len,
+					",\"voluntary_switches\":%lu,"
+					"\"involuntary_switches\":%lu",
+					voluntary, involuntary);
+		}
+		if (b->have_schedstat) {
+			len += snprintf(&proc[len], sizeof(proc) - len,
+					",\"runs\":%lu", runs);
+		}
+		if (b->have_io) {
+			len += snprintf(&proc[len], sizeof(proc) - len,
+					",\"read_calls\":%lu,"
+					"\"write_calls\":%lu",
+					read_calls, write_calls);
+		}
+
+		output_jsonl_event(jsonl, "idle_bench",
+				   ",\"method\":\"%s\",\"elapsed\":%.3f,"
+				   "\"ticks\":%lu,\"writes\":%lu,"
+				   "\"wakeups\":%lu,\"causes\":{%s},"
+				   "\"cpu\":%.6f%s,\"within_budget\":%s",
+				   method, elapsed, b->ticks - a->ticks,
+				   b->writes - a->writes, wakeups,
+				   causes_json, cpu, proc,
+				   over_wakeups || over_switches ||
+				   over_cpu ? "false" : "true");
+		output_jsonl_flush(jsonl);
+	} else {
+		printf(_("Method `%s' idle for %.1f s\n"), method, elapsed);
+		printf("%-24s %12s %12s\n", "", _("Total"), _("Per hour"));
+		print_row(_("Ticks"), b->ticks - a->ticks, hours);
+		print_row(_("Writes"), b->writes - a->writes, hours);
+		print_row(_("Wakeups"), wakeups, hours);
+		for (int i = 0; i < METRICS_WAKEUP_CAUSES; i++) {
+			char label[32];
+			snprintf(label, sizeof(label), "  %s",
+				 metrics_wakeup_name(i));
+			print_row(label, causes[i], hours);
+		}
+		if (b->have_switches) {
+			print_row(_("Context switches"), switches, hours);
+			print_row(_("  voluntary"), voluntary, hours);
+			print_row(_("  involuntary"), involuntary, hours);
+		}
+		if (b->have_schedstat) {
+			print_row(_("Times scheduled"), runs, hours);
+		}
+		if (b->have_io) {
+			print_row(_("Read syscalls"), read_calls, hours);
+			print_row(_("Write syscalls"), write_calls, hours);
+		}
+		printf("%-24s %12.3f %12.3f\n", _("CPU time (s)"), cpu,
+		       cpu / hours);
+		printf(_("Budget per hour: %d wakeups, %d context switches,"
+			 " %.2f s CPU time\n"), IDLE_BENCH_BUDGET_WAKEUPS,
+		       IDLE_BENCH_BUDGET_SWITCHES, IDLE_BENCH_BUDGET_CPU);
+	}
+
+	if (over_wakeups) fputs(_("Wakeups are over budget.\n"), stderr);
+	if (over_switches) {
+		fputs(_("Context switches are over budget.\n"), stderr);
+	}
+	if (over_cpu) fputs(_("CPU time is over budget.\n"), stderr);
+
+	return over_wakeups || over_switches || over_cpu ? -1 : 0;
+}
@@ -0,0 +1,81 @@
+/* idle-bench.h -- Idle wakeup benchmark header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_IDLE_BENCH_H
+#define REDSHIFT_IDLE_BENCH_H
+
+#include "redshift.h"
+#include "metrics.h"
+#include "output-jsonl.h"
+
+/* Budget per hour of continual mode with the default settings and
+   no transition in progress, see HACKING.md. A tick every
+   SLEEP_DURATION makes 720 wakeups per hour. */
+#define IDLE_BENCH_BUDGET_WAKEUPS  800
+#define IDLE_BENCH_BUDGET_SWITCHES  800
+#define IDLE_BENCH_BUDGET_CPU  0.5
+
+/* Resource usage of the process at one point in time. Counters that
+   the system does not provide are left at zero with the matching
+   have_ flag unset. */
+typedef struct {
+	double monotonic;
+	double cpu_time;
+
+	/* /proc/self/status */
+	int have_switches;
+	unsigned long voluntary_switches;
+	unsigned long involuntary_switches;
+
+	/* /proc/self/schedstat */
+	int have_schedstat;
+	unsigned long runs;
+
+	/* /proc/self/io */
+	int have_io;
+	unsigned long read_calls;
+	unsigned long write_calls;
+
+	unsigned long ticks;
+	unsigned long writes;
+	unsigned long wakeups;
+	unsigned long wakeup_causes[METRICS_WAKEUP_CAUSES];
+} idle_bench_sample_t;
+
+typedef struct {
+	double duration;
+	int started;
+	int finished;
+	idle_bench_sample_t start;
+	idle_bench_sample_t end;
+} idle_bench_t;
+
+
+void idle_bench_init(idle_bench_t *bench, double duration);
+
+void idle_bench_begin(idle_bench_t *bench, const metrics_t *metrics);
+int idle_bench_done(idle_bench_t *bench, const metrics_t *metrics);
+int idle_bench_get_deadline(const idle_bench_t *bench, double now,
+			    double *deadline);
+
+int idle_bench_print(const idle_bench_t *bench, const char *method,
+		     output_jsonl_state_t *jsonl);
+
+
+#endif /* ! REDSHIFT_IDLE_BENCH_H */
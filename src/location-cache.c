@@ -0,0 +1,205 @@
+/* location-cache.c -- Last known location cache source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+# include <pwd.h>
+#endif
+
+#include "location-cache.h"
+#include "systemtime.h"
+
+#ifndef M_PI
+# define M_PI  3.14159265358979323846
+#endif
+
+#define MAX_CACHE_PATH  4096
+
+/* Mean radius of the earth (kilometers). */
+#define EARTH_RADIUS  6371.0
+
+
+/* Find the cache directory following the XDG Base Directory
+   Specification and create it if CREATE is set. */
+static int
+get_cache_dir(char *path, size_t size, int create)
+{
+	char *env;
+	char base[MAX_CACHE_PATH];
+	int n;
+
+	if ((env = getenv("XDG_CACHE_HOME")) != NULL && env[0] != '\0') {
+		n = snprintf(base, sizeof(base), "%s", env);
+#ifdef _WIN32
+	} else if ((env = getenv("localappdata")) != NULL &&
+		   env[0] != '\0') {
+		n = snprintf(base, sizeof(base), "%s", env);
+#endif
+	} else if ((env = getenv("HOME")) != NULL && env[0] != '\0') {
+		n = snprintf(base, sizeof(base), "%s/.cache", env);
+#ifndef _WIN32
+	} else {
+		struct passwd *pwd = getpwuid(getuid());
+		if (pwd == NULL) return -1;
+		n = snprintf(base, sizeof(base), "%s/.cache", pwd->pw_dir);
+#else
+	} else {
+		return -1;
+#endif
+	}
+
+	if (n >= (int)sizeof(base) ||
+	    snprintf(path, size, "%s/redshift", base) >= (int)size) {
+		return -1;
+	}
+
+	if (create) {
+#ifndef _WIN32
+		if (mkdir(base, 0700) < 0 && errno != EEXIST) return -1;
+		if (mkdir(path, 0700) < 0 && errno != EEXIST) return -1;
+#else
+		if (mkdir(base) < 0 && errno != EEXIST) return -1;
+		if (mkdir(path) < 0 && errno != EEXIST) return -1;
+#endif
+	}
+
+	return 0;
+}
+
+/* Great circle distance between two locations (kilometers). */
+static double
+location_distance(const location_t *a, const location_t *b)
+{
+	double lat1 = a->lat * M_PI / 180.0;
+	double lat2 = b->lat * M_PI / 180.0;
+	double dlat = lat2 - lat1;
+	double dlon = (b->lon - a->lon) * M_PI / 180.0;
+
+	double h = pow(sin(dlat / 2.0), 2.0) +
+		cos(lat1) * cos(lat2) * pow(sin(dlon / 2.0), 2.0);
+	return 2.0 * EARTH_RADIUS * asin(sqrt(fmin(1.0, h)));
+}
+
+/* Load the last known location. Returns -1 if there is none. */
+int
+location_cache_load(location_cache_entry_t *entry)
+{
+	char dir[MAX_CACHE_PATH];
+	char path[MAX_CACHE_PATH];
+
+	if (get_cache_dir(dir, sizeof(dir), 0) < 0 ||
+	    snprintf(path, sizeof(path), "%s/location", dir) >=
+	    (int)sizeof(path)) {
+		return -1;
+	}
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL) return -1;
+
+	char fmt[32];
+	snprintf(fmt, sizeof(fmt), "%%f %%f %%lf %%%ds",
+		 LOCATION_CACHE_SOURCE_MAX - 1);
+
+	int r = fscanf(f, fmt, &entry->loc.lat, &entry->loc.lon,
+		       &entry->timestamp, entry->source);
+	fclose(f);
+
+	if (r != 4 ||
+	    entry->loc.lat < -90.0 || entry->loc.lat > 90.0 ||
+	    entry->loc.lon < -180.0 || entry->loc.lon > 180.0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Remember LOC obtained from SOURCE. The file is only replaced if
+   the location moved more than LOCATION_CACHE_THRESHOLD, and is
+   replaced atomically so a crash never leaves a partial file. */
+int
+location_cache_store(const location_t *loc, const char *source)
+{
+	location_cache_entry_t old;
+	if (location_cache_load(&old) == 0 &&
+	    location_distance(&old.loc, loc) < LOCATION_CACHE_THRESHOLD) {
+		return 0;
+	}
+
+	char dir[MAX_CACHE_PATH];
+	char path[MAX_CACHE_PATH];
+	char tmp_path[MAX_CACHE_PATH];
+
+	if (get_cache_dir(dir, sizeof(dir), 1) < 0 ||
+	    snprintf(path, sizeof(path), "%s/location", dir) >=
+	    (int)sizeof(path)) {
+		return -1;
+	}
+
+	double now;
+	if (systemtime_get_time(&now) < 0) now = 0.0;
+
+#ifndef _WIN32
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s/location.XXXXXX",
+		     dir) >= (int)sizeof(tmp_path)) {
+		return -1;
+	}
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) return -1;
+	FILE *f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		unlink(tmp_path);
+		return -1;
+	}
+#else
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s/location.tmp",
+		     dir) >= (int)sizeof(tmp_path)) {
+		return -1;
+	}
+	FILE *f = fopen(tmp_path, "w");
+	if (f == NULL) return -1;
+#endif
+
+	fprintf(f, "%.6f %.6f %.0f %.*s\n", loc->lat, loc->lon, now,
+		LOCATION_CACHE_SOURCE_MAX - 1, source);
+
+	if (fflush(f) != 0 || ferror(f)) {
+		fclose(f);
+		unlink(tmp_path);
+		return -1;
+	}
+	fclose(f);
+
+#ifdef _WIN32
+	remove(path);
+#endif
+	if (rename(tmp_path, path) < 0) {
+		unlink(tmp_path);
+		return -1;
+	}
+
+	return 0;
+}
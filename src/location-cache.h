@@ -0,0 +1,42 @@
+/* location-cache.h -- Last known location cache header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_LOCATION_CACHE_H
+#define REDSHIFT_LOCATION_CACHE_H
+
+#include "redshift.h"
+
+/* The cache is only rewritten when the location moved further than
+   this (kilometers). */
+#define LOCATION_CACHE_THRESHOLD  10.0
+
+#define LOCATION_CACHE_SOURCE_MAX  32
+
+typedef struct {
+	location_t loc;
+	double timestamp;
+	char source[LOCATION_CACHE_SOURCE_MAX];
+} location_cache_entry_t;
+
+
+int location_cache_load(location_cache_entry_t *entry);
+int location_cache_store(const location_t *loc, const char *source);
+
+
+#endif /* ! REDSHIFT_LOCATION_CACHE_H */
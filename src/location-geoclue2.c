@@ -19,6 +19,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #include <glib.h>
 #include <glib/gprintf.h>
@@ -35,32 +39,45 @@
 #endif
 
 
-typedef struct {
-	GMainLoop *loop;
-
-	int available;
-	location_t location;
-} get_location_data_t;
+/* Notify the reader of the pipe that the state changed. Must be
+   called with the lock held. */
+static void
+notify_change(location_geoclue2_state_t *state)
+{
+	while (write(state->pipe_fd_write, "", 1) < 0 &&
+	       errno == EINTR);
+}
 
+/* Mark the provider as failed. */
+static void
+mark_error(location_geoclue2_state_t *state)
+{
+	g_mutex_lock(&state->lock);
+	state->error = 1;
+	notify_change(state);
+	g_mutex_unlock(&state->lock);
+}
 
 int
-location_geoclue2_init(void *state)
+location_geoclue2_init(location_geoclue2_state_t *state)
 {
 #if !GLIB_CHECK_VERSION(2, 35, 0)
 	g_type_init();
 #endif
-	return 0;
-}
 
-int
-location_geoclue2_start(void *state)
-{
-	return 0;
-}
+	state->context = NULL;
+	state->loop = NULL;
+	state->thread = NULL;
+	state->pipe_fd_read = -1;
+	state->pipe_fd_write = -1;
 
-void
-location_geoclue2_free(void *state)
-{
+	g_mutex_init(&state->lock);
+	state->available = 0;
+	state->error = 0;
+	state->location.lat = 0;
+	state->location.lon = 0;
+
+	return 0;
 }
 
 void
@@ -69,15 +86,15 @@ location_geoclue2_print_help(FILE *f)
 	fputs(_("Use the location as discovered by a GeoClue2 provider.\n"), f);
 	fputs("\n", f);
 
-	fprintf(f, _("NOTE: currently Redshift doesn't recheck %s once started,\n"
-		     "which means it has to be restarted to take notice after travel.\n"),
+	fprintf(f, _("In continual mode %s is followed while running,\n"
+		     "so the location is updated after travel.\n"),
 		"GeoClue2");
 	fputs("\n", f);
 }
 
 int
-location_geoclue2_set_option(void *state,
-			    const char *key, const char *value)
+location_geoclue2_set_option(location_geoclue2_state_t *state,
+			     const char *key, const char *value)
 {
 	fprintf(stderr, _("Unknown method parameter: `%s'.\n"), key);
 	return -1;
@@ -87,9 +104,9 @@ location_geoclue2_set_option(void *state,
 static void
 geoclue_client_signal_cb(GDBusProxy *client, gchar *sender_name,
 			 gchar *signal_name, GVariant *parameters,
-			 gpointer *user_data)
+			 gpointer user_data)
 {
-	get_location_data_t *data = (get_location_data_t *)user_data;
+	location_geoclue2_state_t *state = user_data;
 
 	/* Only handle LocationUpdated signals */
 	if (g_strcmp0(signal_name, "LocationUpdated") != 0) {
@@ -120,16 +137,21 @@ geoclue_client_signal_cb(GDBusProxy *client, gchar *sender_name,
 	/* Read location properties */
 	GVariant *lat_v = g_dbus_proxy_get_cached_property(location,
 							   "Latitude");
-	data->location.lat = g_variant_get_double(lat_v);
-
 	GVariant *lon_v = g_dbus_proxy_get_cached_property(location,
 							   "Longitude");
-	data->location.lon = g_variant_get_double(lon_v);
-
-	data->available = 1;
 
-	/* Return from main loop */
-	g_main_loop_quit(data->loop);
+	/* Keep listening; further updates arrive when the location
+	   moves beyond the distance threshold. */
+	g_mutex_lock(&state->lock);
+	state->location.lat = g_variant_get_double(lat_v);
+	state->location.lon = g_variant_get_double(lon_v);
+	state->available = 1;
+	notify_change(state);
+	g_mutex_unlock(&state->lock);
+
+	g_variant_unref(lat_v);
+	g_variant_unref(lon_v);
+	g_object_unref(location);
 }
 
 /* Callback when GeoClue name appears on the bus */
@@ -137,7 +159,7 @@ static void
 on_name_appeared(GDBusConnection *conn, const gchar *name,
 		 const gchar *name_owner, gpointer user_data)
 {
-	get_location_data_t *data = (get_location_data_t *)user_data;
+	location_geoclue2_state_t *state = user_data;
 
 	/* Obtain GeoClue Manager */
 	GError *error = NULL;
@@ -153,6 +175,7 @@ on_name_appeared(GDBusConnection *conn, const gchar *name,
 		g_printerr(_("Unable to obtain GeoClue Manager: %s.\n"),
 			   error->message);
 		g_error_free(error);
+		mark_error(state);
 		return;
 	}
 
@@ -169,6 +192,7 @@ on_name_appeared(GDBusConnection *conn, const gchar *name,
 			   error->message);
 		g_error_free(error);
 		g_object_unref(geoclue_manager);
+		mark_error(state);
 		return;
 	}
 
@@ -191,6 +215,7 @@ on_name_appeared(GDBusConnection *conn, const gchar *name,
 		g_error_free(error);
 		g_variant_unref(client_path_v);
 		g_object_unref(geoclue_manager);
+		mark_error(state);
 		return;
 	}
 
@@ -230,6 +255,7 @@ on_name_appeared(GDBusConnection *conn, const gchar *name,
 		g_error_free(error);
 		g_object_unref(geoclue_client);
 		g_object_unref(geoclue_manager);
+		mark_error(state);
 		return;
 	}
 
@@ -238,7 +264,7 @@ on_name_appeared(GDBusConnection *conn, const gchar *name,
 	/* Attach signal callback to client */
 	g_signal_connect(geoclue_client, "g-signal",
 			 G_CALLBACK(geoclue_client_signal_cb),
-			 data);
+			 state);
 
 	/* Start GeoClue client */
 	error = NULL;
@@ -253,6 +279,7 @@ on_name_appeared(GDBusConnection *conn, const gchar *name,
 		g_error_free(error);
 		g_object_unref(geoclue_client);
 		g_object_unref(geoclue_manager);
+		mark_error(state);
 		return;
 	}
 
@@ -264,34 +291,141 @@ static void
 on_name_vanished(GDBusConnection *connection, const gchar *name,
 		 gpointer user_data)
 {
-	get_location_data_t *data = (get_location_data_t *)user_data;
+	location_geoclue2_state_t *state = user_data;
 
 	g_fprintf(stderr, _("Unable to connect to GeoClue.\n"));
 
-	g_main_loop_quit(data->loop);
+	mark_error(state);
 }
 
-int
-location_geoclue2_get_location(void *state,
-			       location_t *location)
+/* Main loop of the GeoClue thread. */
+static gpointer
+run_geoclue2_loop(gpointer user_data)
 {
-	get_location_data_t data;
-	data.available = 0;
+	location_geoclue2_state_t *state = user_data;
+
+	g_main_context_push_thread_default(state->context);
 
 	guint watcher_id = g_bus_watch_name(G_BUS_TYPE_SYSTEM,
 					    "org.freedesktop.GeoClue2",
 					    G_BUS_NAME_WATCHER_FLAGS_AUTO_START,
 					    on_name_appeared,
 					    on_name_vanished,
-					    &data, NULL);
-	data.loop = g_main_loop_new(NULL, FALSE);
-	g_main_loop_run(data.loop);
+					    state, NULL);
+	g_main_loop_run(state->loop);
 
 	g_bus_unwatch_name(watcher_id);
 
-	if (!data.available) return -1;
+	g_main_context_pop_thread_default(state->context);
+
+	return NULL;
+}
+
+int
+location_geoclue2_start(location_geoclue2_state_t *state)
+{
+	int pipefds[2];
+	int r = pipe(pipefds);
+	if (r < 0) {
+		perror("pipe");
+		return -1;
+	}
+
+	state->pipe_fd_read = pipefds[0];
+	state->pipe_fd_write = pipefds[1];
+
+	/* Reads are done from the main loop and must never block. */
+	fcntl(state->pipe_fd_read, F_SETFL, O_NONBLOCK);
+	fcntl(state->pipe_fd_read, F_SETFD, FD_CLOEXEC);
+	fcntl(state->pipe_fd_write, F_SETFD, FD_CLOEXEC);
 
-	*location = data.location;
+	state->context = g_main_context_new();
+	state->loop = g_main_loop_new(state->context, FALSE);
+	state->thread = g_thread_new("geoclue2", run_geoclue2_loop, state);
 
 	return 0;
 }
+
+static gboolean
+quit_loop_cb(gpointer user_data)
+{
+	g_main_loop_quit(user_data);
+	return FALSE;
+}
+
+void
+location_geoclue2_free(location_geoclue2_state_t *state)
+{
+	if (state->thread != NULL) {
+		/* Quit from within the loop, which also works if the
+		   thread has not started running it yet. */
+		GSource *source = g_idle_source_new();
+		g_source_set_callback(source, quit_loop_cb, state->loop, NULL);
+		g_source_attach(source, state->context);
+		g_source_unref(source);
+
+		g_thread_join(state->thread);
+		state->thread = NULL;
+	}
+
+	if (state->loop != NULL) g_main_loop_unref(state->loop);
+	if (state->context != NULL) g_main_context_unref(state->context);
+	state->loop = NULL;
+	state->context = NULL;
+
+	if (state->pipe_fd_read >= 0) close(state->pipe_fd_read);
+	if (state->pipe_fd_write >= 0) close(state->pipe_fd_write);
+	state->pipe_fd_read = -1;
+	state->pipe_fd_write = -1;
+
+	g_mutex_clear(&state->lock);
+}
+
+/* File descriptor that becomes readable when the location changes
+   or the provider fails. */
+int
+location_geoclue2_get_fd(location_geoclue2_state_t *state)
+{
+	return state->pipe_fd_read;
+}
+
+/* Fetch the latest location. AVAILABLE is cleared if no location
+   has been obtained yet. Returns -1 if the provider failed. */
+int
+location_geoclue2_handle(location_geoclue2_state_t *state,
+			 location_t *location, int *available)
+{
+	char buf[16];
+	while (read(state->pipe_fd_read, buf, sizeof(buf)) > 0);
+
+	g_mutex_lock(&state->lock);
+	int error = state->error;
+	*location = state->location;
+	*available = state->available;
+	g_mutex_unlock(&state->lock);
+
+	if (error) return -1;
+
+	return 0;
+}
+
+/* Block until the first location is available. */
+int
+location_geoclue2_get_location(location_geoclue2_state_t *state,
+			       location_t *location)
+{
+	while (1) {
+		struct pollfd pfd = { state->pipe_fd_read, POLLIN, 0 };
+		int r = poll(&pfd, 1, -1);
+		if (r < 0) {
+			if (errno == EINTR) continue;
+			perror("poll");
+			return -1;
+		}
+
+		int available;
+		r = location_geoclue2_handle(state, location, &available);
+		if (r < 0) return -1;
+		if (available) return 0;
+	}
+}
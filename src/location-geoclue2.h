@@ -21,20 +21,41 @@
 #define REDSHIFT_LOCATION_GEOCLUE2_H
 
 #include <stdio.h>
+#include <glib.h>
 
 #include "redshift.h"
 
+typedef struct {
+	/* GeoClue is driven from its own thread and main context so
+	   the caller's loop is never blocked. */
+	GMainContext *context;
+	GMainLoop *loop;
+	GThread *thread;
 
-int location_geoclue2_init(void *state);
-int location_geoclue2_start(void *state);
-void location_geoclue2_free(void *state);
+	/* Written to whenever the shared fields below change. */
+	int pipe_fd_read;
+	int pipe_fd_write;
+
+	GMutex lock;
+	int available;
+	int error;
+	location_t location;
+} location_geoclue2_state_t;
+
+
+int location_geoclue2_init(location_geoclue2_state_t *state);
+int location_geoclue2_start(location_geoclue2_state_t *state);
+void location_geoclue2_free(location_geoclue2_state_t *state);
 
 void location_geoclue2_print_help(FILE *f);
-int location_geoclue2_set_option(void *state,
+int location_geoclue2_set_option(location_geoclue2_state_t *state,
 				 const char *key, const char *value);
 
-int location_geoclue2_get_location(void *state,
+int location_geoclue2_get_location(location_geoclue2_state_t *state,
 				   location_t *loc);
+int location_geoclue2_get_fd(location_geoclue2_state_t *state);
+int location_geoclue2_handle(location_geoclue2_state_t *state,
+			     location_t *location, int *available);
 
 
 #endif /* ! REDSHIFT_LOCATION_GEOCLUE2_H */
@@ -24,6 +24,7 @@
 #include <errno.h>
 
 #include "location-manual.h"
+#include "citydb.h"
 
 #ifdef ENABLE_NLS
 # include <libintl.h>
@@ -38,6 +39,8 @@ location_manual_init(location_manual_state_t *state)
 {
 	state->loc.lat = NAN;
 	state->loc.lon = NAN;
+	state->city = NULL;
+	state->citydb = NULL;
 
 	return 0;
 }
@@ -45,10 +48,32 @@ location_manual_init(location_manual_state_t *state)
 int
 location_manual_start(location_manual_state_t *state)
 {
+	/* Look up the city unless coordinates were given as well. */
+	if (state->city != NULL &&
+	    (isnan(state->loc.lat) || isnan(state->loc.lon))) {
+		const char *path = state->citydb != NULL ?
+			state->citydb : CITYDB_PATH;
+		citydb_t db;
+		int r = citydb_open(&db, path);
+		if (r < 0) return -1;
+
+		location_t loc;
+		r = citydb_lookup(&db, state->city, &loc);
+		citydb_close(&db);
+		if (r < 0) {
+			fprintf(stderr, _("Unknown city `%s'.\n"),
+				state->city);
+			return -1;
+		}
+
+		if (isnan(state->loc.lat)) state->loc.lat = loc.lat;
+		if (isnan(state->loc.lon)) state->loc.lon = loc.lon;
+	}
+
 	/* Latitude and longitude must be set */
 	if (isnan(state->loc.lat) || isnan(state->loc.lon)) {
 		fputs(_("Latitude and longitude must be set.\n"), stderr);
-		exit(EXIT_FAILURE);
+		return -1;
 	}
 
 	return 0;
@@ -57,6 +82,10 @@ location_manual_start(location_manual_state_t *state)
 void
 location_manual_free(location_manual_state_t *state)
 {
+	free(state->city);
+	state->city = NULL;
+	free(state->citydb);
+	state->citydb = NULL;
 }
 
 void
@@ -68,7 +97,9 @@ location_manual_print_help(FILE *f)
 	/* TRANSLATORS: Manual location help output
 	   left column must not be translated */
 	fputs(_("  lat=N\t\tLatitude\n"
-		"  lon=N\t\tLongitude\n"), f);
+		"  lon=N\t\tLongitude\n"
+		"  city=NAME\tLook up location of city (e.g. `Paris,FR')\n"
+		"  citydb=PATH\tCity database to use\n"), f);
 	fputs("\n", f);
 	fputs(_("Both values are expected to be floating point numbers,\n"
 		"negative values representing west / south, respectively.\n"), f);
@@ -79,6 +110,24 @@ int
 location_manual_set_option(location_manual_state_t *state, const char *key,
 			   const char *value)
 {
+	if (strcasecmp(key, "city") == 0) {
+		free(state->city);
+		state->city = strdup(value);
+		if (state->city == NULL) {
+			perror("strdup");
+			return -1;
+		}
+		return 0;
+	} else if (strcasecmp(key, "citydb") == 0) {
+		free(state->citydb);
+		state->citydb = strdup(value);
+		if (state->citydb == NULL) {
+			perror("strdup");
+			return -1;
+		}
+		return 0;
+	}
+
 	/* Parse float value */
 	char *end;
 	errno = 0;
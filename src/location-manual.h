@@ -27,6 +27,8 @@
 
 typedef struct {
 	location_t loc;
+	char *city;
+	char *citydb;
 } location_manual_state_t;
 
 
@@ -0,0 +1,477 @@
+/* location-task.c -- Concurrent location lookup source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "location-task.h"
+#include "systemtime.h"
+#include "trace.h"
+
+
+static int
+provider_try_start(const location_provider_t *provider, void *state,
+		   config_ini_state_t *config, char *args)
+{
+	int r;
+
+	r = provider->init(state);
+	if (r < 0) {
+		fprintf(stderr, _("Initialization of %s failed.\n"),
+			provider->name);
+		return -1;
+	}
+
+	/* Set provider options from config file. */
+	config_ini_section_t *section =
+		config_ini_get_section(config, provider->name);
+	if (section != NULL) {
+		config_ini_setting_t *setting = section->settings;
+		while (setting != NULL) {
+			r = provider->set_option(state, setting->name,
+						 setting->value);
+			if (r < 0) {
+				provider->free(state);
+				fprintf(stderr, _("Failed to set %s"
+						  " option.\n"),
+					provider->name);
+				/* TRANSLATORS: `help' must not be
+				   translated. */
+				fprintf(stderr, _("Try `-l %s:help' for more"
+						  " information.\n"),
+					provider->name);
+				return -1;
+			}
+			setting = setting->next;
+		}
+	}
+
+	/* Set provider options from command line. */
+	const char *manual_keys[] = { "lat", "lon" };
+	int i = 0;
+	while (args != NULL) {
+		char *next_arg = strchr(args, ':');
+		if (next_arg != NULL) *(next_arg++) = '\0';
+
+		const char *key = args;
+		char *value = strchr(args, '=');
+		if (value == NULL) {
+			/* The options for the "manual" method can be set
+			   without keys on the command line for convencience
+			   and for backwards compatability. We add the proper
+			   keys here before calling set_option(). */
+			if (strcmp(provider->name, "manual") == 0 &&
+			    i < sizeof(manual_keys)/sizeof(manual_keys[0])) {
+				key = manual_keys[i];
+				value = args;
+			} else {
+				fprintf(stderr, _("Failed to parse option `%s'.\n"),
+					args);
+				return -1;
+			}
+		} else {
+			*(value++) = '\0';
+		}
+
+		r = provider->set_option(state, key, value);
+		if (r < 0) {
+			provider->free(state);
+			fprintf(stderr, _("Failed to set %s option.\n"),
+				provider->name);
+			/* TRANSLATORS: `help' must not be translated. */
+			fprintf(stderr, _("Try `-l %s:help' for more"
+					  " information.\n"), provider->name);
+			return -1;
+		}
+
+		args = next_arg;
+		i += 1;
+	}
+
+	/* Start provider. */
+	r = provider->start(state);
+	if (r < 0) {
+		provider->free(state);
+		fprintf(stderr, _("Failed to start provider %s.\n"),
+			provider->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Initialize location provider and get current location. Runs in the
+   background. */
+static int
+location_probe_run(void *data)
+{
+	location_probe_t *probe = data;
+	void *state = probe->state;
+	int r;
+
+	double start = trace_begin();
+	r = provider_try_start(probe->provider, state,
+			       probe->config, probe->provider_args);
+	trace_end("location", start, "provider_try_start %s",
+		  probe->provider->name);
+	if (r < 0) return -1;
+
+	/* Get current location. */
+	start = trace_begin();
+	r = probe->provider->get_location(state, &probe->loc);
+	trace_end("location", start, "get_location %s",
+		  probe->provider->name);
+	if (r < 0 || !probe->follow || probe->provider->get_fd == NULL) {
+		probe->provider->free(state);
+	} else {
+		probe->started = 1;
+	}
+
+	if (r < 0) {
+		fprintf(stderr, _("Unable to get location from provider"
+				  " `%s'.\n"), probe->provider->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Start looking up the location using the COUNT PROVIDERS, each with
+   STATE_SIZE bytes of state. ON_FIX is called with DATA for every
+   location that is taken. */
+int
+location_task_start(location_task_t *task,
+		    const location_provider_t *providers, int count,
+		    size_t state_size, int autodetect,
+		    char *provider_args, config_ini_state_t *config,
+		    int follow, double timeout,
+		    location_task_fix_func *on_fix, void *data)
+{
+	/* Probes that are abandoned keep running, so they are only
+	   freed once every probe has returned. */
+	task->probes = calloc(count, sizeof(location_probe_t));
+	if (task->probes == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		task->probes[i].state = calloc(1, state_size);
+		if (task->probes[i].state == NULL) {
+			perror("calloc");
+			while (i-- > 0) free(task->probes[i].state);
+			free(task->probes);
+			return -1;
+		}
+	}
+
+	task->probe_count = count;
+	task->autodetect = autodetect;
+	task->winner = NULL;
+	task->timeout = timeout;
+	task->pending = 1;
+	task->fallback = 0;
+	task->fix_time = NAN;
+	task->trace_start = trace_begin();
+	task->on_fix = on_fix;
+	task->data = data;
+
+	if (systemtime_get_monotonic_time(&task->deadline) < 0) {
+		task->deadline = 0.0;
+	}
+	task->deadline += timeout;
+
+	for (int i = 0; i < count; i++) {
+		location_probe_t *probe = &task->probes[i];
+		probe->provider = &providers[i];
+		probe->provider_args = provider_args;
+		probe->config = config;
+		probe->follow = follow;
+		probe->started = 0;
+		probe->returned = 0;
+		probe->valid = 0;
+
+		if (task->autodetect) {
+			fprintf(stderr,
+				_("Trying location provider `%s'...\n"),
+				probe->provider->name);
+		}
+
+		int r = background_start(&probe->bg, location_probe_run,
+					 probe);
+		if (r < 0) return -1;
+	}
+
+	return 0;
+}
+
+/* Check that location is within valid range. */
+int
+location_is_valid(const location_t *loc)
+{
+	/* Latitude */
+	if (loc->lat < MIN_LAT || loc->lat > MAX_LAT) {
+		/* TRANSLATORS: Append degree symbols if possible. */
+		fprintf(stderr,
+			_("Latitude must be between %.1f and %.1f.\n"),
+			MIN_LAT, MAX_LAT);
+		return 0;
+	}
+
+	/* Longitude */
+	if (loc->lon < MIN_LON || loc->lon > MAX_LON) {
+		/* TRANSLATORS: Append degree symbols if possible. */
+		fprintf(stderr,
+			_("Longitude must be between"
+			  " %.1f and %.1f.\n"), MIN_LON, MAX_LON);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Store LOC as the new location and report it. */
+static void
+location_task_accept(location_task_t *task, location_t *loc,
+		     const location_t *update, int first)
+{
+	*loc = *update;
+	if (systemtime_get_time(&task->fix_time) < 0) task->fix_time = NAN;
+
+	if (task->on_fix != NULL) {
+		task->on_fix(task->data, task->winner->provider, loc, first);
+	}
+}
+
+/* Collect probes that returned and take updates from the winning
+   provider. Returns 1 if LOC changed, 0 if not and -1 if no location
+   could be obtained before the deadline. */
+int
+location_task_poll(location_task_t *task, location_t *loc)
+{
+	int changed = 0;
+
+	for (int i = 0; i < task->probe_count; i++) {
+		location_probe_t *probe = &task->probes[i];
+		if (probe->returned || !background_done(&probe->bg)) {
+			continue;
+		}
+
+		int r = background_join(&probe->bg);
+		probe->returned = 1;
+		probe->valid = task->pending && r == 0 &&
+			location_is_valid(&probe->loc);
+		if (!probe->valid && probe->started) {
+			/* Late or invalid answer. */
+			probe->provider->free(probe->state);
+			probe->started = 0;
+		}
+	}
+
+	if (task->pending) {
+		double now;
+		if (systemtime_get_monotonic_time(&now) < 0) now = 0.0;
+		int expired = now >= task->deadline;
+
+		/* Use the first valid location unless a provider before
+		   it may still answer in time. */
+		location_probe_t *best = NULL;
+		int running = 0;
+		for (int i = 0; i < task->probe_count; i++) {
+			location_probe_t *probe = &task->probes[i];
+			if (probe->valid) {
+				best = probe;
+				break;
+			} else if (!probe->returned) {
+				running += 1;
+				if (!expired) break;
+			}
+		}
+
+		if (best == NULL) {
+			if (running > 0 && !expired) return 0;
+
+			if (running > 0) {
+				fprintf(stderr, _("No location after %.1f"
+						  " seconds.\n"),
+					task->timeout);
+			} else if (task->autodetect) {
+				fputs(_("No more location providers to"
+					" try.\n"), stderr);
+			}
+
+			task->pending = 0;
+			if (task->fallback) {
+				fputs(_("Keeping the cached location.\n"),
+				      stderr);
+				return 0;
+			}
+			return -1;
+		}
+
+		task->winner = best;
+		task->pending = 0;
+		if (task->autodetect) {
+			printf(_("Using provider `%s'.\n"),
+			       best->provider->name);
+		}
+		trace_end("location", task->trace_start, "location wait");
+		trace_write();
+		location_task_accept(task, loc, &best->loc, 1);
+		changed = 1;
+
+		/* Stop the providers that lost. */
+		for (int i = 0; i < task->probe_count; i++) {
+			location_probe_t *probe = &task->probes[i];
+			if (probe != best && probe->returned &&
+			    probe->started) {
+				probe->provider->free(probe->state);
+				probe->started = 0;
+			}
+		}
+	}
+
+	/* Follow the location if the winning provider keeps running. */
+	location_probe_t *winner = task->winner;
+	if (winner == NULL || !winner->started) return changed;
+
+#ifndef _WIN32
+	struct pollfd pfd = {
+		winner->provider->get_fd(winner->state), POLLIN, 0
+	};
+	if (poll(&pfd, 1, 0) <= 0) return changed;
+#endif
+
+	location_t update;
+	int available;
+	int r = winner->provider->handle(winner->state, &update,
+					 &available);
+	if (r < 0) {
+		fputs(_("Location provider stopped; keeping the last"
+			" location.\n"), stderr);
+		winner->provider->free(winner->state);
+		winner->started = 0;
+		return changed;
+	}
+
+	if (!available ||
+	    (update.lat == loc->lat && update.lon == loc->lon) ||
+	    !location_is_valid(&update)) {
+		return changed;
+	}
+
+	location_task_accept(task, loc, &update, 0);
+	return 1;
+}
+
+#ifndef _WIN32
+/* Add the file descriptors that signal progress of the lookup to FDS
+   and return the number added. */
+int
+location_task_get_fds(const location_task_t *task, struct pollfd *fds)
+{
+	int nfds = 0;
+	if (task == NULL) return 0;
+
+	for (int i = 0; i < task->probe_count; i++) {
+		const location_probe_t *probe = &task->probes[i];
+		int fd = -1;
+		if (!probe->returned) {
+			fd = probe->bg.fd;
+		} else if (probe == task->winner && probe->started) {
+			fd = probe->provider->get_fd(probe->state);
+		}
+
+		if (fd >= 0) {
+			fds[nfds].fd = fd;
+			fds[nfds].events = POLLIN;
+			nfds += 1;
+		}
+	}
+
+	return nfds;
+}
+#endif
+
+/* Wait until a location is available. Returns -1 if no valid
+   location was obtained before the deadline. */
+int
+location_task_wait(location_task_t *task, location_t *loc)
+{
+	while (1) {
+		int r = location_task_poll(task, loc);
+		if (r < 0) return -1;
+		if (!task->pending) return 0;
+
+#ifndef _WIN32
+		double now;
+		if (systemtime_get_monotonic_time(&now) < 0) now = 0.0;
+
+		struct pollfd fds[task->probe_count];
+		int nfds = location_task_get_fds(task, fds);
+		double remaining = fmax(0.0, task->deadline - now);
+		r = poll(fds, nfds, ceil(remaining * 1000.0));
+		if (r < 0 && errno != EINTR) {
+			perror("poll");
+			return -1;
+		}
+#endif
+	}
+}
+
+/* Stop the provider that follows the location and abandon probes
+   that are still running. Returns the number of probes that have
+   not returned yet; these still use the configuration. */
+int
+location_task_free(location_task_t *task)
+{
+	int running = 0;
+	for (int i = 0; i < task->probe_count; i++) {
+		location_probe_t *probe = &task->probes[i];
+		if (!probe->returned && probe->bg.running) {
+			background_detach(&probe->bg);
+			running += 1;
+		} else if (probe->started) {
+			probe->provider->free(probe->state);
+			probe->started = 0;
+		}
+	}
+
+	if (running == 0) {
+		for (int i = 0; i < task->probe_count; i++) {
+			free(task->probes[i].state);
+		}
+		free(task->probes);
+	}
+	return running;
+}
@@ -0,0 +1,107 @@
+/* location-task.h -- Concurrent location lookup header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_LOCATION_TASK_H
+#define REDSHIFT_LOCATION_TASK_H
+
+#include <stddef.h>
+
+#ifndef _WIN32
+# include <poll.h>
+#endif
+
+#include "redshift.h"
+#include "config-ini.h"
+#include "background.h"
+
+/* Called for every location that is taken: the first fix, with FIRST
+   set, and later updates from a provider that follows the location. */
+typedef void location_task_fix_func(void *data,
+				    const location_provider_t *provider,
+				    const location_t *loc, int first);
+
+/* A location provider queried in the background. */
+typedef struct {
+	const location_provider_t *provider;
+	char *provider_args;
+	config_ini_state_t *config;
+	location_t loc;
+	background_t bg;
+
+	/* Keep providers that support it running after the first
+	   location for updates. STARTED is set while they run. */
+	int follow;
+	int started;
+	void *state;
+
+	/* Set once the result has been collected, and VALID if it was
+	   a usable location. */
+	int returned;
+	int valid;
+} location_probe_t;
+
+/* Location lookup which runs while the adjustment method starts. If
+   no provider was selected all providers are probed concurrently.
+   Providers are preferred in the order they are listed, so a location
+   is used as soon as every provider before it has failed. The others
+   are abandoned and cleaned up whenever they return. */
+typedef struct {
+	location_probe_t *probes;
+	int probe_count;
+	int autodetect;
+	location_probe_t *winner;
+
+	/* Give up waiting at this (monotonic) time. */
+	double deadline;
+	double timeout;
+
+	/* PENDING is set until a location is available or the lookup
+	   failed. FALLBACK is set if a cached location is in use which
+	   is kept if the lookup fails. */
+	int pending;
+	int fallback;
+
+	/* Start of the lookup for the startup trace. */
+	double trace_start;
+
+	/* Time of the last location fix, NAN if none yet. */
+	double fix_time;
+
+	location_task_fix_func *on_fix;
+	void *data;
+} location_task_t;
+
+
+int location_task_start(location_task_t *task,
+			const location_provider_t *providers, int count,
+			size_t state_size, int autodetect,
+			char *provider_args, config_ini_state_t *config,
+			int follow, double timeout,
+			location_task_fix_func *on_fix, void *data);
+int location_task_poll(location_task_t *task, location_t *loc);
+#ifndef _WIN32
+int location_task_get_fds(const location_task_t *task, struct pollfd *fds);
+#endif
+int location_task_wait(location_task_t *task, location_t *loc);
+int location_task_free(location_task_t *task);
+
+int location_is_valid(const location_t *loc);
+
+
+#endif /* ! REDSHIFT_LOCATION_TASK_H */
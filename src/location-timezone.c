@@ -0,0 +1,696 @@
+/* location-timezone.c -- Time zone location provider source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "location-timezone.h"
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#define DEFAULT_ZONEINFO_DIR  "/usr/share/zoneinfo"
+
+#define MAX_ZONE_PATH  4096
+
+
+/* Principal location of each time zone from the tzdata files
+   zone1970.tab and zone.tab (version 2025b). Coordinates are in
+   minutes of arc. Sorted by name for binary search. */
+typedef struct {
+	const char *name;
+	short lat;
+	short lon;
+} zone_location_t;
+
+static const zone_location_t zone_locations[] = {
+	{ "Africa/Abidjan", 319, -242 },
+	{ "Africa/Accra", 333, -13 },
+	{ "Africa/Addis_Ababa", 542, 2322 },
+	{ "Africa/Algiers", 2207, 183 },
+	{ "Africa/Asmara", 920, 2333 },
+	{ "Africa/Bamako", 759, -480 },
+	{ "Africa/Bangui", 262, 1115 },
+	{ "Africa/Banjul", 808, -999 },
+	{ "Africa/Bissau", 711, -935 },
+	{ "Africa/Blantyre", -947, 2100 },
+	{ "Africa/Brazzaville", -256, 917 },
+	{ "Africa/Bujumbura", -203, 1762 },
+	{ "Africa/Cairo", 1803, 1875 },
+	{ "Africa/Casablanca", 2019, -455 },
+	{ "Africa/Ceuta", 2153, -319 },
+	{ "Africa/Conakry", 571, -823 },
+	{ "Africa/Dakar", 880, -1046 },
+	{ "Africa/Dar_es_Salaam", -408, 2357 },
+	{ "Africa/Djibouti", 696, 2589 },
+	{ "Africa/Douala", 243, 582 },
+	{ "Africa/El_Aaiun", 1629, -792 },
+	{ "Africa/Freetown", 510, -795 },
+	{ "Africa/Gaborone", -1479, 1555 },
+	{ "Africa/Harare", -1070, 1863 },
+	{ "Africa/Johannesburg", -1575, 1680 },
+	{ "Africa/Juba", 291, 1897 },
+	{ "Africa/Kampala", 19, 1945 },
+	{ "Africa/Khartoum", 936, 1952 },
+	{ "Africa/Kigali", -117, 1804 },
+	{ "Africa/Kinshasa", -258, 918 },
+	{ "Africa/Lagos", 387, 204 },
+	{ "Africa/Libreville", 23, 567 },
+	{ "Africa/Lome", 368, 73 },
+	{ "Africa/Luanda", -528, 794 },
+	{ "Africa/Lubumbashi", -700, 1648 },
+	{ "Africa/Lusaka", -925, 1697 },
+	{ "Africa/Malabo", 225, 527 },
+	{ "Africa/Maputo", -1558, 1955 },
+	{ "Africa/Maseru", -1768, 1650 },
+	{ "Africa/Mbabane", -1578, 1866 },
+	{ "Africa/Mogadishu", 124, 2722 },
+	{ "Africa/Monrovia", 378, -647 },
+	{ "Africa/Nairobi", -77, 2209 },
+	{ "Africa/Ndjamena", 727, 903 },
+	{ "Africa/Niamey", 811, 127 },
+	{ "Africa/Nouakchott", 1086, -957 },
+	{ "Africa/Ouagadougou", 742, -91 },
+	{ "Africa/Porto-Novo", 389, 157 },
+	{ "Africa/Sao_Tome", 20, 404 },
+	{ "Africa/Tripoli", 1974, 791 },
+	{ "Africa/Tunis", 2208, 611 },
+	{ "Africa/Windhoek", -1354, 1026 },
+	{ "America/Adak", 3113, -10599 },
+	{ "America/Anchorage", 3673, -8994 },
+	{ "America/Anguilla", 1092, -3784 },
+	{ "America/Antigua", 1023, -3708 },
+	{ "America/Araguaina", -432, -2892 },
+	{ "America/Argentina/Buenos_Aires", -2076, -3507 },
+	{ "America/Argentina/Catamarca", -1708, -3947 },
+	{ "America/Argentina/Cordoba", -1884, -3851 },
+	{ "America/Argentina/Jujuy", -1451, -3918 },
+	{ "America/Argentina/La_Rioja", -1766, -4011 },
+	{ "America/Argentina/Mendoza", -1973, -4129 },
+	{ "America/Argentina/Rio_Gallegos", -3098, -4153 },
+	{ "America/Argentina/Salta", -1487, -3925 },
+	{ "America/Argentina/San_Juan", -1892, -4111 },
+	{ "America/Argentina/San_Luis", -1999, -3981 },
+	{ "America/Argentina/Tucuman", -1609, -3913 },
+	{ "America/Argentina/Ushuaia", -3288, -4098 },
+	{ "America/Aruba", 750, -4198 },
+	{ "America/Asuncion", -1516, -3460 },
+	{ "America/Atikokan", 2926, -5497 },
+	{ "America/Bahia", -779, -2311 },
+	{ "America/Bahia_Banderas", 1248, -6315 },
+	{ "America/Barbados", 786, -3577 },
+	{ "America/Belem", -87, -2909 },
+	{ "America/Belize", 1050, -5292 },
+	{ "America/Blanc-Sablon", 3085, -3427 },
+	{ "America/Boa_Vista", 169, -3640 },
+	{ "America/Bogota", 276, -4445 },
+	{ "America/Boise", 2617, -6972 },
+	{ "America/Cambridge_Bay", 4147, -6303 },
+	{ "America/Campo_Grande", -1227, -3277 },
+	{ "America/Cancun", 1265, -5206 },
+	{ "America/Caracas", 630, -4016 },
+	{ "America/Cayenne", 296, -3140 },
+	{ "America/Cayman", 1158, -4883 },
+	{ "America/Chicago", 2511, -5259 },
+	{ "America/Chihuahua", 1718, -6365 },
+	{ "America/Ciudad_Juarez", 1904, -6389 },
+	{ "America/Costa_Rica", 596, -5045 },
+	{ "America/Coyhaique", -2734, -4324 },
+	{ "America/Creston", 2946, -6991 },
+	{ "America/Cuiaba", -935, -3365 },
+	{ "America/Curacao", 731, -4140 },
+	{ "America/Danmarkshavn", 4606, -1120 },
+	{ "America/Dawson", 3844, -8365 },
+	{ "America/Dawson_Creek", 3346, -7214 },
+	{ "America/Denver", 2384, -6299 },
+	{ "America/Detroit", 2540, -4983 },
+	{ "America/Dominica", 918, -3684 },
+	{ "America/Edmonton", 3213, -6808 },
+	{ "America/Eirunepe", -400, -4192 },
+	{ "America/El_Salvador", 822, -5352 },
+	{ "America/Fort_Nelson", 3528, -7362 },
+	{ "America/Fortaleza", -223, -2310 },
+	{ "America/Glace_Bay", 2772, -3597 },
+	{ "America/Goose_Bay", 3200, -3625 },
+	{ "America/Grand_Turk", 1288, -4268 },
+	{ "America/Grenada", 723, -3705 },
+	{ "America/Guadeloupe", 974, -3692 },
+	{ "America/Guatemala", 878, -5431 },
+	{ "America/Guayaquil", -130, -4790 },
+	{ "America/Guyana", 408, -3490 },
+	{ "America/Halifax", 2679, -3816 },
+	{ "America/Havana", 1388, -4942 },
+	{ "America/Hermosillo", 1744, -6658 },
+	{ "America/Indiana/Indianapolis", 2386, -5169 },
+	{ "America/Indiana/Knox", 2478, -5198 },
+	{ "America/Indiana/Marengo", 2303, -5181 },
+	{ "America/Indiana/Petersburg", 2310, -5237 },
+	{ "America/Indiana/Tell_City", 2277, -5206 },
+	{ "America/Indiana/Vevay", 2325, -5104 },
+	{ "America/Indiana/Vincennes", 2321, -5252 },
+	{ "America/Indiana/Winamac", 2463, -5196 },
+	{ "America/Inuvik", 4101, -8023 },
+	{ "America/Iqaluit", 3824, -4108 },
+	{ "America/Jamaica", 1078, -4608 },
+	{ "America/Juneau", 3498, -8065 },
+	{ "America/Kentucky/Louisville", 2295, -5146 },
+	{ "America/Kentucky/Monticello", 2210, -5091 },
+	{ "America/Kralendijk", 729, -4097 },
+	{ "America/La_Paz", -990, -4089 },
+	{ "America/Lima", -723, -4623 },
+	{ "America/Los_Angeles", 2043, -7095 },
+	{ "America/Lower_Princes", 1083, -3783 },
+	{ "America/Maceio", -580, -2143 },
+	{ "America/Managua", 729, -5177 },
+	{ "America/Manaus", -188, -3601 },
+	{ "America/Marigot", 1084, -3785 },
+	{ "America/Martinique", 876, -3665 },
+	{ "America/Matamoros", 1550, -5850 },
+	{ "America/Mazatlan", 1393, -6385 },
+	{ "America/Menominee", 2706, -5257 },
+	{ "America/Merida", 1258, -5377 },
+	{ "America/Metlakatla", 3308, -7895 },
+	{ "America/Mexico_City", 1164, -5949 },
+	{ "America/Miquelon", 2823, -3380 },
+	{ "America/Moncton", 2766, -3887 },
+	{ "America/Monterrey", 1540, -6019 },
+	{ "America/Montevideo", -2095, -3373 },
+	{ "America/Montserrat", 1003, -3733 },
+	{ "America/Nassau", 1505, -4641 },
+	{ "America/New_York", 2443, -4440 },
+	{ "America/Nome", 3870, -9924 },
+	{ "America/Noronha", -231, -1945 },
+	{ "America/North_Dakota/Beulah", 2836, -6107 },
+	{ "America/North_Dakota/Center", 2827, -6078 },
+	{ "America/North_Dakota/New_Salem", 2811, -6085 },
+	{ "America/Nuuk", 3851, -3104 },
+	{ "America/Ojinaga", 1774, -6265 },
+	{ "America/Panama", 538, -4772 },
+	{ "America/Paramaribo", 350, -3310 },
+	{ "America/Phoenix", 2007, -6724 },
+	{ "America/Port-au-Prince", 1112, -4340 },
+	{ "America/Port_of_Spain", 639, -3691 },
+	{ "America/Porto_Velho", -526, -3834 },
+	{ "America/Puerto_Rico", 1108, -3966 },
+	{ "America/Punta_Arenas", -3189, -4255 },
+	{ "America/Rankin_Inlet", 3769, -5525 },
+	{ "America/Recife", -483, -2094 },
+	{ "America/Regina", 3024, -6279 },
+	{ "America/Resolute", 4482, -5690 },
+	{ "America/Rio_Branco", -598, -4068 },
+	{ "America/Santarem", -146, -3292 },
+	{ "America/Santiago", -2007, -4240 },
+	{ "America/Santo_Domingo", 1108, -4194 },
+	{ "America/Sao_Paulo", -1412, -2797 },
+	{ "America/Scoresbysund", 4229, -1318 },
+	{ "America/Sitka", 3431, -8118 },
+	{ "America/St_Barthelemy", 1073, -3771 },
+	{ "America/St_Johns", 2854, -3163 },
+	{ "America/St_Kitts", 1038, -3763 },
+	{ "America/St_Lucia", 841, -3660 },
+	{ "America/St_Thomas", 1101, -3896 },
+	{ "America/St_Vincent", 789, -3674 },
+	{ "America/Swift_Current", 3017, -6470 },
+	{ "America/Tegucigalpa", 846, -5233 },
+	{ "America/Thule", 4594, -4127 },
+	{ "America/Tijuana", 1952, -7021 },
+	{ "America/Toronto", 2619, -4763 },
+	{ "America/Tortola", 1107, -3877 },
+	{ "America/Vancouver", 2956, -7387 },
+	{ "America/Whitehorse", 3643, -8103 },
+	{ "America/Winnipeg", 2993, -5829 },
+	{ "America/Yakutat", 3573, -8384 },
+	{ "Antarctica/Casey", -3977, 6631 },
+	{ "Antarctica/Davis", -4115, 4678 },
+	{ "Antarctica/DumontDUrville", -4000, 8401 },
+	{ "Antarctica/Macquarie", -3270, 9537 },
+	{ "Antarctica/Mawson", -4056, 3773 },
+	{ "Antarctica/McMurdo", -4670, 9996 },
+	{ "Antarctica/Palmer", -3888, -3846 },
+	{ "Antarctica/Rothera", -4054, -4088 },
+	{ "Antarctica/Syowa", -4140, 2375 },
+	{ "Antarctica/Troll", -4321, 152 },
+	{ "Antarctica/Vostok", -4704, 6414 },
+	{ "Arctic/Longyearbyen", 4680, 960 },
+	{ "Asia/Aden", 765, 2712 },
+	{ "Asia/Almaty", 2595, 4617 },
+	{ "Asia/Amman", 1917, 2156 },
+	{ "Asia/Anadyr", 3885, 10649 },
+	{ "Asia/Aqtau", 2671, 3016 },
+	{ "Asia/Aqtobe", 3017, 3430 },
+	{ "Asia/Ashgabat", 2277, 3503 },
+	{ "Asia/Atyrau", 2827, 3116 },
+	{ "Asia/Baghdad", 2001, 2665 },
+	{ "Asia/Bahrain", 1583, 3035 },
+	{ "Asia/Baku", 2423, 2991 },
+	{ "Asia/Bangkok", 825, 6031 },
+	{ "Asia/Barnaul", 3202, 5025 },
+	{ "Asia/Beirut", 2033, 2130 },
+	{ "Asia/Bishkek", 2574, 4476 },
+	{ "Asia/Brunei", 296, 6895 },
+	{ "Asia/Chita", 3123, 6808 },
+	{ "Asia/Colombo", 416, 4791 },
+	{ "Asia/Damascus", 2010, 2178 },
+	{ "Asia/Dhaka", 1423, 5425 },
+	{ "Asia/Dili", -513, 7535 },
+	{ "Asia/Dubai", 1518, 3318 },
+	{ "Asia/Dushanbe", 2315, 4128 },
+	{ "Asia/Famagusta", 2107, 2037 },
+	{ "Asia/Gaza", 1890, 2068 },
+	{ "Asia/Hebron", 1892, 2106 },
+	{ "Asia/Ho_Chi_Minh", 645, 6400 },
+	{ "Asia/Hong_Kong", 1337, 6849 },
+	{ "Asia/Hovd", 2881, 5499 },
+	{ "Asia/Irkutsk", 3136, 6260 },
+	{ "Asia/Jakarta", -370, 6408 },
+	{ "Asia/Jayapura", -152, 8442 },
+	{ "Asia/Jerusalem", 1907, 2113 },
+	{ "Asia/Kabul", 2071, 4152 },
+	{ "Asia/Kamchatka", 3181, 9519 },
+	{ "Asia/Karachi", 1492, 4023 },
+	{ "Asia/Kathmandu", 1663, 5119 },
+	{ "Asia/Khandyga", 3759, 8133 },
+	{ "Asia/Kolkata", 1352, 5302 },
+	{ "Asia/Krasnoyarsk", 3361, 5570 },
+	{ "Asia/Kuala_Lumpur", 190, 6102 },
+	{ "Asia/Kuching", 93, 6620 },
+	{ "Asia/Kuwait", 1760, 2879 },
+	{ "Asia/Macau", 1332, 6812 },
+	{ "Asia/Magadan", 3574, 9048 },
+	{ "Asia/Makassar", -307, 7164 },
+	{ "Asia/Manila", 875, 7258 },
+	{ "Asia/Muscat", 1416, 3515 },
+	{ "Asia/Nicosia", 2110, 2002 },
+	{ "Asia/Novokuznetsk", 3225, 5227 },
+	{ "Asia/Novosibirsk", 3302, 4975 },
+	{ "Asia/Omsk", 3300, 4404 },
+	{ "Asia/Oral", 3073, 3081 },
+	{ "Asia/Phnom_Penh", 693, 6295 },
+	{ "Asia/Pontianak", -2, 6560 },
+	{ "Asia/Pyongyang", 2341, 7545 },
+	{ "Asia/Qatar", 1517, 3092 },
+	{ "Asia/Qostanay", 3192, 3817 },
+	{ "Asia/Qyzylorda", 2688, 3928 },
+	{ "Asia/Riyadh", 1478, 2803 },
+	{ "Asia/Sakhalin", 2818, 8562 },
+	{ "Asia/Samarkand", 2380, 4008 },
+	{ "Asia/Seoul", 2253, 7618 },
+	{ "Asia/Shanghai", 1874, 7288 },
+	{ "Asia/Singapore", 77, 6231 },
+	{ "Asia/Srednekolymsk", 4048, 9223 },
+	{ "Asia/Taipei", 1503, 7290 },
+	{ "Asia/Tashkent", 2480, 4158 },
+	{ "Asia/Tbilisi", 2503, 2689 },
+	{ "Asia/Tehran", 2140, 3086 },
+	{ "Asia/Thimphu", 1648, 5379 },
+	{ "Asia/Tokyo", 2139, 8385 },
+	{ "Asia/Tomsk", 3390, 5098 },
+	{ "Asia/Ulaanbaatar", 2875, 6413 },
+	{ "Asia/Urumqi", 2628, 5255 },
+	{ "Asia/Ust-Nera", 3874, 8594 },
+	{ "Asia/Vientiane", 1078, 6156 },
+	{ "Asia/Vladivostok", 2590, 7916 },
+	{ "Asia/Yakutsk", 3720, 7780 },
+	{ "Asia/Yangon", 1007, 5770 },
+	{ "Asia/Yekaterinburg", 3411, 3636 },
+	{ "Asia/Yerevan", 2411, 2670 },
+	{ "Atlantic/Azores", 2264, -1540 },
+	{ "Atlantic/Bermuda", 1937, -3886 },
+	{ "Atlantic/Canary", 1686, -924 },
+	{ "Atlantic/Cape_Verde", 895, -1411 },
+	{ "Atlantic/Faroe", 3721, -406 },
+	{ "Atlantic/Madeira", 1958, -1014 },
+	{ "Atlantic/Reykjavik", 3849, -1311 },
+	{ "Atlantic/South_Georgia", -3256, -2192 },
+	{ "Atlantic/St_Helena", -955, -342 },
+	{ "Atlantic/Stanley", -3102, -3471 },
+	{ "Australia/Adelaide", -2095, 8315 },
+	{ "Australia/Brisbane", -1648, 9182 },
+	{ "Australia/Broken_Hill", -1917, 8487 },
+	{ "Australia/Darwin", -748, 7850 },
+	{ "Australia/Eucla", -1903, 7732 },
+	{ "Australia/Hobart", -2573, 8839 },
+	{ "Australia/Lindeman", -1216, 8940 },
+	{ "Australia/Lord_Howe", -1893, 9545 },
+	{ "Australia/Melbourne", -2269, 8698 },
+	{ "Australia/Perth", -1917, 6951 },
+	{ "Australia/Sydney", -2032, 9073 },
+	{ "Europe/Amsterdam", 3142, 294 },
+	{ "Europe/Andorra", 2550, 91 },
+	{ "Europe/Astrakhan", 2781, 2883 },
+	{ "Europe/Athens", 2278, 1423 },
+	{ "Europe/Belgrade", 2690, 1230 },
+	{ "Europe/Berlin", 3150, 802 },
+	{ "Europe/Bratislava", 2889, 1027 },
+	{ "Europe/Brussels", 3050, 260 },
+	{ "Europe/Bucharest", 2666, 1566 },
+	{ "Europe/Budapest", 2850, 1145 },
+	{ "Europe/Busingen", 2862, 521 },
+	{ "Europe/Chisinau", 2820, 1730 },
+	{ "Europe/Copenhagen", 3340, 755 },
+	{ "Europe/Dublin", 3200, -375 },
+	{ "Europe/Gibraltar", 2168, -321 },
+	{ "Europe/Guernsey", 2967, -152 },
+	{ "Europe/Helsinki", 3610, 1498 },
+	{ "Europe/Isle_of_Man", 3249, -268 },
+	{ "Europe/Istanbul", 2461, 1738 },
+	{ "Europe/Jersey", 2951, -126 },
+	{ "Europe/Kaliningrad", 3283, 1230 },
+	{ "Europe/Kirov", 3516, 2979 },
+	{ "Europe/Kyiv", 3026, 1831 },
+	{ "Europe/Lisbon", 2323, -548 },
+	{ "Europe/Ljubljana", 2763, 871 },
+	{ "Europe/London", 3090, -8 },
+	{ "Europe/Luxembourg", 2976, 369 },
+	{ "Europe/Madrid", 2424, -221 },
+	{ "Europe/Malta", 2154, 871 },
+	{ "Europe/Mariehamn", 3606, 1197 },
+	{ "Europe/Minsk", 3234, 1654 },
+	{ "Europe/Monaco", 2622, 443 },
+	{ "Europe/Moscow", 3345, 2257 },
+	{ "Europe/Oslo", 3595, 645 },
+	{ "Europe/Paris", 2932, 140 },
+	{ "Europe/Podgorica", 2546, 1156 },
+	{ "Europe/Prague", 3005, 866 },
+	{ "Europe/Riga", 3417, 1446 },
+	{ "Europe/Rome", 2514, 749 },
+	{ "Europe/Samara", 3192, 3009 },
+	{ "Europe/San_Marino", 2635, 748 },
+	{ "Europe/Sarajevo", 2632, 1105 },
+	{ "Europe/Saratov", 3094, 2762 },
+	{ "Europe/Simferopol", 2697, 2046 },
+	{ "Europe/Skopje", 2519, 1286 },
+	{ "Europe/Sofia", 2561, 1399 },
+	{ "Europe/Stockholm", 3560, 1083 },
+	{ "Europe/Tallinn", 3565, 1485 },
+	{ "Europe/Tirane", 2480, 1190 },
+	{ "Europe/Ulyanovsk", 3260, 2904 },
+	{ "Europe/Vaduz", 2829, 571 },
+	{ "Europe/Vatican", 2514, 747 },
+	{ "Europe/Vienna", 2893, 980 },
+	{ "Europe/Vilnius", 3281, 1519 },
+	{ "Europe/Volgograd", 2924, 2665 },
+	{ "Europe/Warsaw", 3135, 1260 },
+	{ "Europe/Zagreb", 2748, 958 },
+	{ "Europe/Zurich", 2843, 512 },
+	{ "Indian/Antananarivo", -1135, 2851 },
+	{ "Indian/Chagos", -440, 4345 },
+	{ "Indian/Christmas", -625, 6343 },
+	{ "Indian/Cocos", -730, 5815 },
+	{ "Indian/Comoro", -701, 2596 },
+	{ "Indian/Kerguelen", -2961, 4213 },
+	{ "Indian/Mahe", -280, 3328 },
+	{ "Indian/Maldives", 250, 4410 },
+	{ "Indian/Mauritius", -1210, 3450 },
+	{ "Indian/Mayotte", -767, 2714 },
+	{ "Indian/Reunion", -1252, 3328 },
+	{ "Pacific/Apia", -830, -10304 },
+	{ "Pacific/Auckland", -2212, 10486 },
+	{ "Pacific/Bougainville", -373, 9334 },
+	{ "Pacific/Chatham", -2637, -10593 },
+	{ "Pacific/Chuuk", 445, 9107 },
+	{ "Pacific/Easter", -1629, -6566 },
+	{ "Pacific/Efate", -1060, 10105 },
+	{ "Pacific/Fakaofo", -562, -10274 },
+	{ "Pacific/Fiji", -1088, 10705 },
+	{ "Pacific/Funafuti", -511, 10753 },
+	{ "Pacific/Galapagos", -54, -5376 },
+	{ "Pacific/Gambier", -1388, -8097 },
+	{ "Pacific/Guadalcanal", -572, 9612 },
+	{ "Pacific/Guam", 808, 8685 },
+	{ "Pacific/Honolulu", 1278, -9472 },
+	{ "Pacific/Kanton", -167, -10303 },
+	{ "Pacific/Kiritimati", 112, -9440 },
+	{ "Pacific/Kosrae", 319, 9779 },
+	{ "Pacific/Kwajalein", 545, 10040 },
+	{ "Pacific/Majuro", 429, 10272 },
+	{ "Pacific/Marquesas", -540, -8370 },
+	{ "Pacific/Midway", 1693, -10642 },
+	{ "Pacific/Nauru", -31, 10015 },
+	{ "Pacific/Niue", -1141, -10195 },
+	{ "Pacific/Norfolk", -1743, 10078 },
+	{ "Pacific/Noumea", -1336, 9987 },
+	{ "Pacific/Pago_Pago", -856, -10242 },
+	{ "Pacific/Palau", 440, 8069 },
+	{ "Pacific/Pitcairn", -1504, -7805 },
+	{ "Pacific/Pohnpei", 418, 9493 },
+	{ "Pacific/Port_Moresby", -570, 8830 },
+	{ "Pacific/Rarotonga", -1274, -9586 },
+	{ "Pacific/Saipan", 912, 8745 },
+	{ "Pacific/Tahiti", -1052, -8974 },
+	{ "Pacific/Tarawa", 85, 10380 },
+	{ "Pacific/Tongatapu", -1268, -10512 },
+	{ "Pacific/Wake", 1157, 9997 },
+	{ "Pacific/Wallis", -798, -10570 },
+};
+
+#define ZONE_LOCATION_COUNT \
+	(sizeof(zone_locations) / sizeof(zone_locations[0]))
+
+
+static int
+zone_location_cmp(const void *key, const void *elem)
+{
+	return strcmp(key, ((const zone_location_t *)elem)->name);
+}
+
+/* Store the part of PATH after the zoneinfo directory as the zone
+   name, e.g. `Europe/Copenhagen' for
+   `/usr/share/zoneinfo/posix/Europe/Copenhagen'. */
+static int
+zone_from_path(const char *path, char *zone, size_t size)
+{
+	const char *name = strstr(path, "zoneinfo/");
+	if (name == NULL) return -1;
+	name += strlen("zoneinfo/");
+
+	if (strncmp(name, "posix/", 6) == 0) name += 6;
+	else if (strncmp(name, "right/", 6) == 0) name += 6;
+
+	if (name[0] == '\0' || strlen(name) >= size) return -1;
+	strcpy(zone, name);
+	return 0;
+}
+
+/* Find the name of the local time zone from TZ, /etc/localtime or
+   /etc/timezone. */
+int
+location_timezone_get_zone(char *zone, size_t size)
+{
+	const char *tz = getenv("TZ");
+	if (tz != NULL && tz[0] != '\0') {
+		if (tz[0] == ':') tz += 1;
+		if (tz[0] == '/') return zone_from_path(tz, zone, size);
+		if (strlen(tz) >= size) return -1;
+		strcpy(zone, tz);
+		return 0;
+	}
+
+#ifndef _WIN32
+	char path[MAX_ZONE_PATH];
+	ssize_t len = readlink("/etc/localtime", path, sizeof(path) - 1);
+	if (len > 0) {
+		path[len] = '\0';
+		if (zone_from_path(path, zone, size) == 0) return 0;
+	}
+
+	/* Debian keeps the name in a file as well. */
+	FILE *f = fopen("/etc/timezone", "r");
+	if (f != NULL) {
+		char *r = fgets(zone, size, f);
+		fclose(f);
+		if (r != NULL) {
+			zone[strcspn(zone, " \t\r\n")] = '\0';
+			if (zone[0] != '\0') return 0;
+		}
+	}
+#endif
+
+	return -1;
+}
+
+/* Parse one ISO 6709 coordinate, either +-DDMM or +-DDMMSS with
+   DIGITS digits for the degrees. */
+static int
+parse_iso6709(const char **s, int digits, float *value)
+{
+	const char *p = *s;
+	int sign = p[0] == '-' ? -1 : 1;
+	if (p[0] != '+' && p[0] != '-') return -1;
+	p += 1;
+
+	int len = 0;
+	while (p[len] >= '0' && p[len] <= '9') len += 1;
+	if (len != digits + 2 && len != digits + 4) return -1;
+
+	int parts[3] = { 0, 0, 0 };
+	for (int i = 0; i < len; i++) {
+		int part = i < digits ? 0 : (i - digits) / 2 + 1;
+		parts[part] = parts[part] * 10 + (p[i] - '0');
+	}
+
+	*value = sign * (parts[0] + parts[1] / 60.0 + parts[2] / 3600.0);
+	*s = p + len;
+	return 0;
+}
+
+/* Look ZONE up in a zone table file of tzdata. */
+static int
+lookup_zone_table(const char *path, const char *zone, location_t *loc)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) return -1;
+
+	char line[512];
+	int r = -1;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (line[0] == '#') continue;
+
+		/* Country codes, coordinates, zone name, comments */
+		char *coords = strchr(line, '\t');
+		if (coords == NULL) continue;
+		coords += 1;
+		char *name = strchr(coords, '\t');
+		if (name == NULL) continue;
+		name += 1;
+		name[strcspn(name, "\t\r\n")] = '\0';
+		if (strcmp(name, zone) != 0) continue;
+
+		const char *p = coords;
+		if (parse_iso6709(&p, 2, &loc->lat) == 0 &&
+		    parse_iso6709(&p, 3, &loc->lon) == 0) {
+			r = 0;
+		}
+		break;
+	}
+
+	fclose(f);
+	return r;
+}
+
+/* Look up the principal location of ZONE. Zones that are newer than
+   the built-in table are looked up in the tzdata files. */
+int
+location_timezone_lookup(const char *zone, location_t *loc)
+{
+	const zone_location_t *entry =
+		bsearch(zone, zone_locations, ZONE_LOCATION_COUNT,
+			sizeof(zone_location_t), zone_location_cmp);
+	if (entry != NULL) {
+		loc->lat = entry->lat / 60.0;
+		loc->lon = entry->lon / 60.0;
+		return 0;
+	}
+
+	const char *dir = getenv("TZDIR");
+	if (dir == NULL || dir[0] == '\0') dir = DEFAULT_ZONEINFO_DIR;
+
+	const char *tables[] = { "zone1970.tab", "zone.tab" };
+	for (int i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+		char path[MAX_ZONE_PATH];
+		snprintf(path, sizeof(path), "%s/%s", dir, tables[i]);
+		if (lookup_zone_table(path, zone, loc) == 0) return 0;
+	}
+
+	return -1;
+}
+
+
+int
+location_timezone_init(location_timezone_state_t *state)
+{
+	state->zone[0] = '\0';
+	state->loc.lat = NAN;
+	state->loc.lon = NAN;
+
+	return 0;
+}
+
+int
+location_timezone_start(location_timezone_state_t *state)
+{
+	if (state->zone[0] == '\0' &&
+	    location_timezone_get_zone(state->zone,
+				       sizeof(state->zone)) < 0) {
+		fputs(_("Unable to determine the time zone.\n"), stderr);
+		return -1;
+	}
+
+	if (location_timezone_lookup(state->zone, &state->loc) < 0) {
+		fprintf(stderr, _("No location known for time zone `%s'.\n"),
+			state->zone);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+location_timezone_free(location_timezone_state_t *state)
+{
+}
+
+void
+location_timezone_print_help(FILE *f)
+{
+	fputs(_("Estimate location from the time zone.\n"), f);
+	fputs("\n", f);
+
+	/* TRANSLATORS: Time zone location help output
+	   left column must not be translated */
+	fputs(_("  zone=NAME\tTime zone (e.g. `Europe/Copenhagen')\n"), f);
+	fputs("\n", f);
+	fputs(_("The location is the principal city of the time zone. By\n"
+		"default the time zone of the system is used.\n"), f);
+	fputs("\n", f);
+}
+
+int
+location_timezone_set_option(location_timezone_state_t *state,
+			     const char *key, const char *value)
+{
+	if (strcasecmp(key, "zone") == 0) {
+		if (strlen(value) >= sizeof(state->zone)) {
+			fputs(_("Malformed argument.\n"), stderr);
+			return -1;
+		}
+		strcpy(state->zone, value);
+	} else {
+		fprintf(stderr, _("Unknown method parameter: `%s'.\n"), key);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+location_timezone_get_location(location_timezone_state_t *state,
+			       location_t *loc)
+{
+	*loc = state->loc;
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+/* location-timezone.h -- Time zone location provider header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_LOCATION_TIMEZONE_H
+#define REDSHIFT_LOCATION_TIMEZONE_H
+
+#include <stdio.h>
+
+#include "redshift.h"
+
+#define LOCATION_TIMEZONE_NAME_MAX  64
+
+
+typedef struct {
+	char zone[LOCATION_TIMEZONE_NAME_MAX];
+	location_t loc;
+} location_timezone_state_t;
+
+
+int location_timezone_init(location_timezone_state_t *state);
+int location_timezone_start(location_timezone_state_t *state);
+void location_timezone_free(location_timezone_state_t *state);
+
+void location_timezone_print_help(FILE *f);
+int location_timezone_set_option(location_timezone_state_t *state,
+				 const char *key, const char *value);
+
+int location_timezone_get_location(location_timezone_state_t *state,
+				   location_t *loc);
+
+int location_timezone_get_zone(char *zone, size_t size);
+int location_timezone_lookup(const char *zone, location_t *loc);
+
+
+#endif /* ! REDSHIFT_LOCATION_TIMEZONE_H */
@@ -0,0 +1,376 @@
+/* metrics.c -- Runtime metrics
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "systemtime.h"
+
+#define MAX_METRICS_PATH  4096
+
+
+/* Upper bounds of the latency histogram buckets (seconds). */
+static const double latency_bounds[METRICS_LATENCY_BUCKETS] = {
+	0.0001, 0.00025, 0.0005, 0.001, 0.0025,
+	0.005, 0.01, 0.025, 0.05, 0.1
+};
+
+/* Label values of the wakeup causes. */
+static const char *wakeup_names[METRICS_WAKEUP_CAUSES] = {
+	"timer", "signal", "override", "config", "location", "hook",
+	"output"
+};
+
+
+/* Start collecting metrics to be written to PATH every INTERVAL
+   seconds. If PATH is NULL the counters are only kept in memory. */
+int
+metrics_init(metrics_t *metrics, const char *path, double interval)
+{
+	memset(metrics, 0, sizeof(metrics_t));
+
+	if (path != NULL) {
+		metrics->path = strdup(path);
+		if (metrics->path == NULL) {
+			perror("strdup");
+			return -1;
+		}
+	}
+
+	metrics->interval = interval > 0.0 ? interval :
+		DEFAULT_METRICS_INTERVAL;
+
+	if (systemtime_get_time(&metrics->start_time) < 0 ||
+	    systemtime_get_monotonic_time(&metrics->start_monotonic) < 0) {
+		free(metrics->path);
+		return -1;
+	}
+
+	metrics->next_write = metrics->start_monotonic + metrics->interval;
+
+	return 0;
+}
+
+void
+metrics_free(metrics_t *metrics)
+{
+	free(metrics->path);
+	metrics->path = NULL;
+}
+
+/* Record one call of set_temperature that took LATENCY seconds. */
+void
+metrics_record_write(metrics_t *metrics, double latency, int failed)
+{
+	if (metrics == NULL) return;
+
+	metrics->writes += 1;
+	if (failed) metrics->write_failures += 1;
+
+	for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+		if (latency <= latency_bounds[i]) {
+			metrics->latency_buckets[i] += 1;
+			break;
+		}
+	}
+	metrics->latency_count += 1;
+	metrics->latency_sum += latency;
+}
+
+/* Record that the main loop was woken up by CAUSE. One wakeup can
+   have several causes. */
+void
+metrics_record_wakeup(metrics_t *metrics, metrics_wakeup_t cause)
+{
+	if (metrics == NULL) return;
+	metrics->wakeup_causes[cause] += 1;
+}
+
+const char *
+metrics_wakeup_name(metrics_wakeup_t cause)
+{
+	return wakeup_names[cause];
+}
+
+/* Store in DEADLINE (monotonic seconds) the time of the next write of
+   the metrics file. Returns -1 if metrics are disabled. */
+int
+metrics_get_deadline(const metrics_t *metrics, double *deadline)
+{
+	if (metrics == NULL || metrics->path == NULL) return -1;
+	*deadline = metrics->next_write;
+	return 0;
+}
+
+/* Print S as a label value, escaped as required by the text format. */
+static void
+print_label_value(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s != '\0'; s++) {
+		if (*s == '\\' || *s == '"') {
+			fputc('\\', f);
+			fputc(*s, f);
+		} else if (*s == '\n') {
+			fputs("\\n", f);
+		} else {
+			fputc(*s, f);
+		}
+	}
+	fputc('"', f);
+}
+
+static void
+print_header(FILE *f, const char *name, const char *type,
+	     const char *help)
+{
+	fprintf(f, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void
+print_labeled(FILE *f, const char *name, const char *label,
+	      const char *value, double v)
+{
+	fprintf(f, "%s{%s=", name, label);
+	print_label_value(f, value);
+	fprintf(f, "} %.17g\n", v);
+}
+
+static void
+print_hook_stats(FILE *f, const hooks_state_t *hooks)
+{
+	print_header(f, "redshift_hook_runs_total", "counter",
+		     "Hook processes that finished or failed to start.");
+	for (int i = 0; i < hooks->hook_count; i++) {
+		print_labeled(f, "redshift_hook_runs_total", "hook",
+			      hooks->hooks[i].name,
+			      hooks->hooks[i].stats.runs);
+	}
+
+	print_header(f, "redshift_hook_failures_total", "counter",
+		     "Hook processes that failed to start or exited with"
+		     " an error.");
+	for (int i = 0; i < hooks->hook_count; i++) {
+		print_labeled(f, "redshift_hook_failures_total", "hook",
+			      hooks->hooks[i].name,
+			      hooks->hooks[i].stats.failures);
+	}
+
+	print_header(f, "redshift_hook_timeouts_total", "counter",
+		     "Hook processes that were killed after the timeout.");
+	for (int i = 0; i < hooks->hook_count; i++) {
+		print_labeled(f, "redshift_hook_timeouts_total", "hook",
+			      hooks->hooks[i].name,
+			      hooks->hooks[i].stats.timeouts);
+	}
+
+	print_header(f, "redshift_hook_seconds_total", "counter",
+		     "Time spent running hook processes.");
+	for (int i = 0; i < hooks->hook_count; i++) {
+		print_labeled(f, "redshift_hook_seconds_total", "hook",
+			      hooks->hooks[i].name,
+			      hooks->hooks[i].stats.total_duration);
+	}
+
+	print_header(f, "redshift_plugin_calls_total", "counter",
+		     "Callbacks of hook plugins.");
+	for (int i = 0; i < hooks->plugin_count; i++) {
+		print_labeled(f, "redshift_plugin_calls_total", "plugin",
+			      hooks->plugins[i].name,
+			      hooks->plugins[i].stats.runs);
+	}
+
+	print_header(f, "redshift_plugin_errors_total", "counter",
+		     "Plugin callbacks that failed or were too slow.");
+	for (int i = 0; i < hooks->plugin_count; i++) {
+		const hook_stats_t *stats = &hooks->plugins[i].stats;
+		print_labeled(f, "redshift_plugin_errors_total", "plugin",
+			      hooks->plugins[i].name,
+			      stats->failures + stats->timeouts);
+	}
+}
+
+static void
+print_metrics(FILE *f, const metrics_t *metrics,
+	      const metrics_sources_t *sources, double now,
+	      double monotonic)
+{
+	const char *method = sources->method != NULL ?
+		sources->method : "";
+
+	print_header(f, "redshift_start_time_seconds", "gauge",
+		     "Start time of the process since the epoch.");
+	fprintf(f, "redshift_start_time_seconds %.3f\n", metrics->start_time);
+
+	print_header(f, "redshift_ticks_total", "counter",
+		     "Updates of the color setting by the main loop.");
+	fprintf(f, "redshift_ticks_total %lu\n", metrics->ticks);
+
+	print_header(f, "redshift_wakeups_total", "counter",
+		     "Times the main loop woke up.");
+	fprintf(f, "redshift_wakeups_total %lu\n", metrics->wakeups);
+
+	print_header(f, "redshift_wakeup_causes_total", "counter",
+		     "Causes of main loop wakeups.");
+	for (int i = 0; i < METRICS_WAKEUP_CAUSES; i++) {
+		print_labeled(f, "redshift_wakeup_causes_total", "cause",
+			      wakeup_names[i], metrics->wakeup_causes[i]);
+	}
+
+	double uptime = monotonic - metrics->start_monotonic;
+	print_header(f, "redshift_wakeups_per_hour", "gauge",
+		     "Average wakeups per hour since start.");
+	fprintf(f, "redshift_wakeups_per_hour %.3f\n", uptime > 0.0 ?
+		metrics->wakeups * 3600.0 / uptime : 0.0);
+
+	print_header(f, "redshift_backend_writes_total", "counter",
+		     "Color settings passed to the adjustment method.");
+	print_labeled(f, "redshift_backend_writes_total", "method", method,
+		      metrics->writes);
+
+	print_header(f, "redshift_backend_write_failures_total", "counter",
+		     "Color settings the adjustment method failed to"
+		     " apply.");
+	print_labeled(f, "redshift_backend_write_failures_total", "method",
+		      method, metrics->write_failures);
+
+	print_header(f, "redshift_backend_skipped_writes_total", "counter",
+		     "Updates that did not change the display because"
+		     " redshift was disabled.");
+	fprintf(f, "redshift_backend_skipped_writes_total %lu\n",
+		metrics->skipped_writes);
+
+	print_header(f, "redshift_set_temperature_seconds", "histogram",
+		     "Time taken by the adjustment method to apply a color"
+		     " setting.");
+	unsigned long cumulative = 0;
+	for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+		cumulative += metrics->latency_buckets[i];
+		fprintf(f, "redshift_set_temperature_seconds_bucket"
+			"{le=\"%g\"} %lu\n", latency_bounds[i], cumulative);
+	}
+	fprintf(f, "redshift_set_temperature_seconds_bucket{le=\"+Inf\"}"
+		" %lu\n", metrics->latency_count);
+	fprintf(f, "redshift_set_temperature_seconds_sum %.9f\n",
+		metrics->latency_sum);
+	fprintf(f, "redshift_set_temperature_seconds_count %lu\n",
+		metrics->latency_count);
+
+	if (sources->have_method_stats) {
+		print_header(f, "redshift_backend_round_trips_total",
+			     "counter", "Round trips to the display server"
+			     " or kernel for gamma updates.");
+		print_labeled(f, "redshift_backend_round_trips_total",
+			      "method", method,
+			      sources->method_stats.round_trips);
+
+		print_header(f, "redshift_backend_bytes_sent_total",
+			     "counter", "Size of gamma update requests.");
+		print_labeled(f, "redshift_backend_bytes_sent_total",
+			      "method", method,
+			      sources->method_stats.bytes_sent);
+	}
+
+	if (sources->hooks != NULL) print_hook_stats(f, sources->hooks);
+
+	if (!isnan(sources->location_fix_time)) {
+		print_header(f, "redshift_location_fix_age_seconds", "gauge",
+			     "Time since the location provider last"
+			     " delivered a location.");
+		fprintf(f, "redshift_location_fix_age_seconds %.3f\n",
+			now - sources->location_fix_time);
+	}
+}
+
+/* Replace the metrics file. The file is written to a temporary file
+   first and renamed so the collector never reads a partial file. */
+int
+metrics_write(metrics_t *metrics, const metrics_sources_t *sources)
+{
+	if (metrics->path == NULL) return 0;
+
+	double now, monotonic;
+	if (systemtime_get_time(&now) < 0 ||
+	    systemtime_get_monotonic_time(&monotonic) < 0) {
+		return -1;
+	}
+
+	metrics->next_write = monotonic + metrics->interval;
+
+	char tmp_path[MAX_METRICS_PATH];
+#ifndef _WIN32
+	snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", metrics->path);
+
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		perror(tmp_path);
+		return -1;
+	}
+
+	/* Readable by the collector which may run as another user. */
+	fchmod(fd, 0644);
+
+	FILE *f = fdopen(fd, "w");
+	if (f == NULL) {
+		perror("fdopen");
+		close(fd);
+		unlink(tmp_path);
+		return -1;
+	}
+#else
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", metrics->path);
+
+	FILE *f = fopen(tmp_path, "w");
+	if (f == NULL) {
+		perror(tmp_path);
+		return -1;
+	}
+#endif
+
+	print_metrics(f, metrics, sources, now, monotonic);
+
+	if (fflush(f) != 0 || ferror(f)) {
+		perror(tmp_path);
+		fclose(f);
+		unlink(tmp_path);
+		return -1;
+	}
+	fclose(f);
+
+#ifdef _WIN32
+	remove(metrics->path);
+#endif
+	if (rename(tmp_path, metrics->path) < 0) {
+		perror(metrics->path);
+		unlink(tmp_path);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+/* metrics.h -- Runtime metrics header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_METRICS_H
+#define REDSHIFT_METRICS_H
+
+#include "redshift.h"
+#include "hooks.h"
+
+/* Default number of seconds between writes of the metrics file. */
+#define DEFAULT_METRICS_INTERVAL  60.0
+
+/* Upper bounds of the set_temperature latency histogram (seconds). */
+#define METRICS_LATENCY_BUCKETS  10
+
+/* What woke up the main loop. Timeouts of the tick, hook and
+   metrics deadlines all count as timer wakeups. */
+typedef enum {
+	METRICS_WAKEUP_TIMER,
+	METRICS_WAKEUP_SIGNAL,
+	METRICS_WAKEUP_OVERRIDE,
+	METRICS_WAKEUP_CONFIG,
+	METRICS_WAKEUP_LOCATION,
+	METRICS_WAKEUP_HOOK,
+	METRICS_WAKEUP_OUTPUT,
+	METRICS_WAKEUP_CAUSES
+} metrics_wakeup_t;
+
+/* Counters exported in the Prometheus text format for the textfile
+   collector of node_exporter. Metrics are only collected when a
+   metrics file is configured; a NULL metrics_t pointer disables all
+   bookkeeping. */
+typedef struct {
+	char *path;
+	double interval;
+	double next_write;
+
+	double start_time;
+	double start_monotonic;
+
+	unsigned long ticks;
+	unsigned long wakeups;
+	unsigned long wakeup_causes[METRICS_WAKEUP_CAUSES];
+	unsigned long writes;
+	unsigned long write_failures;
+	unsigned long skipped_writes;
+
+	unsigned long latency_buckets[METRICS_LATENCY_BUCKETS];
+	unsigned long latency_count;
+	double latency_sum;
+} metrics_t;
+
+/* Values that are owned by other parts of the program. */
+typedef struct {
+	const char *method;
+	int have_method_stats;
+	gamma_method_stats_t method_stats;
+	const hooks_state_t *hooks;
+	/* Time of the last location fix (seconds since epoch) or NAN. */
+	double location_fix_time;
+} metrics_sources_t;
+
+
+int metrics_init(metrics_t *metrics, const char *path, double interval);
+void metrics_free(metrics_t *metrics);
+
+void metrics_record_write(metrics_t *metrics, double latency, int failed);
+void metrics_record_wakeup(metrics_t *metrics, metrics_wakeup_t cause);
+const char *metrics_wakeup_name(metrics_wakeup_t cause);
+
+int metrics_get_deadline(const metrics_t *metrics, double *deadline);
+int metrics_write(metrics_t *metrics, const metrics_sources_t *sources);
+
+
+#endif /* ! REDSHIFT_METRICS_H */
@@ -0,0 +1,281 @@
+/* output-jsonl.c -- JSON lines status output source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+# include <poll.h>
+#endif
+
+#include "output-jsonl.h"
+#include "systemtime.h"
+#include "redshift.h"
+
+#ifndef PIPE_BUF
+# define PIPE_BUF  512
+#endif
+
+/* Longest single event line. Longer lines are dropped. */
+#define MAX_EVENT_LENGTH  512
+
+
+/* Names of periods in the stream. These must not be translated. */
+static const char *period_names[] = {
+	"none",
+	"daytime",
+	"night",
+	"transition"
+};
+
+
+/* Set up writer for file descriptor FD. The descriptor is never
+   switched to non-blocking mode since it is usually shared with the
+   parent process; instead each write is preceded by a zero timeout
+   poll and limited to PIPE_BUF bytes. */
+int
+output_jsonl_init(output_jsonl_state_t *state, int fd, size_t size)
+{
+	state->fd = fd;
+	state->head = 0;
+	state->len = 0;
+	state->dropped = 0;
+	state->dropped_total = 0;
+
+	state->size = size;
+	state->buf = malloc(size);
+	if (state->buf == NULL) {
+		perror("malloc");
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+output_jsonl_free(output_jsonl_state_t *state)
+{
+	/* Last chance to deliver, but never block on exit. */
+	output_jsonl_flush(state);
+
+	free(state->buf);
+	state->buf = NULL;
+}
+
+/* Return non-zero if lines are waiting to be written. */
+int
+output_jsonl_pending(const output_jsonl_state_t *state)
+{
+	return state->len > 0;
+}
+
+/* Append LEN bytes to the ring buffer. Caller checks space. */
+static void
+ring_push(output_jsonl_state_t *state, const char *data, size_t len)
+{
+	size_t tail = (state->head + state->len) % state->size;
+	size_t first = state->size - tail;
+	if (first > len) first = len;
+
+	memcpy(&state->buf[tail], data, first);
+	memcpy(&state->buf[0], data + first, len - first);
+	state->len += len;
+}
+
+/* Write as much of the queued output as the consumer accepts
+   without blocking. Returns -1 on write errors other than the
+   consumer being slow. */
+int
+output_jsonl_flush(output_jsonl_state_t *state)
+{
+	while (state->len > 0) {
+#ifndef _WIN32
+		struct pollfd pfd = { state->fd, POLLOUT, 0 };
+		int r = poll(&pfd, 1, 0);
+		if (r < 0) {
+			if (errno == EINTR) continue;
+			perror("poll");
+			return -1;
+		} else if (r == 0 || !(pfd.revents & POLLOUT)) {
+			/* Consumer is lagging; try again later. */
+			break;
+		}
+#endif
+
+		/* Write the contiguous part starting at head. */
+		size_t chunk = state->size - state->head;
+		if (chunk > state->len) chunk = state->len;
+		if (chunk > PIPE_BUF) chunk = PIPE_BUF;
+
+		ssize_t n = write(state->fd, &state->buf[state->head], chunk);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			perror("write");
+			return -1;
+		}
+
+		state->head = (state->head + n) % state->size;
+		state->len -= n;
+	}
+
+	if (state->len == 0) state->head = 0;
+
+	return 0;
+}
+
+/* Queue a complete line or drop it if it does not fit. */
+static int
+queue_line(output_jsonl_state_t *state, const char *line, size_t len)
+{
+	if (state->size - state->len < len) {
+		state->dropped += 1;
+		state->dropped_total += 1;
+		return -1;
+	}
+
+	ring_push(state, line, len);
+	return 0;
+}
+
+/* Emit event EVENT with additional members formatted from FMT. The
+   members are inserted verbatim in the JSON object so FMT must
+   produce a (possibly empty) list of `"key":value' pairs, each
+   preceded by a comma. */
+int
+output_jsonl_event(output_jsonl_state_t *state, const char *event,
+		   const char *fmt, ...)
+{
+	char line[MAX_EVENT_LENGTH];
+	int r;
+
+	double now;
+	r = systemtime_get_time(&now);
+	if (r < 0) now = 0.0;
+
+	/* Report lines lost since the last successful write before
+	   anything else, so consumers can see the gap in order. */
+	if (state->dropped > 0) {
+		int len = snprintf(line, sizeof(line),
+				   "{\"event\":\"dropped\",\"time\":%.3f,"
+				   "\"count\":%lu,\"total\":%lu}\n",
+				   now, state->dropped,
+				   state->dropped_total);
+		if (state->size - state->len >= (size_t)len) {
+			ring_push(state, line, len);
+			state->dropped = 0;
+		}
+	}
+
+	int len = snprintf(line, sizeof(line),
+			   "{\"event\":\"%s\",\"time\":%.3f",
+			   event, now);
+
+	va_list ap;
+	va_start(ap, fmt);
+	len += vsnprintf(&line[len], sizeof(line) - len, fmt, ap);
+	va_end(ap);
+
+	if (len + 2 >= (int)sizeof(line)) {
+		state->dropped += 1;
+		state->dropped_total += 1;
+		return -1;
+	}
+
+	line[len++] = '}';
+	line[len++] = '\n';
+
+	r = queue_line(state, line, len);
+	output_jsonl_flush(state);
+
+	return r;
+}
+
+/* Write S into BUF as a quoted JSON string, escaping quotes,
+   backslashes and control characters. The result is cut short (but
+   still quoted) if BUF is too small. */
+void
+output_jsonl_escape(char *buf, size_t size, const char *s)
+{
+	size_t len = 0;
+
+	if (size < 3) {
+		if (size > 0) buf[0] = '\0';
+		return;
+	}
+
+	buf[len++] = '"';
+	for (; *s != '\0'; s++) {
+		char esc[8];
+		int n;
+		if (*s == '"' || *s == '\\') {
+			n = snprintf(esc, sizeof(esc), "\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			n = snprintf(esc, sizeof(esc), "\\u%04x", *s);
+		} else {
+			esc[0] = *s;
+			n = 1;
+		}
+		if (len + n + 2 > size) break;
+		memcpy(&buf[len], esc, n);
+		len += n;
+	}
+	buf[len++] = '"';
+	buf[len] = '\0';
+}
+
+void
+output_jsonl_status(output_jsonl_state_t *state, int enabled)
+{
+	output_jsonl_event(state, "status", ",\"enabled\":%s",
+			   enabled ? "true" : "false");
+}
+
+void
+output_jsonl_period(output_jsonl_state_t *state, period_t period,
+		    double progress)
+{
+	output_jsonl_event(state, "period",
+			   ",\"period\":\"%s\",\"progress\":%.4f",
+			   period_names[period], progress);
+}
+
+void
+output_jsonl_color(output_jsonl_state_t *state,
+		   const color_setting_t *setting)
+{
+	output_jsonl_event(state, "color",
+			   ",\"temperature\":%d,\"brightness\":%.3f,"
+			   "\"gamma\":[%.3f,%.3f,%.3f]",
+			   setting->temperature, setting->brightness,
+			   setting->gamma[0], setting->gamma[1],
+			   setting->gamma[2]);
+}
+
+void
+output_jsonl_location(output_jsonl_state_t *state, const location_t *loc)
+{
+	output_jsonl_event(state, "location", ",\"lat\":%.4f,\"lon\":%.4f",
+			   loc->lat, loc->lon);
+}
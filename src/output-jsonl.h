@@ -0,0 +1,63 @@
+/* output-jsonl.h -- JSON lines status output header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_OUTPUT_JSONL_H
+#define REDSHIFT_OUTPUT_JSONL_H
+
+#include <stddef.h>
+
+#include "redshift.h"
+
+/* Default capacity of the output ring buffer (bytes). */
+#define OUTPUT_JSONL_BUFFER_SIZE  16384
+
+typedef struct {
+	int fd;
+
+	/* Ring buffer of complete lines waiting to be written. */
+	char *buf;
+	size_t size;
+	size_t head;
+	size_t len;
+
+	/* Lines dropped because the consumer did not keep up. */
+	unsigned long dropped;
+	unsigned long dropped_total;
+} output_jsonl_state_t;
+
+
+int output_jsonl_init(output_jsonl_state_t *state, int fd, size_t size);
+void output_jsonl_free(output_jsonl_state_t *state);
+
+int output_jsonl_event(output_jsonl_state_t *state, const char *event,
+		       const char *fmt, ...);
+int output_jsonl_flush(output_jsonl_state_t *state);
+int output_jsonl_pending(const output_jsonl_state_t *state);
+void output_jsonl_escape(char *buf, size_t size, const char *s);
+
+void output_jsonl_status(output_jsonl_state_t *state, int enabled);
+void output_jsonl_period(output_jsonl_state_t *state, period_t period,
+			 double progress);
+void output_jsonl_color(output_jsonl_state_t *state,
+			const color_setting_t *setting);
+void output_jsonl_location(output_jsonl_state_t *state,
+			   const location_t *loc);
+
+
+#endif /* ! REDSHIFT_OUTPUT_JSONL_H */
@@ -0,0 +1,231 @@
+/* override.c -- Interactive color override channel source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "override.h"
+#include "systemtime.h"
+
+
+#ifndef _WIN32
+
+/* Open (creating if needed) the FIFO at PATH. Lines written to the
+   FIFO are either `TEMP', `TEMP:BRIGHTNESS' or `reset'. */
+int
+override_init(override_state_t *state, const char *path, double timeout)
+{
+	state->fd = -1;
+	state->keep_fd = -1;
+	state->len = 0;
+	state->active = 0;
+	state->temperature = -1;
+	state->brightness = NAN;
+	state->pending = 0;
+	state->last_apply = 0.0;
+	state->timeout = timeout;
+	state->expires = 0.0;
+
+	int r = mkfifo(path, 0600);
+	if (r < 0 && errno != EEXIST) {
+		perror("mkfifo");
+		return -1;
+	}
+
+	state->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (state->fd < 0) {
+		perror("open");
+		fprintf(stderr, _("Unable to open override channel `%s'.\n"),
+			path);
+		return -1;
+	}
+
+	struct stat st;
+	r = fstat(state->fd, &st);
+	if (r < 0 || !S_ISFIFO(st.st_mode)) {
+		fprintf(stderr, _("Override channel `%s' is not a FIFO.\n"),
+			path);
+		close(state->fd);
+		return -1;
+	}
+
+	/* Without a writer of our own the FIFO would signal end of file
+	   (and be permanently readable) whenever the last client closes
+	   it. */
+	state->keep_fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (state->keep_fd < 0) {
+		perror("open");
+		close(state->fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+override_free(override_state_t *state)
+{
+	if (state->keep_fd >= 0) close(state->keep_fd);
+	if (state->fd >= 0) close(state->fd);
+	state->fd = -1;
+	state->keep_fd = -1;
+}
+
+/* Parse a single request. Returns -1 if malformed. */
+static int
+parse_request(override_state_t *state, char *line)
+{
+	line += strspn(line, " \t");
+	line[strcspn(line, " \t\r")] = '\0';
+	if (line[0] == '\0') return 0;
+
+	if (strcasecmp(line, "reset") == 0) {
+		state->active = 0;
+		state->pending = 1;
+		return 0;
+	}
+
+	char *end;
+	errno = 0;
+	long temp = strtol(line, &end, 10);
+	if (errno != 0 || end == line || (*end != '\0' && *end != ':')) {
+		return -1;
+	}
+
+	float brightness = NAN;
+	if (*end == ':') {
+		char *s = end + 1;
+		errno = 0;
+		brightness = strtof(s, &end);
+		if (errno != 0 || end == s || *end != '\0') return -1;
+	}
+
+	double now;
+	if (systemtime_get_time(&now) < 0) now = 0.0;
+
+	state->active = 1;
+	state->temperature = temp;
+	state->brightness = brightness;
+	state->expires = now + state->timeout;
+	state->pending = 1;
+
+	return 0;
+}
+
+/* Drain all requests currently queued in the FIFO. Bursts are
+   coalesced: only the last complete request takes effect. Returns
+   1 if the target changed, 0 if not and -1 on error. */
+int
+override_read(override_state_t *state)
+{
+	int pending = state->pending;
+	state->pending = 0;
+
+	while (1) {
+		ssize_t n = read(state->fd, &state->buf[state->len],
+				 sizeof(state->buf) - state->len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			perror("read");
+			return -1;
+		} else if (n == 0) {
+			break;
+		}
+
+		state->len += n;
+
+		/* Handle all complete lines. */
+		char *begin = state->buf;
+		char *end;
+		while ((end = memchr(begin, '\n',
+				     &state->buf[state->len] - begin))
+		       != NULL) {
+			*end = '\0';
+			if (parse_request(state, begin) < 0) {
+				fprintf(stderr, _("Malformed override request"
+						  " `%s'.\n"), begin);
+			}
+			begin = end + 1;
+		}
+
+		/* Keep partial line. A line that fills the whole
+		   buffer can never be valid and is discarded. */
+		state->len = &state->buf[state->len] - begin;
+		if (state->len == sizeof(state->buf)) {
+			state->len = 0;
+		} else {
+			memmove(state->buf, begin, state->len);
+		}
+	}
+
+	int changed = state->pending;
+	state->pending = pending || changed;
+	return changed;
+}
+
+#else /* _WIN32 */
+
+int
+override_init(override_state_t *state, const char *path, double timeout)
+{
+	fputs(_("Override channel is not supported on this platform.\n"),
+	      stderr);
+	return -1;
+}
+
+void
+override_free(override_state_t *state)
+{
+}
+
+int
+override_read(override_state_t *state)
+{
+	return 0;
+}
+
+#endif /* _WIN32 */
+
+/* Deactivate the override if it timed out. Returns 1 if it did. */
+int
+override_check_expired(override_state_t *state, double now)
+{
+	if (state->active && state->timeout > 0.0 &&
+	    now >= state->expires) {
+		state->active = 0;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,61 @@
+/* override.h -- Interactive color override channel header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_OVERRIDE_H
+#define REDSHIFT_OVERRIDE_H
+
+#include <stddef.h>
+
+#define OVERRIDE_LINE_MAX  128
+
+typedef struct {
+	/* Read end of the FIFO and a write end kept open by
+	   ourselves so the FIFO never reports end of file. */
+	int fd;
+	int keep_fd;
+
+	/* Partial line carried over between reads. */
+	char buf[OVERRIDE_LINE_MAX];
+	size_t len;
+
+	/* Current target. Only the latest request is kept. */
+	int active;
+	int temperature;
+	float brightness;
+
+	/* Set when the target changed and has not been applied yet. */
+	int pending;
+	double last_apply;
+
+	/* Revert to the schedule TIMEOUT seconds after the last
+	   request (zero to hold indefinitely). */
+	double timeout;
+	double expires;
+} override_state_t;
+
+
+int override_init(override_state_t *state, const char *path,
+		  double timeout);
+void override_free(override_state_t *state);
+
+int override_read(override_state_t *state);
+int override_check_expired(override_state_t *state, double now);
+
+
+#endif /* ! REDSHIFT_OVERRIDE_H */
@@ -0,0 +1,48 @@
+/* probes.h -- Static tracepoints
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_PROBES_H
+#define REDSHIFT_PROBES_H
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+/* USDT probes for tracing with e.g. bpftrace or SystemTap. A probe is
+   a single no-op instruction until a tracer attaches to it. Without
+   sys/sdt.h the probes compile to nothing. Arguments are integers and
+   strings only; elevation is in millidegrees and brightness in
+   thousandths. See contrib/bpftrace for examples. */
+
+#ifdef HAVE_SYS_SDT_H
+# include <sys/sdt.h>
+# define REDSHIFT_PROBE0(name)  DTRACE_PROBE(redshift, name)
+# define REDSHIFT_PROBE1(name, a)  DTRACE_PROBE1(redshift, name, a)
+# define REDSHIFT_PROBE2(name, a, b)  DTRACE_PROBE2(redshift, name, a, b)
+# define REDSHIFT_PROBE3(name, a, b, c)  \
+	DTRACE_PROBE3(redshift, name, a, b, c)
+#else
+# define REDSHIFT_PROBE0(name)  do {} while (0)
+# define REDSHIFT_PROBE1(name, a)  do {} while (0)
+# define REDSHIFT_PROBE2(name, a, b)  do {} while (0)
+# define REDSHIFT_PROBE3(name, a, b, c)  do {} while (0)
+#endif
+
+
+#endif /* ! REDSHIFT_PROBES_H */
@@ -0,0 +1,246 @@
+/* record.c -- Recording of color settings source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "record.h"
+#include "systemtime.h"
+
+
+static void
+put_u32(unsigned char *p, uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+static uint32_t
+get_u32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void
+put_float(unsigned char *p, float f)
+{
+	uint32_t v;
+	memcpy(&v, &f, sizeof(v));
+	put_u32(p, v);
+}
+
+static float
+get_float(const unsigned char *p)
+{
+	uint32_t v = get_u32(p);
+	float f;
+	memcpy(&f, &v, sizeof(f));
+	return f;
+}
+
+/* Start recording color settings to PATH. */
+int
+record_open(record_t *record, const char *path)
+{
+	record->f = fopen(path, "wb");
+	if (record->f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	unsigned char header[RECORD_MAGIC_SIZE + 4];
+	memcpy(header, RECORD_MAGIC, RECORD_MAGIC_SIZE);
+	put_u32(&header[RECORD_MAGIC_SIZE], RECORD_VERSION);
+	if (fwrite(header, sizeof(header), 1, record->f) != 1) {
+		perror(path);
+		fclose(record->f);
+		return -1;
+	}
+
+	record->last = -1.0;
+	record->count = 0;
+	return 0;
+}
+
+int
+record_close(record_t *record)
+{
+	int r = fclose(record->f);
+	record->f = NULL;
+	if (r != 0) {
+		perror("fclose");
+		return -1;
+	}
+	return 0;
+}
+
+/* Append SETTING, stamped with the current monotonic time. Writes are
+   buffered so recording does not add a system call per update. */
+void
+record_write(record_t *record, const color_setting_t *setting)
+{
+	if (record == NULL || record->f == NULL) return;
+
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) now = record->last;
+
+	double delta = record->last >= 0.0 ? (now - record->last) * 1000.0 :
+		0.0;
+	if (delta < 0.0) delta = 0.0;
+	if (delta > UINT32_MAX) delta = UINT32_MAX;
+
+	unsigned char entry[RECORD_ENTRY_SIZE];
+	put_u32(&entry[0], (uint32_t)(delta + 0.5));
+	entry[4] = setting->temperature & 0xff;
+	entry[5] = (setting->temperature >> 8) & 0xff;
+	entry[6] = 0;
+	entry[7] = 0;
+	put_float(&entry[8], setting->brightness);
+	put_float(&entry[12], setting->gamma[0]);
+	put_float(&entry[16], setting->gamma[1]);
+	put_float(&entry[20], setting->gamma[2]);
+
+	if (fwrite(entry, sizeof(entry), 1, record->f) != 1) {
+		perror("fwrite");
+		fclose(record->f);
+		record->f = NULL;
+		return;
+	}
+
+	/* Deltas are rounded, so time is accumulated from the rounded
+	   value to keep the total exact. */
+	record->last = record->last >= 0.0 ?
+		record->last + (uint32_t)(delta + 0.5) / 1000.0 : now;
+	record->count += 1;
+}
+
+/* Return non-zero if SETTING is within the bounds accepted for
+   settings from the command line and configuration file. */
+static int
+setting_is_valid(const color_setting_t *setting)
+{
+	if (setting->temperature < MIN_TEMP ||
+	    setting->temperature > MAX_TEMP) {
+		return 0;
+	}
+
+	/* Comparisons with NaN are false. */
+	if (!(setting->brightness >= MIN_BRIGHTNESS &&
+	      setting->brightness <= MAX_BRIGHTNESS)) {
+		return 0;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		if (!(setting->gamma[i] >= MIN_GAMMA &&
+		      setting->gamma[i] <= MAX_GAMMA)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Load all settings from the record file at PATH. */
+int
+record_load(const char *path, record_entry_t **entries, int *count)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	unsigned char header[RECORD_MAGIC_SIZE + 4];
+	if (fread(header, sizeof(header), 1, f) != 1 ||
+	    memcmp(header, RECORD_MAGIC, RECORD_MAGIC_SIZE) != 0 ||
+	    get_u32(&header[RECORD_MAGIC_SIZE]) != RECORD_VERSION) {
+		fprintf(stderr, _("Not a record file: `%s'.\n"), path);
+		fclose(f);
+		return -1;
+	}
+
+	int size = 0;
+	int n = 0;
+	record_entry_t *list = NULL;
+	double time = 0.0;
+
+	unsigned char entry[RECORD_ENTRY_SIZE];
+	while (fread(entry, sizeof(entry), 1, f) == 1) {
+		if (n == size) {
+			size = size > 0 ? 2*size : 1024;
+			record_entry_t *l = realloc(
+				list, size * sizeof(record_entry_t));
+			if (l == NULL) {
+				perror("realloc");
+				free(list);
+				fclose(f);
+				return -1;
+			}
+			list = l;
+		}
+
+		time += get_u32(&entry[0]) / 1000.0;
+
+		record_entry_t *e = &list[n++];
+		e->time = time;
+		e->setting.temperature = entry[4] | (entry[5] << 8);
+		e->setting.brightness = get_float(&entry[8]);
+		e->setting.gamma[0] = get_float(&entry[12]);
+		e->setting.gamma[1] = get_float(&entry[16]);
+		e->setting.gamma[2] = get_float(&entry[20]);
+
+		if (!setting_is_valid(&e->setting)) {
+			fprintf(stderr, _("Invalid color setting in entry %i"
+					  " of `%s'.\n"), n, path);
+			free(list);
+			fclose(f);
+			return -1;
+		}
+	}
+
+	int error = ferror(f);
+	fclose(f);
+
+	if (error) {
+		perror(path);
+		free(list);
+		return -1;
+	} else if (n == 0) {
+		fprintf(stderr, _("Record file `%s' is empty.\n"), path);
+		free(list);
+		return -1;
+	}
+
+	*entries = list;
+	*count = n;
+	return 0;
+}
@@ -0,0 +1,57 @@
+/* record.h -- Recording of color settings header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_RECORD_H
+#define REDSHIFT_RECORD_H
+
+#include <stdio.h>
+
+#include "redshift.h"
+
+/* A record file starts with RECORD_MAGIC and the format version,
+   followed by one RECORD_ENTRY_SIZE entry per color setting. All
+   values are little endian. An entry holds the milliseconds since the
+   previous entry (32 bits), the temperature (16 bits), two reserved
+   bytes, and brightness and gamma as 32-bit floats. */
+#define RECORD_MAGIC  "RSHFTREC"
+#define RECORD_MAGIC_SIZE  8
+#define RECORD_VERSION  1
+#define RECORD_ENTRY_SIZE  24
+
+typedef struct {
+	FILE *f;
+	double last;
+	unsigned long count;
+} record_t;
+
+/* Setting loaded from a record, TIME is seconds since the first. */
+typedef struct {
+	double time;
+	color_setting_t setting;
+} record_entry_t;
+
+
+int record_open(record_t *record, const char *path);
+int record_close(record_t *record);
+void record_write(record_t *record, const color_setting_t *setting);
+
+int record_load(const char *path, record_entry_t **entries, int *count);
+
+
+#endif /* ! REDSHIFT_RECORD_H */
@@ -26,7 +26,7 @@ appindicator module isn't present it will fall back to a GTK status icon.
 import sys, os
 import fcntl
 import signal
-import re
+import json
 import gettext
 
 import gi
@@ -61,7 +61,8 @@ class RedshiftController(GObject.GObject):
         '''Initialize controller and start child process
 
         The parameter args is a list of command line arguments to pass on to
-        the child process. The "-v" argument is automatically added.'''
+        the child process. The "--output=jsonl" argument is automatically
+        added.'''
 
         GObject.GObject.__init__(self)
 
@@ -73,13 +74,11 @@ class RedshiftController(GObject.GObject):
 
         # Start redshift with arguments
         args.insert(0, os.path.join(defs.BINDIR, 'redshift'))
-        if '-v' not in args:
-            args.insert(1, '-v')
+        args.insert(1, '--output=jsonl')
 
-        # Start child process with C locale so we can parse the output
-        env = os.environ.copy()
-        env['LANG'] = env['LANGUAGE'] = env['LC_ALL'] = env['LC_MESSAGES'] = 'C'
-        self._process = GLib.spawn_async(args, envp=['{}={}'.format(k,v) for k, v in env.items()],
+        # The event stream is locale independent so the child process can
+        # run with the environment of the user.
+        self._process = GLib.spawn_async(args,
                                          flags=GLib.SPAWN_DO_NOT_REAP_CHILD,
                                          standard_output=True, standard_error=True)
 
@@ -173,31 +172,37 @@ class RedshiftController(GObject.GObject):
         GLib.spawn_close_pid(self._process[0])
         Gtk.main_quit()
 
-    def _child_key_change_cb(self, key, value):
+    def _child_event_cb(self, event):
         '''Called when the child process reports a change of internal state'''
 
-        def parse_coord(s):
-            '''Parse coordinate like `42.0 N` or `91.5 W`'''
-            v, d = s.split(' ')
-            return float(v) * (1 if d in 'NE' else -1)
+        period_names = {
+            'none': 'None',
+            'daytime': 'Daytime',
+            'night': 'Night',
+            'transition': 'Transition'
+        }
 
-        if key == 'Status':
-            new_inhibited = value != 'Enabled'
+        kind = event.get('event')
+        if kind == 'status':
+            new_inhibited = not event['enabled']
             if new_inhibited != self._inhibited:
                 self._inhibited = new_inhibited
                 self.emit('inhibit-changed', new_inhibited)
-        elif key == 'Color temperature':
-            new_temperature = int(value.rstrip('K'), 10)
+        elif kind == 'color':
+            new_temperature = int(event['temperature'])
             if new_temperature != self._temperature:
                 self._temperature = new_temperature
                 self.emit('temperature-changed', new_temperature)
-        elif key == 'Period':
-            new_period = value
+        elif kind == 'period':
+            new_period = period_names.get(event['period'], 'Unknown')
+            if event['period'] == 'transition':
+                new_period = '{} ({:.2f}% day)'.format(
+                    new_period, event['progress'] * 100)
             if new_period != self._period:
                 self._period = new_period
                 self.emit('period-changed', new_period)
-        elif key == 'Location':
-            new_location = tuple(parse_coord(x) for x in value.split(', '))
+        elif kind == 'location':
+            new_location = (event['lat'], event['lon'])
             if new_location != self._location:
                 self._location = new_location
                 self.emit('location-changed', *new_location)
@@ -205,11 +210,12 @@ class RedshiftController(GObject.GObject):
     def _child_stdout_line_cb(self, line):
         '''Called when the child process outputs a line to stdout'''
         if line:
-            m = re.match(r'([\w ]+): (.+)', line)
-            if m:
-                key = m.group(1)
-                value = m.group(2)
-                self._child_key_change_cb(key, value)
+            try:
+                event = json.loads(line)
+            except ValueError:
+                return
+            if isinstance(event, dict):
+                self._child_event_cb(event)
 
     def _child_data_cb(self, f, cond, data):
         '''Called when the child process has new data on stdout/stderr'''
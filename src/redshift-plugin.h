@@ -0,0 +1,57 @@
+/* redshift-plugin.h -- Hook plugin interface
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_PLUGIN_H
+#define REDSHIFT_PLUGIN_H
+
+/* Shared objects (*.so) in the hooks directory are loaded into the
+   redshift process. A plugin exports one or both of the callbacks
+   declared below. Callbacks return zero on success and a negative
+   value on error. They run in the main loop so they must return
+   quickly; a plugin that fails or stalls repeatedly is disabled.
+
+   Setting changes are delivered at most once per
+   hook-plugin-interval; intermediate settings are dropped and the
+   latest one is delivered when the interval has passed. */
+
+#define REDSHIFT_PLUGIN_ABI_VERSION  1
+
+/* Period names are the same as those given to hook scripts:
+   "none", "daytime", "night" and "transition". */
+typedef int redshift_plugin_period_change_func(const char *prev_period,
+					       const char *period);
+
+typedef struct {
+	int temperature;
+	float brightness;
+	float gamma[3];
+} redshift_plugin_setting_t;
+
+typedef int redshift_plugin_setting_change_func(
+	const redshift_plugin_setting_t *setting);
+
+
+/* Optional; a plugin built for another version is not loaded. */
+extern const int redshift_plugin_abi_version;
+
+redshift_plugin_period_change_func on_period_change;
+redshift_plugin_setting_change_func on_setting_change;
+
+
+#endif /* ! REDSHIFT_PLUGIN_H */
@@ -0,0 +1,69 @@
+/* redshift-shm.h -- Layout of published gamma ramps
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_SHM_H
+#define REDSHIFT_SHM_H
+
+#include <stdint.h>
+
+/* The shm adjustment method publishes the current color setting and
+   the gamma ramps of every output in a file that is mapped into
+   memory, by default $XDG_RUNTIME_DIR/redshift-gamma. Consumers such
+   as compositors map the same file and read the ramps in place.
+
+   The file starts with a redshift_shm_header_t, followed by
+   OUTPUT_COUNT redshift_shm_output_t entries. Each output's ramps are
+   RAMP_SIZE red, then green, then blue values of 16 bits, starting
+   at OFFSET bytes from the start of the file. All values are in host
+   byte order.
+
+   GENERATION is odd while an update is being written. A consumer
+   reads GENERATION, skips the update if it is odd, reads the
+   setting and the ramps, and uses them only if GENERATION did not
+   change meanwhile (with read barriers in between). A changed
+   GENERATION also tells the consumer that there is a new setting.
+
+   Consumers must check MAGIC and VERSION. Fields may be added at the
+   end of the header in later versions without changing VERSION, so
+   HEADER_SIZE gives the start of the output table. */
+
+#define REDSHIFT_SHM_MAGIC  0x47485352 /* "RSHG" */
+#define REDSHIFT_SHM_VERSION  1
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;
+	uint32_t output_count;
+	uint32_t output_size;
+	volatile uint64_t generation;
+
+	int32_t temperature;
+	float brightness;
+	float gamma[3];
+	uint32_t reserved;
+} redshift_shm_header_t;
+
+typedef struct {
+	uint32_t ramp_size;
+	uint32_t offset;
+} redshift_shm_output_t;
+
+
+#endif /* ! REDSHIFT_SHM_H */
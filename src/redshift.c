@@ -28,6 +28,12 @@
 #include <math.h>
 #include <locale.h>
 #include <errno.h>
+#include <getopt.h>
+#include <time.h>
+
+#ifndef _WIN32
+# include <poll.h>
+#endif
 
 #if defined(HAVE_SIGNAL_H) && !defined(__WIN32__)
 # include <signal.h>
@@ -48,7 +54,19 @@
 #include "solar.h"
 #include "systemtime.h"
 #include "hooks.h"
+#include "probes.h"
+#include "metrics.h"
+#include "trace.h"
+#include "simulate.h"
+#include "record.h"
+#include "idle-bench.h"
 #include "signals.h"
+#include "output-jsonl.h"
+#include "override.h"
+#include "displays.h"
+#include "location-task.h"
+#include "location-cache.h"
+#include "dirwatch.h"
 
 /* pause() is not defined on windows platform but is not needed either.
    Use a noop macro instead. */
@@ -57,6 +75,10 @@
 #endif
 
 #include "gamma-dummy.h"
+#include "gamma-sim.h"
+#ifdef HAVE_SYS_MMAN_H
+# include "gamma-shm.h"
+#endif
 
 #ifdef ENABLE_DRM
 # include "gamma-drm.h"
@@ -80,6 +102,7 @@
 
 
 #include "location-manual.h"
+#include "location-timezone.h"
 
 #ifdef ENABLE_GEOCLUE
 # include "location-geoclue.h"
@@ -98,6 +121,11 @@
 
 /* Union of state data for gamma adjustment methods */
 typedef union {
+	gamma_dummy_state_t dummy;
+	gamma_sim_state_t sim;
+#ifdef HAVE_SYS_MMAN_H
+	gamma_shm_state_t shm;
+#endif
 #ifdef ENABLE_DRM
 	drm_state_t drm;
 #endif
@@ -115,6 +143,22 @@ typedef union {
 #endif
 } gamma_state_t;
 
+/* Display served by this process. NAME is NULL when the method
+   selects the display itself (e.g. from $DISPLAY). */
+typedef struct {
+	char *name;
+	gamma_state_t state;
+	int started;
+	int failed;
+
+	/* Resource usage attributed to this display. The memory figure
+	   is only the process RSS change (kB) around starting its method;
+	   later growth is shared by all displays and not attributed. */
+	unsigned long updates;
+	double cpu_time;
+	long memory;
+} display_t;
+
 
 /* Gamma adjustment method structs */
 static const gamma_method_t gamma_methods[] = {
@@ -127,7 +171,8 @@ static const gamma_method_t gamma_methods[] = {
 		(gamma_method_print_help_func *)drm_print_help,
 		(gamma_method_set_option_func *)drm_set_option,
 		(gamma_method_restore_func *)drm_restore,
-		(gamma_method_set_temperature_func *)drm_set_temperature
+		(gamma_method_set_temperature_func *)drm_set_temperature,
+		(gamma_method_get_stats_func *)drm_get_stats
 	},
 #endif
 #ifdef ENABLE_RANDR
@@ -139,7 +184,8 @@ static const gamma_method_t gamma_methods[] = {
 		(gamma_method_print_help_func *)randr_print_help,
 		(gamma_method_set_option_func *)randr_set_option,
 		(gamma_method_restore_func *)randr_restore,
-		(gamma_method_set_temperature_func *)randr_set_temperature
+		(gamma_method_set_temperature_func *)randr_set_temperature,
+		(gamma_method_get_stats_func *)randr_get_stats
 	},
 #endif
 #ifdef ENABLE_VIDMODE
@@ -151,7 +197,8 @@ static const gamma_method_t gamma_methods[] = {
 		(gamma_method_print_help_func *)vidmode_print_help,
 		(gamma_method_set_option_func *)vidmode_set_option,
 		(gamma_method_restore_func *)vidmode_restore,
-		(gamma_method_set_temperature_func *)vidmode_set_temperature
+		(gamma_method_set_temperature_func *)vidmode_set_temperature,
+		(gamma_method_get_stats_func *)vidmode_get_stats
 	},
 #endif
 #ifdef ENABLE_QUARTZ
@@ -188,6 +235,30 @@ static const gamma_method_t gamma_methods[] = {
 		(gamma_method_restore_func *)gamma_dummy_restore,
 		(gamma_method_set_temperature_func *)gamma_dummy_set_temperature
 	},
+	{
+		"sim", 0,
+		(gamma_method_init_func *)gamma_sim_init,
+		(gamma_method_start_func *)gamma_sim_start,
+		(gamma_method_free_func *)gamma_sim_free,
+		(gamma_method_print_help_func *)gamma_sim_print_help,
+		(gamma_method_set_option_func *)gamma_sim_set_option,
+		(gamma_method_restore_func *)gamma_sim_restore,
+		(gamma_method_set_temperature_func *)gamma_sim_set_temperature,
+		(gamma_method_get_stats_func *)gamma_sim_get_stats
+	},
+#ifdef HAVE_SYS_MMAN_H
+	{
+		"shm", 0,
+		(gamma_method_init_func *)gamma_shm_init,
+		(gamma_method_start_func *)gamma_shm_start,
+		(gamma_method_free_func *)gamma_shm_free,
+		(gamma_method_print_help_func *)gamma_shm_print_help,
+		(gamma_method_set_option_func *)gamma_shm_set_option,
+		(gamma_method_restore_func *)gamma_shm_restore,
+		(gamma_method_set_temperature_func *)gamma_shm_set_temperature,
+		(gamma_method_get_stats_func *)gamma_shm_get_stats
+	},
+#endif
 	{ NULL }
 };
 
@@ -195,9 +266,13 @@ static const gamma_method_t gamma_methods[] = {
 /* Union of state data for location providers */
 typedef union {
 	location_manual_state_t manual;
+	location_timezone_state_t timezone;
 #ifdef ENABLE_GEOCLUE
 	location_geoclue_state_t geoclue;
 #endif
+#ifdef ENABLE_GEOCLUE2
+	location_geoclue2_state_t geoclue2;
+#endif
 } location_state_t;
 
 
@@ -228,7 +303,9 @@ static const location_provider_t location_providers[] = {
 		(location_provider_set_option_func *)
 		location_geoclue2_set_option,
 		(location_provider_get_location_func *)
-		location_geoclue2_get_location
+		location_geoclue2_get_location,
+		(location_provider_get_fd_func *)location_geoclue2_get_fd,
+		(location_provider_handle_func *)location_geoclue2_handle
 	},
 #endif
 #ifdef ENABLE_CORELOCATION
@@ -257,21 +334,21 @@ static const location_provider_t location_providers[] = {
 		(location_provider_get_location_func *)
 		location_manual_get_location
 	},
+	{
+		"timezone",
+		(location_provider_init_func *)location_timezone_init,
+		(location_provider_start_func *)location_timezone_start,
+		(location_provider_free_func *)location_timezone_free,
+		(location_provider_print_help_func *)
+		location_timezone_print_help,
+		(location_provider_set_option_func *)
+		location_timezone_set_option,
+		(location_provider_get_location_func *)
+		location_timezone_get_location
+	},
 	{ NULL }
 };
 
-/* Bounds for parameters. */
-#define MIN_LAT   -90.0
-#define MAX_LAT    90.0
-#define MIN_LON  -180.0
-#define MAX_LON   180.0
-#define MIN_TEMP   1000
-#define MAX_TEMP  25000
-#define MIN_BRIGHTNESS  0.1
-#define MAX_BRIGHTNESS  1.0
-#define MIN_GAMMA   0.1
-#define MAX_GAMMA  10.0
-
 /* Default values for parameters. */
 #define DEFAULT_DAY_TEMP    6500
 #define DEFAULT_NIGHT_TEMP  4500
@@ -292,15 +369,61 @@ static const location_provider_t location_providers[] = {
 #define SLEEP_DURATION        5000
 #define SLEEP_DURATION_SHORT  100
 
+/* Minimum interval between applying override requests (milliseconds).
+   Roughly one display refresh. */
+#define OVERRIDE_FRAME_INTERVAL  16
+
 /* Program modes. */
 typedef enum {
 	PROGRAM_MODE_CONTINUAL,
 	PROGRAM_MODE_ONE_SHOT,
 	PROGRAM_MODE_PRINT,
 	PROGRAM_MODE_RESET,
-	PROGRAM_MODE_MANUAL
+	PROGRAM_MODE_MANUAL,
+	PROGRAM_MODE_BENCH,
+	PROGRAM_MODE_SIMULATE
 } program_mode_t;
 
+/* Formats of status output. */
+typedef enum {
+	OUTPUT_FORMAT_TEXT,
+	OUTPUT_FORMAT_JSONL
+} output_format_t;
+
+/* Options without a short form. */
+enum {
+	OPTION_OUTPUT = 256,
+	OPTION_OVERRIDE_FIFO,
+	OPTION_OVERRIDE_TIMEOUT,
+	OPTION_DISPLAYS,
+	OPTION_LOCATION_TIMEOUT,
+	OPTION_BENCH_METHOD,
+	OPTION_TRACE_STARTUP,
+	OPTION_SIMULATE,
+	OPTION_RECORD,
+	OPTION_REPLAY,
+	OPTION_REPLAY_SPEED,
+	OPTION_BENCH_IDLE
+};
+
+static const struct option long_options[] = {
+	{ "output", required_argument, NULL, OPTION_OUTPUT },
+	{ "override-fifo", required_argument, NULL, OPTION_OVERRIDE_FIFO },
+	{ "override-timeout", required_argument, NULL,
+	  OPTION_OVERRIDE_TIMEOUT },
+	{ "displays", required_argument, NULL, OPTION_DISPLAYS },
+	{ "location-timeout", required_argument, NULL,
+	  OPTION_LOCATION_TIMEOUT },
+	{ "bench-method", required_argument, NULL, OPTION_BENCH_METHOD },
+	{ "trace-startup", required_argument, NULL, OPTION_TRACE_STARTUP },
+	{ "simulate", required_argument, NULL, OPTION_SIMULATE },
+	{ "record", required_argument, NULL, OPTION_RECORD },
+	{ "replay", required_argument, NULL, OPTION_REPLAY },
+	{ "replay-speed", required_argument, NULL, OPTION_REPLAY_SPEED },
+	{ "bench-idle", required_argument, NULL, OPTION_BENCH_IDLE },
+	{ NULL, 0, NULL, 0 }
+};
+
 /* Transition scheme.
    The solar elevations at which the transition begins/ends,
    and the association color settings. */
@@ -460,6 +583,39 @@ print_help(const char *program_name)
 	      stdout);
 	fputs("\n", stdout);
 
+	/* TRANSLATORS: help output 4a
+	   `text', `jsonl' and `auto' must not be translated
+	   no-wrap */
+	fputs(_("  --output=FORMAT\tStatus output format (`text' or `jsonl')\n"
+		"  --override-fifo=PATH\tRead color overrides from FIFO\n"
+		"  --override-timeout=SECONDS\n"
+		"  \t\tRevert overrides to the schedule after timeout\n"
+		"  --displays=LIST\tAdjust comma separated list of X displays\n"
+		"  \t\t(Type `auto' to use all local X servers)\n"
+		"  --location-timeout=SECONDS\n"
+		"  \t\tGive up waiting for the location provider\n"
+		"  --bench-method=COUNT\tMeasure latency of COUNT adjustments"
+		" and exit\n"
+		"  --trace-startup=PATH\tWrite timing of startup phases to"
+		" PATH\n"
+		"  \t\t(Chrome trace event format)\n"
+		"  --simulate=START:END[:SPEED]\n"
+		"  \t\tRun continual mode on a virtual clock from START\n"
+		"  \t\tto END (YYYY-MM-DD) and report ticks, writes and\n"
+		"  \t\tperiod changes\n"
+		"  --record=PATH\tRecord color settings applied in continual\n"
+		"  \t\tor simulation mode to PATH\n"
+		"  --replay=PATH\tApply recorded color settings and measure"
+		" latency\n"
+		"  --replay-speed=SPEED\n"
+		"  \t\tReplay at SPEED times the recorded pace\n"
+		"  \t\t(0 for as fast as possible)\n"
+		"  --bench-idle=SECONDS\tMeasure wakeups and CPU time of"
+		" continual\n"
+		"  \t\tmode over SECONDS and exit\n"),
+	      stdout);
+	fputs("\n", stdout);
+
 	/* TRANSLATORS: help output 5 */
 	printf(_("The neutral temperature is %uK. Using this value will not\n"
 		 "change the color temperature of the display. Setting the\n"
@@ -513,101 +669,9 @@ print_provider_list()
 }
 
 
-static int
-provider_try_start(const location_provider_t *provider,
-		   location_state_t *state,
-		   config_ini_state_t *config, char *args)
-{
-	int r;
-
-	r = provider->init(state);
-	if (r < 0) {
-		fprintf(stderr, _("Initialization of %s failed.\n"),
-			provider->name);
-		return -1;
-	}
-
-	/* Set provider options from config file. */
-	config_ini_section_t *section =
-		config_ini_get_section(config, provider->name);
-	if (section != NULL) {
-		config_ini_setting_t *setting = section->settings;
-		while (setting != NULL) {
-			r = provider->set_option(state, setting->name,
-						 setting->value);
-			if (r < 0) {
-				provider->free(state);
-				fprintf(stderr, _("Failed to set %s"
-						  " option.\n"),
-					provider->name);
-				/* TRANSLATORS: `help' must not be
-				   translated. */
-				fprintf(stderr, _("Try `-l %s:help' for more"
-						  " information.\n"),
-					provider->name);
-				return -1;
-			}
-			setting = setting->next;
-		}
-	}
-
-	/* Set provider options from command line. */
-	const char *manual_keys[] = { "lat", "lon" };
-	int i = 0;
-	while (args != NULL) {
-		char *next_arg = strchr(args, ':');
-		if (next_arg != NULL) *(next_arg++) = '\0';
-
-		const char *key = args;
-		char *value = strchr(args, '=');
-		if (value == NULL) {
-			/* The options for the "manual" method can be set
-			   without keys on the command line for convencience
-			   and for backwards compatability. We add the proper
-			   keys here before calling set_option(). */
-			if (strcmp(provider->name, "manual") == 0 &&
-			    i < sizeof(manual_keys)/sizeof(manual_keys[0])) {
-				key = manual_keys[i];
-				value = args;
-			} else {
-				fprintf(stderr, _("Failed to parse option `%s'.\n"),
-					args);
-				return -1;
-			}
-		} else {
-			*(value++) = '\0';
-		}
-
-		r = provider->set_option(state, key, value);
-		if (r < 0) {
-			provider->free(state);
-			fprintf(stderr, _("Failed to set %s option.\n"),
-				provider->name);
-			/* TRANSLATORS: `help' must not be translated. */
-			fprintf(stderr, _("Try `-l %s:help' for more"
-					  " information.\n"), provider->name);
-			return -1;
-		}
-
-		args = next_arg;
-		i += 1;
-	}
-
-	/* Start provider. */
-	r = provider->start(state);
-	if (r < 0) {
-		provider->free(state);
-		fprintf(stderr, _("Failed to start provider %s.\n"),
-			provider->name);
-		return -1;
-	}
-
-	return 0;
-}
-
 static int
 method_try_start(const gamma_method_t *method,
-		 gamma_state_t *state,
+		 gamma_state_t *state, const char *display,
 		 config_ini_state_t *config, char *args)
 {
 	int r;
@@ -643,6 +707,17 @@ method_try_start(const gamma_method_t *method,
 		}
 	}
 
+	/* Select display when serving several. */
+	if (display != NULL) {
+		r = method->set_option(state, "display", display);
+		if (r < 0) {
+			method->free(state);
+			fprintf(stderr, _("Method %s cannot select display"
+					  " `%s'.\n"), method->name, display);
+			return -1;
+		}
+	}
+
 	/* Set method options from command line. */
 	while (args != NULL) {
 		char *next_arg = strchr(args, ':');
@@ -770,197 +845,1318 @@ find_location_provider(const char *name)
 }
 
 
-/* Run continual mode loop
-   This is the main loop of the continual mode which keeps track of the
-   current time and continuously updates the screen to the appropriate
-   color temperature. */
+/* Read SETTING from the redshift section into SCHEME unless it was
+   already set on the command line. Returns 1 if it is a setting of
+   the color scheme, 0 if not and -1 if it is malformed. */
 static int
-run_continual_mode(const location_t *loc,
-		   const transition_scheme_t *scheme,
-		   const gamma_method_t *method,
-		   gamma_state_t *state,
-		   int transition, int verbose)
+read_scheme_setting(transition_scheme_t *scheme,
+		    const config_ini_setting_t *setting)
 {
 	int r;
 
-	/* Make an initial transition from 6500K */
-	int short_trans_delta = -1;
-	int short_trans_len = 10;
+	if (strcasecmp(setting->name, "temp-day") == 0) {
+		if (scheme->day.temperature < 0) {
+			scheme->day.temperature = atoi(setting->value);
+		}
+	} else if (strcasecmp(setting->name, "temp-night") == 0) {
+		if (scheme->night.temperature < 0) {
+			scheme->night.temperature = atoi(setting->value);
+		}
+	} else if (strcasecmp(setting->name, "brightness") == 0) {
+		if (isnan(scheme->day.brightness)) {
+			scheme->day.brightness = atof(setting->value);
+		}
+		if (isnan(scheme->night.brightness)) {
+			scheme->night.brightness = atof(setting->value);
+		}
+	} else if (strcasecmp(setting->name, "brightness-day") == 0) {
+		if (isnan(scheme->day.brightness)) {
+			scheme->day.brightness = atof(setting->value);
+		}
+	} else if (strcasecmp(setting->name, "brightness-night") == 0) {
+		if (isnan(scheme->night.brightness)) {
+			scheme->night.brightness = atof(setting->value);
+		}
+	} else if (strcasecmp(setting->name, "elevation-high") == 0) {
+		scheme->high = atof(setting->value);
+	} else if (strcasecmp(setting->name, "elevation-low") == 0) {
+		scheme->low = atof(setting->value);
+	} else if (strcasecmp(setting->name, "gamma") == 0) {
+		if (isnan(scheme->day.gamma[0])) {
+			r = parse_gamma_string(setting->value,
+					       scheme->day.gamma);
+			if (r < 0) {
+				fputs(_("Malformed gamma setting.\n"),
+				      stderr);
+				return -1;
+			}
+			memcpy(scheme->night.gamma, scheme->day.gamma,
+			       sizeof(scheme->night.gamma));
+		}
+	} else if (strcasecmp(setting->name, "gamma-day") == 0) {
+		if (isnan(scheme->day.gamma[0])) {
+			r = parse_gamma_string(setting->value,
+					       scheme->day.gamma);
+			if (r < 0) {
+				fputs(_("Malformed gamma setting.\n"),
+				      stderr);
+				return -1;
+			}
+		}
+	} else if (strcasecmp(setting->name, "gamma-night") == 0) {
+		if (isnan(scheme->night.gamma[0])) {
+			r = parse_gamma_string(setting->value,
+					       scheme->night.gamma);
+			if (r < 0) {
+				fputs(_("Malformed gamma setting.\n"),
+				      stderr);
+				return -1;
+			}
+		}
+	} else {
+		return 0;
+	}
 
-	/* Amount of adjustment to apply. At zero the color
-	   temperature will be exactly as calculated, and at one it
-	   will be exactly 6500K. */
-	double adjustment_alpha = 1.0;
+	return 1;
+}
 
-	r = signals_install_handlers();
-	if (r < 0) {
-		return r;
+/* Use default values for settings that were neither defined in the
+   config file nor on the command line. */
+static void
+scheme_set_defaults(transition_scheme_t *scheme)
+{
+	if (scheme->day.temperature < 0) {
+		scheme->day.temperature = DEFAULT_DAY_TEMP;
+	}
+	if (scheme->night.temperature < 0) {
+		scheme->night.temperature = DEFAULT_NIGHT_TEMP;
 	}
 
-	if (verbose) {
-		printf(_("Status: %s\n"), _("Enabled"));
+	if (isnan(scheme->day.brightness)) {
+		scheme->day.brightness = DEFAULT_BRIGHTNESS;
+	}
+	if (isnan(scheme->night.brightness)) {
+		scheme->night.brightness = DEFAULT_BRIGHTNESS;
 	}
 
-	/* Save previous colors so we can avoid
-	   printing status updates if the values
-	   did not change. */
-	period_t prev_period = PERIOD_NONE;
-	color_setting_t prev_interp =
-		{ -1, { NAN, NAN, NAN }, NAN };
+	if (isnan(scheme->day.gamma[0])) {
+		scheme->day.gamma[0] = DEFAULT_GAMMA;
+		scheme->day.gamma[1] = DEFAULT_GAMMA;
+		scheme->day.gamma[2] = DEFAULT_GAMMA;
+	}
+	if (isnan(scheme->night.gamma[0])) {
+		scheme->night.gamma[0] = DEFAULT_GAMMA;
+		scheme->night.gamma[1] = DEFAULT_GAMMA;
+		scheme->night.gamma[2] = DEFAULT_GAMMA;
+	}
+}
 
-	/* Continuously adjust color temperature */
-	int done = 0;
-	int disabled = 0;
-	while (1) {
-		/* Check to see if disable signal was caught */
-		if (disable) {
-			short_trans_len = 2;
-			if (!disabled) {
-				/* Transition to disabled state */
-				short_trans_delta = 1;
-			} else {
-				/* Transition back to enabled */
-				short_trans_delta = -1;
-			}
-			disabled = !disabled;
-			disable = 0;
+/* Check that the values of SCHEME are within range. Temperatures and
+   solar elevations are only checked if SOLAR is set. */
+static int
+scheme_is_valid(const transition_scheme_t *scheme, int solar)
+{
+	/* Color temperature */
+	if (solar &&
+	    (scheme->day.temperature < MIN_TEMP ||
+	     scheme->day.temperature > MAX_TEMP ||
+	     scheme->night.temperature < MIN_TEMP ||
+	     scheme->night.temperature > MAX_TEMP)) {
+		fprintf(stderr,
+			_("Temperature must be between %uK and %uK.\n"),
+			MIN_TEMP, MAX_TEMP);
+		return 0;
+	}
 
-			if (verbose) {
-				printf(_("Status: %s\n"), disabled ?
-				       _("Disabled") : _("Enabled"));
-			}
-		}
+	/* Solar elevations */
+	if (solar && scheme->high < scheme->low) {
+		fprintf(stderr,
+			_("High transition elevation cannot be lower than"
+			  " the low transition elevation.\n"));
+		return 0;
+	}
 
-		/* Check to see if exit signal was caught */
-		if (exiting) {
-			if (done) {
-				/* On second signal stop the ongoing
-				   transition */
-				short_trans_delta = 0;
-				adjustment_alpha = 0.0;
-			} else {
-				if (!disabled) {
-					/* Make a short transition
-					   back to 6500K */
-					short_trans_delta = 1;
-					short_trans_len = 2;
-				}
+	/* Brightness */
+	if (scheme->day.brightness < MIN_BRIGHTNESS ||
+	    scheme->day.brightness > MAX_BRIGHTNESS ||
+	    scheme->night.brightness < MIN_BRIGHTNESS ||
+	    scheme->night.brightness > MAX_BRIGHTNESS) {
+		fprintf(stderr,
+			_("Brightness values must be between %.1f and %.1f.\n"),
+			MIN_BRIGHTNESS, MAX_BRIGHTNESS);
+		return 0;
+	}
 
-				done = 1;
-			}
-			exiting = 0;
-		}
+	/* Gamma */
+	if (!gamma_is_valid(scheme->day.gamma) ||
+	    !gamma_is_valid(scheme->night.gamma)) {
+		fprintf(stderr,
+			_("Gamma value must be between %.1f and %.1f.\n"),
+			MIN_GAMMA, MAX_GAMMA);
+		return 0;
+	}
 
-		/* Read timestamp */
-		double now;
-		r = systemtime_get_time(&now);
-		if (r < 0) {
-			fputs(_("Unable to read system time.\n"), stderr);
-			return -1;
-		}
+	return 1;
+}
 
-		/* Skip over transition if transitions are disabled */
-		int set_adjustments = 0;
-		if (!transition) {
-			if (short_trans_delta) {
-				adjustment_alpha = short_trans_delta < 0 ?
-					0.0 : 1.0;
-				short_trans_delta = 0;
-				set_adjustments = 1;
-			}
-		}
 
-		/* Current angular elevation of the sun */
-		double elevation = solar_elevation(now, loc->lat,
-						   loc->lon);
+/* Default time to wait for a location provider (seconds). */
+#define DEFAULT_LOCATION_TIMEOUT  30.0
 
-		/* Use elevation of sun to set color temperature */
-		color_setting_t interp;
-		interpolate_color_settings(scheme, elevation, &interp);
+/* Start of the program, for reporting startup timing. */
+static double startup_time = 0.0;
 
-		/* Print period if it changed during this update,
-		   or if we are in transition. In transition we
-		   print the progress, so we always print it in
-		   that case. */
-		period_t period = get_period(scheme, elevation);
-		if (verbose && (period != prev_period ||
-				period == PERIOD_TRANSITION)) {
-			double transition =
-				get_transition_progress(scheme,
-							elevation);
-			print_period(period, transition);
-		}
+static void
+print_startup_phase(const char *phase)
+{
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) return;
 
-		/* Activate hooks if period changed */
-		if (period != prev_period) {
-			hooks_signal_period_change(prev_period, period);
-		}
+	/* TRANSLATORS: The first argument is one of the startup phases
+	   below, e.g. `location available'. */
+	printf(_("Startup: %s after %.1f ms\n"), phase,
+	       (now - startup_time) * 1000.0);
+}
 
-		/* Ongoing short transition */
-		if (short_trans_delta) {
-			/* Calculate alpha */
-			adjustment_alpha += short_trans_delta * 0.1 /
-				(float)short_trans_len;
+/* Where locations taken by the lookup are reported. */
+typedef struct {
+	int verbose;
+	output_jsonl_state_t *jsonl;
 
-			/* Stop transition when done */
-			if (adjustment_alpha <= 0.0 ||
-			    adjustment_alpha >= 1.0) {
-				short_trans_delta = 0;
-			}
+	/* Set if fixes from positioning providers are written to the
+	   location cache. */
+	int cache;
+} location_report_t;
 
-			/* Clamp alpha value */
-			adjustment_alpha = CLAMP(0.0, adjustment_alpha, 1.0);
-		}
+/* Return non-zero if PROVIDER determines the actual position. */
+static int
+location_provider_is_positioning(const location_provider_t *provider)
+{
+	return strcmp(provider->name, "geoclue") == 0 ||
+		strcmp(provider->name, "geoclue2") == 0 ||
+		strcmp(provider->name, "corelocation") == 0;
+}
+
+static void
+location_report_fix(void *data, const location_provider_t *provider,
+		    const location_t *loc, int first)
+{
+	const location_report_t *report = data;
+
+	REDSHIFT_PROBE3(location_fix, provider->name,
+			(long)(loc->lat * 1000000.0),
+			(long)(loc->lon * 1000000.0));
+
+	if (first && report->verbose) {
+		print_startup_phase(_("location available"));
+	}
+
+	/* Remember for the next start. Manual coordinates and the time
+	   zone estimate are available anyway and must not replace a
+	   real fix. */
+	if (report->cache && location_provider_is_positioning(provider)) {
+		location_cache_store(loc, provider->name);
+	}
+
+	if (report->verbose) print_location(loc);
+	if (report->jsonl != NULL) output_jsonl_location(report->jsonl, loc);
+}
+
+/* Estimate location from the time zone until the provider responds.
+   If the zone is not known, the standard time offset is used with the
+   equator as latitude which places sunrise and sunset near 6:00 and
+   18:00. */
+static void
+get_provisional_location(location_t *loc)
+{
+	char zone[LOCATION_TIMEZONE_NAME_MAX];
+	if (location_timezone_get_zone(zone, sizeof(zone)) == 0 &&
+	    location_timezone_lookup(zone, loc) == 0) {
+		return;
+	}
+
+	time_t now = time(NULL);
+	struct tm utc = *gmtime(&now);
+	utc.tm_isdst = 0;
+	double offset = difftime(now, mktime(&utc));
+
+	loc->lat = 0.0;
+	loc->lon = CLAMP(MIN_LON, offset / 3600.0 * 15.0, MAX_LON);
+}
+
+/* Set if the resources used by each display are reported on exit.
+   The CPU clock of the process is a system call, so updates are only
+   timed when the result is shown. */
+static int display_stats = 0;
+
+/* Apply SETTING to every display. A display that fails is reported
+   and skipped from then on, so losing one X server does not affect
+   the others. Returns -1 when no display is left. Latency is recorded
+   in METRICS unless it is NULL. */
+static int
+displays_set_temperature(const gamma_method_t *method,
+			 display_t *displays, int display_count,
+			 const color_setting_t *setting, metrics_t *metrics)
+{
+	int active = 0;
+	for (int i = 0; i < display_count; i++) {
+		display_t *display = &displays[i];
+		if (display->failed) continue;
+
+		double start = 0.0, end = 0.0;
+		double wall_start = 0.0, wall_end = 0.0;
+		if (display_stats && systemtime_get_cpu_time(&start) < 0) {
+			start = 0.0;
+		}
+		if (metrics != NULL) systemtime_get_monotonic_time(&wall_start);
+		REDSHIFT_PROBE3(set_temperature_entry, method->name, i,
+				setting->temperature);
+		int r = method->set_temperature(&display->state, setting);
+		REDSHIFT_PROBE3(set_temperature_return, method->name, i, r);
+		if (metrics != NULL) {
+			systemtime_get_monotonic_time(&wall_end);
+			metrics_record_write(metrics, wall_end - wall_start,
+					     r < 0);
+		}
+		if (display_stats) {
+			if (systemtime_get_cpu_time(&end) < 0) end = start;
+			display->cpu_time += end - start;
+		}
+
+		if (r < 0) {
+			if (display->name != NULL) {
+				fprintf(stderr, _("Temperature adjustment"
+						  " failed on display"
+						  " `%s'.\n"), display->name);
+			}
+			display->failed = 1;
+			continue;
+		}
+
+		display->updates += 1;
+		active += 1;
+	}
+
+	return active > 0 ? 0 : -1;
+}
+
+/* Restore saved gamma ramps on displays that are still usable. */
+static void
+displays_restore(const gamma_method_t *method,
+		 display_t *displays, int display_count)
+{
+	for (int i = 0; i < display_count; i++) {
+		if (displays[i].started && !displays[i].failed) {
+			method->restore(&displays[i].state);
+		}
+	}
+}
+
+/* Free adjustment state of displays that were started. */
+static void
+displays_close(const gamma_method_t *method,
+	       display_t *displays, int display_count)
+{
+	for (int i = 0; i < display_count; i++) {
+		if (displays[i].started) method->free(&displays[i].state);
+		displays[i].started = 0;
+	}
+}
+
+/* Report resources used on behalf of each display. */
+static void
+print_display_stats(const display_t *displays, int display_count,
+		    int verbose, output_jsonl_state_t *jsonl)
+{
+	for (int i = 0; i < display_count; i++) {
+		const display_t *display = &displays[i];
+		const char *name = display->name != NULL ?
+			display->name : "";
+
+		if (verbose) {
+			printf(_("Display `%s': %lu updates, %.3f s CPU,"
+				 " %ld kB RSS growth at start%s\n"), name, display->updates,
+			       display->cpu_time, display->memory,
+			       display->failed ? _(" (failed)") : "");
+		}
+		if (jsonl != NULL) {
+			char quoted[256];
+			output_jsonl_escape(quoted, sizeof(quoted), name);
+			output_jsonl_event(jsonl, "display",
+					   ",\"name\":%s,\"failed\":%s,"
+					   "\"updates\":%lu,\"cpu\":%.6f,"
+					   "\"start_rss\":%ld", quoted,
+					   display->failed ? "true" : "false",
+					   display->updates, display->cpu_time,
+					   display->memory);
+		}
+	}
+}
+
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+/* Sum the backend statistics of all started displays. Returns zero
+   if the method does not keep statistics. */
+static int
+displays_get_stats(const gamma_method_t *method,
+		   display_t *displays, int display_count,
+		   gamma_method_stats_t *total)
+{
+	total->round_trips = 0;
+	total->bytes_sent = 0;
+	if (method->get_stats == NULL) return 0;
+
+	for (int i = 0; i < display_count; i++) {
+		if (!displays[i].started) continue;
+		gamma_method_stats_t stats;
+		method->get_stats(&displays[i].state, &stats);
+		total->round_trips += stats.round_trips;
+		total->bytes_sent += stats.bytes_sent;
+	}
+
+	return 1;
+}
+
+/* Create COUNT different color settings for benchmarking. */
+static record_entry_t *
+bench_generate_settings(int count)
+{
+	record_entry_t *entries = malloc(count * sizeof(record_entry_t));
+	if (entries == NULL) {
+		perror("malloc");
+		return NULL;
+	}
+
+	for (int i = 0; i < count; i++) {
+		/* Every update needs new ramps. */
+		color_setting_t setting = {
+			MIN_TEMP + (i * 97) % (MAX_TEMP - MIN_TEMP),
+			{ 1.0, 1.0, 1.0 },
+			0.5 + (i % 50) / 100.0
+		};
+		entries[i].time = 0.0;
+		entries[i].setting = setting;
+	}
+
+	return entries;
+}
+
+/* Apply the COUNT settings in ENTRIES and report the latency of each
+   update, the requests it took, the processor time used and the
+   throughput. With SPEED above zero the settings are paced at their
+   recorded times, sped up by SPEED, otherwise they are applied as fast
+   as possible. The original gamma ramps are restored afterwards. */
+static int
+run_bench_method(const gamma_method_t *method,
+		 display_t *displays, int display_count,
+		 const record_entry_t *entries, int count, double speed,
+		 output_jsonl_state_t *jsonl)
+{
+	double *latency = malloc(count * sizeof(double));
+	if (latency == NULL) {
+		perror("malloc");
+		return -1;
+	}
+
+	gamma_method_stats_t before;
+	gamma_method_stats_t after;
+	displays_get_stats(method, displays, display_count, &before);
+
+	double cpu_start, cpu_end;
+	if (systemtime_get_cpu_time(&cpu_start) < 0) cpu_start = 0.0;
+
+	double bench_start, bench_end;
+	systemtime_get_monotonic_time(&bench_start);
+
+	int r = 0;
+	for (int i = 0; i < count; i++) {
+		double start, end;
+		systemtime_get_monotonic_time(&start);
+		if (speed > 0.0) {
+			double due = bench_start + entries[i].time / speed;
+			if (due > start) {
+				systemtime_sleep(due - start);
+				systemtime_get_monotonic_time(&start);
+			}
+		}
+
+		r = displays_set_temperature(method, displays, display_count,
+					     &entries[i].setting, NULL);
+		systemtime_get_monotonic_time(&end);
+		if (r < 0) {
+			fputs(_("Temperature adjustment failed.\n"), stderr);
+			break;
+		}
+
+		latency[i] = end - start;
+	}
+
+	if (systemtime_get_cpu_time(&cpu_end) < 0) cpu_end = cpu_start;
+	systemtime_get_monotonic_time(&bench_end);
+
+	displays_restore(method, displays, display_count);
+
+	if (r < 0) {
+		free(latency);
+		return -1;
+	}
+
+	displays_get_stats(method, displays, display_count, &after);
+
+	qsort(latency, count, sizeof(double), compare_double);
+	double p50 = latency[count / 2];
+	double p99 = latency[(count * 99) / 100 < count ?
+			     (count * 99) / 100 : count - 1];
+	double max = latency[count - 1];
+	double cpu = (cpu_end - cpu_start) / count;
+	double elapsed = bench_end - bench_start;
+	double throughput = elapsed > 0.0 ? count / elapsed : 0.0;
+	double round_trips = (double)(after.round_trips -
+				      before.round_trips) / count;
+	double bytes_sent = (double)(after.bytes_sent -
+				     before.bytes_sent) / count;
+
+	free(latency);
+
+	/* Counters are not available from every method. */
+	int have_stats = method->get_stats != NULL;
+
+	if (jsonl != NULL) {
+		char stats[128] = "";
+		if (have_stats) {
+			snprintf(stats, sizeof(stats),
+				 ",\"round_trips\":%.3f,\"bytes\":%.1f",
+				 round_trips, bytes_sent);
+		}
+		output_jsonl_event(jsonl, "bench",
+				   ",\"method\":\"%s\",\"calls\":%i,"
+				   "\"elapsed\":%.6f,\"throughput\":%.1f,"
+				   "\"p50\":%.6f,\"p99\":%.6f,\"max\":%.6f,"
+				   "\"cpu\":%.6f%s", method->name, count,
+				   elapsed, throughput, p50, p99, max, cpu,
+				   stats);
+	} else {
+		printf(_("Method `%s': %i adjustments\n"), method->name,
+		       count);
+		printf(_("Elapsed: %.3f s, %.1f adjustments per second\n"),
+		       elapsed, throughput);
+		printf(_("Latency: p50 %.3f ms, p99 %.3f ms,"
+			 " max %.3f ms\n"),
+		       p50 * 1000.0, p99 * 1000.0, max * 1000.0);
+		printf(_("CPU time per adjustment: %.3f ms\n"),
+		       cpu * 1000.0);
+		if (have_stats) {
+			printf(_("Round trips per adjustment: %.2f\n"),
+			       round_trips);
+			printf(_("Bytes sent per adjustment: %.0f\n"),
+			       bytes_sent);
+		}
+	}
+
+	return 0;
+}
+
+
+/* Reloading of the configuration file in continual mode. */
+typedef struct {
+	dirwatch_t watch;
+	char *path;
+
+	/* Settings from the command line take precedence over the
+	   configuration file. Method options are split in place so a
+	   copy is kept for restarts. */
+	transition_scheme_t base;
+	char *method_args;
+
+	/* Configuration in effect. The configuration loaded at startup
+	   may still be used by location providers, so it is kept. */
+	config_ini_state_t *config;
+	config_ini_state_t reloaded;
+	int have_reloaded;
+} config_reload_t;
+
+static int
+config_reload_init(config_reload_t *reload, config_ini_state_t *config,
+		   const transition_scheme_t *base, const char *method_args)
+{
+	if (config->path == NULL) return -1;
+
+	int r = dirwatch_init_file(&reload->watch, config->path);
+	if (r < 0) return -1;
+
+	reload->path = config->path;
+	reload->base = *base;
+	reload->method_args = NULL;
+	reload->config = config;
+	reload->have_reloaded = 0;
+
+	if (method_args != NULL) {
+		reload->method_args = strdup(method_args);
+		if (reload->method_args == NULL) {
+			perror("strdup");
+			dirwatch_free(&reload->watch);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+config_reload_free(config_reload_t *reload)
+{
+	dirwatch_free(&reload->watch);
+	free(reload->method_args);
+	if (reload->have_reloaded) config_ini_free(&reload->reloaded);
+}
+
+static int
+scheme_equal(const transition_scheme_t *a, const transition_scheme_t *b)
+{
+	const color_setting_t *sa[] = { &a->day, &a->night };
+	const color_setting_t *sb[] = { &b->day, &b->night };
+
+	if (a->high != b->high || a->low != b->low) return 0;
+	for (int i = 0; i < 2; i++) {
+		if (sa[i]->temperature != sb[i]->temperature ||
+		    sa[i]->brightness != sb[i]->brightness ||
+		    memcmp(sa[i]->gamma, sb[i]->gamma,
+			   sizeof(sa[i]->gamma)) != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Restart the method on every display with the options in CONFIG. */
+static void
+displays_restart(const gamma_method_t *method,
+		 display_t *displays, int display_count,
+		 config_ini_state_t *config, const char *method_args)
+{
+	for (int i = 0; i < display_count; i++) {
+		display_t *display = &displays[i];
+		if (!display->started || display->failed) continue;
+
+		method->restore(&display->state);
+		method->free(&display->state);
+		display->started = 0;
+
+		char *args = method_args != NULL ? strdup(method_args) : NULL;
+		int r = method_try_start(method, &display->state,
+					 display->name, config, args);
+		free(args);
+		if (r < 0) {
+			display->failed = 1;
+			continue;
+		}
+
+		display->started = 1;
+	}
+}
+
+/* Read the configuration file again after it changed and apply the
+   settings that differ. The color scheme is replaced in place and the
+   method is only restarted if its options changed. Returns 1 if
+   anything was applied. */
+static int
+config_reload_apply(config_reload_t *reload, transition_scheme_t *scheme,
+		    const gamma_method_t *method,
+		    display_t *displays, int display_count, int verbose)
+{
+	config_ini_state_t config;
+	int r = config_ini_init(&config, reload->path);
+	if (r < 0) {
+		fputs(_("Unable to reload config file.\n"), stderr);
+		return 0;
+	}
+
+	transition_scheme_t next = reload->base;
+	int valid = 1;
+
+	config_ini_section_t *section =
+		config_ini_get_section(&config, "redshift");
+	if (section != NULL) {
+		config_ini_setting_t *setting = section->settings;
+		while (setting != NULL) {
+			r = read_scheme_setting(&next, setting);
+			if (r < 0) valid = 0;
+			setting = setting->next;
+		}
+	}
+
+	scheme_set_defaults(&next);
+	if (!valid || !scheme_is_valid(&next, 1)) {
+		fputs(_("Keeping the previous configuration.\n"), stderr);
+		config_ini_free(&config);
+		return 0;
+	}
+
+	int changed = 0;
+	if (!scheme_equal(&next, scheme)) {
+		*scheme = next;
+		changed = 1;
+		if (verbose) {
+			printf(_("Temperatures: %dK at day, %dK at night\n"),
+			       scheme->day.temperature,
+			       scheme->night.temperature);
+		}
+	}
+
+	if (!config_ini_section_equal(
+		    config_ini_get_section(reload->config, method->name),
+		    config_ini_get_section(&config, method->name))) {
+		if (verbose) {
+			printf(_("Restarting method `%s'.\n"),
+			       method->name);
+		}
+		displays_restart(method, displays, display_count,
+				 &config, reload->method_args);
+		changed = 1;
+	}
+
+	if (reload->have_reloaded) config_ini_free(&reload->reloaded);
+	reload->reloaded = config;
+	reload->config = &reload->reloaded;
+	reload->have_reloaded = 1;
+
+	if (verbose) fputs(_("Configuration reloaded.\n"), stdout);
+
+	return changed;
+}
+
+
+/* Reasons for continual_mode_wait() to return. */
+typedef enum {
+	WAIT_TIMEOUT,
+	WAIT_INTERRUPTED,
+	WAIT_OVERRIDE,
+	WAIT_LOCATION,
+	WAIT_CONFIG,
+	WAIT_METRICS
+} wait_result_t;
+
+/* Wait until DEADLINE (seconds since epoch) while delivering queued
+   status output and reading override requests. Returns early when
+   interrupted by a signal, when an override request is due or when
+   the location lookup made progress or timed out, or when the
+   configuration file changed, or when metrics are due to be written.
+   Hooks that exit meanwhile are reaped, hooks that run too long are
+   terminated and rate limited settings are passed on to plugins.
+   Bursts of requests are coalesced and paced to
+   OVERRIDE_FRAME_INTERVAL. */
+static wait_result_t
+continual_mode_wait(double deadline, output_jsonl_state_t *jsonl,
+		    override_state_t *override,
+		    const location_task_t *locating,
+		    config_reload_t *reload, hooks_state_t *hooks,
+		    metrics_t *metrics)
+{
+#ifndef _WIN32
+	while (1) {
+		double now;
+		if (systemtime_get_time(&now) < 0) return WAIT_INTERRUPTED;
+
+		double wake = deadline;
+		if (override != NULL && override->active &&
+		    override->timeout > 0.0) {
+			/* Run an update as soon as the override expires. */
+			if (now >= override->expires) return WAIT_TIMEOUT;
+			if (override->expires < wake) wake = override->expires;
+		}
+
+		if (override != NULL && override->pending) {
+			double frame = override->last_apply +
+				OVERRIDE_FRAME_INTERVAL / 1000.0;
+			if (now >= frame) return WAIT_OVERRIDE;
+			if (frame < wake) wake = frame;
+		}
+
+		if (locating != NULL && locating->pending) {
+			/* Give up on the location providers in time. */
+			double mono;
+			if (systemtime_get_monotonic_time(&mono) == 0) {
+				if (mono >= locating->deadline) {
+					return WAIT_LOCATION;
+				}
+				double give_up = now + locating->deadline - mono;
+				if (give_up < wake) wake = give_up;
+			}
+		}
+
+		double hook_deadline;
+		if (hooks_get_deadline(hooks, &hook_deadline) == 0) {
+			double mono;
+			if (systemtime_get_monotonic_time(&mono) == 0) {
+				if (mono >= hook_deadline) {
+					hooks_handle_deadline(hooks);
+					continue;
+				}
+				double kill_at = now + hook_deadline - mono;
+				if (kill_at < wake) wake = kill_at;
+			}
+		}
+
+		if (metrics != NULL) {
+			/* Written on request (SIGUSR2) or periodically. */
+			if (dump_metrics) return WAIT_METRICS;
+
+			double next_write;
+			double mono;
+			if (metrics_get_deadline(metrics, &next_write) == 0 &&
+			    systemtime_get_monotonic_time(&mono) == 0) {
+				if (mono >= next_write) return WAIT_METRICS;
+				double write_at = now + next_write - mono;
+				if (write_at < wake) wake = write_at;
+			}
+		}
+
+		if (now >= deadline) return WAIT_TIMEOUT;
+
+		struct pollfd fds[5 + (locating != NULL ?
+				       locating->probe_count : 0)];
+		int nfds = 0;
+		int jsonl_index = -1;
+		int override_index = -1;
+		int config_index = -1;
+		int hooks_index = -1;
+		int hooks_watch_index = -1;
+
+		if (jsonl != NULL && output_jsonl_pending(jsonl)) {
+			fds[nfds].fd = jsonl->fd;
+			fds[nfds].events = POLLOUT;
+			jsonl_index = nfds++;
+		}
+
+		if (override != NULL) {
+			fds[nfds].fd = override->fd;
+			fds[nfds].events = POLLIN;
+			override_index = nfds++;
+		}
+
+		if (reload != NULL) {
+			fds[nfds].fd = reload->watch.fd;
+			fds[nfds].events = POLLIN;
+			config_index = nfds++;
+		}
+
+		int hooks_fd = hooks_get_fd(hooks);
+		if (hooks_fd >= 0) {
+			fds[nfds].fd = hooks_fd;
+			fds[nfds].events = POLLIN;
+			hooks_index = nfds++;
+		}
+
+		int hooks_watch_fd = hooks_get_watch_fd(hooks);
+		if (hooks_watch_fd >= 0) {
+			fds[nfds].fd = hooks_watch_fd;
+			fds[nfds].events = POLLIN;
+			hooks_watch_index = nfds++;
+		}
+
+		int location_index = nfds;
+		nfds += location_task_get_fds(locating, &fds[nfds]);
+
+		/* A simulated clock only advances by sleeping, so file
+		   descriptors are only checked without waiting. */
+		int simulated = systemtime_is_simulated();
+		int r = 0;
+		if (nfds > 0 || !simulated) {
+			r = poll(fds, nfds, simulated ? 0 :
+				 ceil((wake - now) * 1000.0));
+		}
+		if (metrics != NULL) metrics->wakeups += 1;
+		if (r < 0) {
+			if (errno == EINTR) {
+				metrics_record_wakeup(metrics,
+						      METRICS_WAKEUP_SIGNAL);
+			}
+
+			/* A metrics request should not cut the wait short. */
+			if (errno == EINTR && metrics != NULL &&
+			    dump_metrics) {
+				continue;
+			}
+			if (errno != EINTR) perror("poll");
+			return WAIT_INTERRUPTED;
+		}
+
+		if (r == 0) {
+			metrics_record_wakeup(metrics, METRICS_WAKEUP_TIMER);
+		}
+
+		if (simulated && r == 0) {
+			systemtime_sleep(wake - now);
+			continue;
+		}
+
+		if (jsonl_index >= 0 && fds[jsonl_index].revents) {
+			metrics_record_wakeup(metrics, METRICS_WAKEUP_OUTPUT);
+			output_jsonl_flush(jsonl);
+		}
+
+		if (override_index >= 0 &&
+		    (fds[override_index].revents & POLLIN)) {
+			metrics_record_wakeup(metrics,
+					      METRICS_WAKEUP_OVERRIDE);
+			override_read(override);
+		}
+
+		if (hooks_index >= 0 && fds[hooks_index].revents) {
+			metrics_record_wakeup(metrics, METRICS_WAKEUP_HOOK);
+			hooks_reap(hooks);
+		}
+
+		if (hooks_watch_index >= 0 &&
+		    fds[hooks_watch_index].revents) {
+			metrics_record_wakeup(metrics, METRICS_WAKEUP_HOOK);
+			hooks_handle_watch(hooks);
+		}
+
+		/* Changes to other files in the directory of the config
+		   file are consumed here without an update. */
+		if (config_index >= 0 && fds[config_index].revents) {
+			metrics_record_wakeup(metrics, METRICS_WAKEUP_CONFIG);
+			if (dirwatch_read(&reload->watch) != 0) {
+				return WAIT_CONFIG;
+			}
+		}
+
+		for (int i = location_index; i < nfds; i++) {
+			if (fds[i].revents) {
+				metrics_record_wakeup(metrics,
+						      METRICS_WAKEUP_LOCATION);
+				return WAIT_LOCATION;
+			}
+		}
+	}
+#else /* _WIN32 */
+	if (jsonl != NULL) output_jsonl_flush(jsonl);
+
+	double now;
+	if (systemtime_get_time(&now) < 0) return WAIT_INTERRUPTED;
+	if (now < deadline) systemtime_msleep((deadline - now) * 1000.0);
+
+	return WAIT_TIMEOUT;
+#endif /* _WIN32 */
+}
+
+/* Replace the scheduled color setting with the override target. */
+static void
+apply_override(const override_state_t *override, color_setting_t *setting)
+{
+	setting->temperature = CLAMP(MIN_TEMP, override->temperature,
+				     MAX_TEMP);
+	if (!isnan(override->brightness)) {
+		setting->brightness = CLAMP(MIN_BRIGHTNESS,
+					    override->brightness,
+					    MAX_BRIGHTNESS);
+	}
+}
+
+static void
+print_override(const override_state_t *override, int verbose,
+	       output_jsonl_state_t *jsonl)
+{
+	if (verbose) {
+		printf(_("Override: %s\n"), override->active ?
+		       _("Active") : _("Inactive"));
+	}
+	if (jsonl != NULL) {
+		output_jsonl_event(jsonl, "override", ",\"active\":%s",
+				   override->active ? "true" : "false");
+	}
+}
+
+/* Write the metrics file with the current backend and hook state. */
+static void
+write_metrics(metrics_t *metrics, const gamma_method_t *method,
+	      display_t *displays, int display_count,
+	      const location_task_t *locating, const hooks_state_t *hooks)
+{
+	metrics_sources_t sources;
+	sources.method = method->name;
+	sources.have_method_stats = displays_get_stats(
+		method, displays, display_count, &sources.method_stats);
+	sources.hooks = hooks;
+	sources.location_fix_time = locating != NULL ?
+		locating->fix_time : NAN;
+
+	if (metrics_write(metrics, &sources) < 0) {
+		fprintf(stderr, _("Unable to write metrics to `%s'.\n"),
+			metrics->path);
+	}
+	dump_metrics = 0;
+}
+
+/* Run continual mode loop
+   This is the main loop of the continual mode which keeps track of the
+   current time and continuously updates the screen to the appropriate
+   color temperature. */
+static int
+run_continual_mode(location_t *loc,
+		   transition_scheme_t *scheme,
+		   const gamma_method_t *method,
+		   display_t *displays, int display_count,
+		   int transition, int verbose,
+		   output_jsonl_state_t *jsonl,
+		   override_state_t *override,
+		   location_task_t *locating,
+		   config_reload_t *reload,
+		   hooks_state_t *hooks,
+		   metrics_t *metrics,
+		   simulation_t *sim,
+		   record_t *record,
+		   idle_bench_t *idle)
+{
+	int r;
+
+	/* Make an initial transition from 6500K */
+	int short_trans_delta = -1;
+	int short_trans_len = 10;
+
+	/* Amount of adjustment to apply. At zero the color
+	   temperature will be exactly as calculated, and at one it
+	   will be exactly 6500K. */
+	double adjustment_alpha = 1.0;
+
+	r = signals_install_handlers();
+	if (r < 0) {
+		return r;
+	}
+
+	if (verbose) {
+		printf(_("Status: %s\n"), _("Enabled"));
+	}
+	if (jsonl != NULL) output_jsonl_status(jsonl, 1);
+
+	/* Save previous colors so we can avoid
+	   printing status updates if the values
+	   did not change. */
+	period_t prev_period = PERIOD_NONE;
+	color_setting_t prev_interp =
+		{ -1, { NAN, NAN, NAN }, NAN };
+
+	/* Continuously adjust color temperature */
+	int done = 0;
+	int disabled = 0;
+	int override_active = 0;
+	int first_update = 1;
+	while (1) {
+		REDSHIFT_PROBE0(tick_start);
+		if (metrics != NULL) metrics->ticks += 1;
+
+		/* Check to see if disable signal was caught */
+		if (disable) {
+			short_trans_len = 2;
+			if (!disabled) {
+				/* Transition to disabled state */
+				short_trans_delta = 1;
+			} else {
+				/* Transition back to enabled */
+				short_trans_delta = -1;
+			}
+			disabled = !disabled;
+			disable = 0;
+
+			if (verbose) {
+				printf(_("Status: %s\n"), disabled ?
+				       _("Disabled") : _("Enabled"));
+			}
+			if (jsonl != NULL) {
+				output_jsonl_status(jsonl, !disabled);
+			}
+		}
+
+		/* Check to see if exit signal was caught */
+		if (exiting) {
+			if (done) {
+				/* On second signal stop the ongoing
+				   transition */
+				short_trans_delta = 0;
+				adjustment_alpha = 0.0;
+			} else {
+				if (!disabled) {
+					/* Make a short transition
+					   back to 6500K */
+					short_trans_delta = 1;
+					short_trans_len = 2;
+				}
+
+				done = 1;
+			}
+			exiting = 0;
+		}
+
+		/* Read timestamp */
+		double now;
+		r = systemtime_get_time(&now);
+		if (r < 0) {
+			fputs(_("Unable to read system time.\n"), stderr);
+			return -1;
+		}
+
+		if (sim != NULL && simulation_done(sim, now)) break;
+
+		/* Measure idle operation after the initial fade. */
+		if (idle != NULL) {
+			if (!short_trans_delta) idle_bench_begin(idle, metrics);
+			if (idle_bench_done(idle, metrics)) break;
+		}
+
+		/* Skip over transition if transitions are disabled */
+		int set_adjustments = 0;
+		if (!transition) {
+			if (short_trans_delta) {
+				adjustment_alpha = short_trans_delta < 0 ?
+					0.0 : 1.0;
+				short_trans_delta = 0;
+				set_adjustments = 1;
+			}
+		}
+
+		/* Current angular elevation of the sun */
+		double elevation = solar_elevation(now, loc->lat,
+						   loc->lon);
+		REDSHIFT_PROBE1(elevation, (long)(elevation * 1000.0));
+
+		/* Use elevation of sun to set color temperature */
+		color_setting_t interp;
+		interpolate_color_settings(scheme, elevation, &interp);
+
+		/* An active override replaces the scheduled setting
+		   until it is reset or times out. */
+		color_setting_t scheduled = interp;
+		if (override != NULL && !done) {
+			override_check_expired(override, now);
+			if (override->active != override_active) {
+				override_active = override->active;
+				print_override(override, verbose, jsonl);
+			}
+			if (override->active) {
+				apply_override(override, &interp);
+				override->pending = 0;
+				override->last_apply = now;
+			}
+		}
+
+		/* Print period if it changed during this update,
+		   or if we are in transition. In transition we
+		   print the progress, so we always print it in
+		   that case. */
+		period_t period = get_period(scheme, elevation);
+		if ((verbose || jsonl != NULL) &&
+		    (period != prev_period || period == PERIOD_TRANSITION)) {
+			double transition =
+				get_transition_progress(scheme,
+							elevation);
+			if (verbose) print_period(period, transition);
+			if (jsonl != NULL) {
+				output_jsonl_period(jsonl, period,
+						    transition);
+			}
+		}
+
+		/* Activate hooks if period changed */
+		if (period != prev_period) {
+			hooks_signal_period_change(hooks, prev_period,
+						   period);
+			if (sim != NULL) {
+				simulation_record_period(sim, now, period);
+			}
+		}
+
+		/* Ongoing short transition */
+		if (short_trans_delta) {
+			/* Calculate alpha */
+			adjustment_alpha += short_trans_delta * 0.1 /
+				(float)short_trans_len;
+
+			/* Stop transition when done */
+			if (adjustment_alpha <= 0.0 ||
+			    adjustment_alpha >= 1.0) {
+				short_trans_delta = 0;
+			}
+
+			/* Clamp alpha value */
+			adjustment_alpha = CLAMP(0.0, adjustment_alpha, 1.0);
+		}
+
+		/* Interpolate between 6500K and calculated
+		   temperature */
+		interp.temperature = adjustment_alpha*6500 +
+			(1.0-adjustment_alpha)*interp.temperature;
+
+		interp.brightness = adjustment_alpha*1.0 +
+			(1.0-adjustment_alpha)*interp.brightness;
+
+		/* Quit loop when done */
+		if (done && !short_trans_delta) break;
+
+		if (verbose) {
+			if (interp.temperature !=
+			    prev_interp.temperature) {
+				printf(_("Color temperature: %uK\n"),
+				       interp.temperature);
+			}
+			if (interp.brightness !=
+			    prev_interp.brightness) {
+				printf(_("Brightness: %.2f\n"),
+				       interp.brightness);
+			}
+		}
+
+		if (jsonl != NULL &&
+		    (interp.temperature != prev_interp.temperature ||
+		     interp.brightness != prev_interp.brightness)) {
+			output_jsonl_color(jsonl, &interp);
+		}
+
+		/* Mirror the setting to plugins */
+		if (interp.temperature != prev_interp.temperature ||
+		    interp.brightness != prev_interp.brightness) {
+			hooks_signal_setting_change(hooks, &interp);
+		}
+
+		REDSHIFT_PROBE3(setting, interp.temperature,
+				(int)(interp.brightness * 1000.0), period);
+
+		/* Adjust temperature */
+		double trace_start = first_update ? trace_begin() : NAN;
+		if (!disabled || short_trans_delta || set_adjustments) {
+			record_write(record, &interp);
+			r = displays_set_temperature(method, displays,
+						     display_count, &interp,
+						     metrics);
+			if (r < 0) {
+				fputs(_("Temperature adjustment"
+					" failed.\n"), stderr);
+				return -1;
+			}
+		} else if (metrics != NULL) {
+			metrics->skipped_writes += 1;
+		}
+
+		if (first_update) {
+			trace_end("adjust", trace_start,
+				  "first set_temperature");
+			trace_end("startup", startup_time, "startup");
+			trace_write();
+			if (verbose) {
+				print_startup_phase(_("first adjustment"));
+			}
+			first_update = 0;
+		}
+
+		REDSHIFT_PROBE0(tick_end);
+
+		/* Save temperature as previous */
+		prev_period = period;
+		memcpy(&prev_interp, &interp,
+		       sizeof(color_setting_t));
+
+		/* Sleep for 5 seconds or 0.1 second. Override requests
+		   are applied as they arrive in the meantime. */
+		double deadline = now + (short_trans_delta ?
+					 SLEEP_DURATION_SHORT :
+					 SLEEP_DURATION) / 1000.0;
+
+		/* A benchmark stops on time, not at the next tick. */
+		double idle_end;
+		if (idle_bench_get_deadline(idle, now, &idle_end) == 0 &&
+		    idle_end < deadline) {
+			deadline = idle_end;
+		}
+		wait_result_t waited;
+		while ((waited = continual_mode_wait(deadline, jsonl, override,
+						   locating, reload, hooks,
+						   metrics)) ==
+		       WAIT_OVERRIDE || waited == WAIT_METRICS) {
+			if (waited == WAIT_METRICS) {
+				write_metrics(metrics, method, displays,
+					      display_count, locating, hooks);
+				continue;
+			}
+
+			override->pending = 0;
+			systemtime_get_time(&override->last_apply);
+
+			if (override->active != override_active) {
+				override_active = override->active;
+				print_override(override, verbose, jsonl);
+			}
 
-		/* Interpolate between 6500K and calculated
-		   temperature */
-		interp.temperature = adjustment_alpha*6500 +
-			(1.0-adjustment_alpha)*interp.temperature;
+			/* Reverting to the schedule is a full update. */
+			if (!override->active) break;
 
-		interp.brightness = adjustment_alpha*1.0 +
-			(1.0-adjustment_alpha)*interp.brightness;
+			if (disabled || done) continue;
 
-		/* Quit loop when done */
-		if (done && !short_trans_delta) break;
+			color_setting_t setting = scheduled;
+			apply_override(override, &setting);
+			setting.temperature = adjustment_alpha*6500 +
+				(1.0-adjustment_alpha)*setting.temperature;
+			setting.brightness = adjustment_alpha*1.0 +
+				(1.0-adjustment_alpha)*setting.brightness;
 
-		if (verbose) {
-			if (interp.temperature !=
-			    prev_interp.temperature) {
-				printf(_("Color temperature: %uK\n"),
-				       interp.temperature);
+			if (setting.temperature == prev_interp.temperature &&
+			    setting.brightness == prev_interp.brightness) {
+				continue;
 			}
-			if (interp.brightness !=
-			    prev_interp.brightness) {
-				printf(_("Brightness: %.2f\n"),
-				       interp.brightness);
+
+			if (verbose) {
+				printf(_("Color temperature: %uK\n"),
+				       setting.temperature);
 			}
-		}
+			if (jsonl != NULL) output_jsonl_color(jsonl, &setting);
+			hooks_signal_setting_change(hooks, &setting);
 
-		/* Adjust temperature */
-		if (!disabled || short_trans_delta || set_adjustments) {
-			r = method->set_temperature(state, &interp);
+			record_write(record, &setting);
+			r = displays_set_temperature(method, displays,
+						     display_count, &setting,
+						     metrics);
 			if (r < 0) {
 				fputs(_("Temperature adjustment"
 					" failed.\n"), stderr);
 				return -1;
 			}
+
+			memcpy(&prev_interp, &setting,
+			       sizeof(color_setting_t));
 		}
 
-		/* Save temperature as previous */
-		prev_period = period;
-		memcpy(&prev_interp, &interp,
-		       sizeof(color_setting_t));
+		/* Replace the provisional location, or follow the
+		   provider. The next update follows immediately. */
+		if (waited == WAIT_LOCATION) {
+			r = location_task_poll(locating, loc);
+			if (r < 0) {
+				displays_restore(method, displays,
+						 display_count);
+				return -1;
+			}
+		}
 
-		/* Sleep for 5 seconds or 0.1 second. */
-		if (short_trans_delta) {
-			systemtime_msleep(SLEEP_DURATION_SHORT);
-		} else {
-			systemtime_msleep(SLEEP_DURATION);
+		/* New settings take effect with the next update. */
+		if (waited == WAIT_CONFIG) {
+			config_reload_apply(reload, scheme, method, displays,
+					    display_count, verbose);
 		}
 	}
 
+	if (metrics != NULL) {
+		write_metrics(metrics, method, displays, display_count,
+			      locating, hooks);
+	}
+
 	/* Restore saved gamma ramps */
-	method->restore(state);
+	displays_restore(method, displays, display_count);
 
 	return 0;
 }
@@ -970,6 +2166,8 @@ main(int argc, char *argv[])
 {
 	int r;
 
+	systemtime_get_monotonic_time(&startup_time);
+
 #ifdef ENABLE_NLS
 	/* Init locale */
 	setlocale(LC_CTYPE, "");
@@ -998,6 +2196,12 @@ main(int argc, char *argv[])
 
 	/* Temperature for manual mode */
 	int temp_set = -1;
+	int bench_count = 0;
+	char *record_path = NULL;
+	char *replay_path = NULL;
+	double replay_speed = 0.0;
+	double idle_duration = 0.0;
+	simulation_t simulation;
 
 	const gamma_method_t *method = NULL;
 	char *method_args = NULL;
@@ -1008,6 +2212,16 @@ main(int argc, char *argv[])
 	int transition = -1;
 	program_mode_t mode = PROGRAM_MODE_CONTINUAL;
 	int verbose = 0;
+	output_format_t output_format = OUTPUT_FORMAT_TEXT;
+	char *override_path = NULL;
+	double override_timeout = 0.0;
+	double location_timeout = NAN;
+	double hook_timeout = NAN;
+	int hook_concurrency = -1;
+	double hook_plugin_interval = NAN;
+	char *metrics_path = NULL;
+	double metrics_interval = NAN;
+	display_list_t display_list = { NULL, 0 };
 	char *s;
 
 	/* Flush messages consistently even if redirected to a pipe or
@@ -1018,7 +2232,8 @@ main(int argc, char *argv[])
 
 	/* Parse command line arguments. */
 	int opt;
-	while ((opt = getopt(argc, argv, "b:c:g:hl:m:oO:prt:vVx")) != -1) {
+	while ((opt = getopt_long(argc, argv, "b:c:g:hl:m:oO:prt:vVx",
+				  long_options, NULL)) != -1) {
 		switch (opt) {
 		case 'b':
 			parse_brightness_string(optarg,
@@ -1160,6 +2375,79 @@ main(int argc, char *argv[])
 		case 'x':
 			mode = PROGRAM_MODE_RESET;
 			break;
+		case OPTION_OUTPUT:
+			if (strcasecmp(optarg, "text") == 0) {
+				output_format = OUTPUT_FORMAT_TEXT;
+			} else if (strcasecmp(optarg, "jsonl") == 0) {
+				output_format = OUTPUT_FORMAT_JSONL;
+			} else {
+				fprintf(stderr, _("Unknown output format"
+						  " `%s'.\n"), optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPTION_OVERRIDE_FIFO:
+			free(override_path);
+			override_path = strdup(optarg);
+			break;
+		case OPTION_OVERRIDE_TIMEOUT:
+			override_timeout = atof(optarg);
+			break;
+		case OPTION_DISPLAYS:
+			displays_free(&display_list);
+			r = displays_parse(&display_list, optarg);
+			if (r < 0) exit(EXIT_FAILURE);
+			break;
+		case OPTION_LOCATION_TIMEOUT:
+			location_timeout = atof(optarg);
+			break;
+		case OPTION_BENCH_METHOD:
+			mode = PROGRAM_MODE_BENCH;
+			bench_count = atoi(optarg);
+			if (bench_count < 1) {
+				fputs(_("Number of adjustments must be"
+					" positive.\n"), stderr);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPTION_TRACE_STARTUP:
+			trace_free();
+			r = trace_init(optarg, startup_time);
+			if (r < 0) exit(EXIT_FAILURE);
+			break;
+		case OPTION_RECORD:
+			free(record_path);
+			record_path = strdup(optarg);
+			break;
+		case OPTION_REPLAY:
+			mode = PROGRAM_MODE_BENCH;
+			free(replay_path);
+			replay_path = strdup(optarg);
+			break;
+		case OPTION_REPLAY_SPEED:
+			replay_speed = atof(optarg);
+			if (replay_speed < 0.0) {
+				fputs(_("Replay speed must not be"
+					" negative.\n"), stderr);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPTION_BENCH_IDLE:
+			idle_duration = atof(optarg);
+			if (idle_duration <= 0.0) {
+				fputs(_("Benchmark duration must be"
+					" positive.\n"), stderr);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPTION_SIMULATE:
+			if (mode == PROGRAM_MODE_SIMULATE) {
+				simulation_free(&simulation);
+			}
+			mode = PROGRAM_MODE_SIMULATE;
+			r = simulation_parse(&simulation, optarg);
+			if (r < 0) exit(EXIT_FAILURE);
+			break;
 		case '?':
 			fputs(_("Try `-h' for more information.\n"), stderr);
 			exit(EXIT_FAILURE);
@@ -1167,7 +2455,41 @@ main(int argc, char *argv[])
 		}
 	}
 
+	/* In JSON lines mode the original standard output carries the
+	   event stream exclusively. Everything else printed to stdout
+	   is redirected to stderr so it cannot corrupt the stream. */
+	output_jsonl_state_t jsonl_state;
+	output_jsonl_state_t *jsonl = NULL;
+	if (output_format == OUTPUT_FORMAT_JSONL) {
+		fflush(stdout);
+		int fd = dup(STDOUT_FILENO);
+		if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+			perror("dup");
+			exit(EXIT_FAILURE);
+		}
+
+		r = output_jsonl_init(&jsonl_state, fd,
+				      OUTPUT_JSONL_BUFFER_SIZE);
+		if (r < 0) exit(EXIT_FAILURE);
+		jsonl = &jsonl_state;
+	}
+
+	/* Simulations and idle benchmarks only touch the display when
+	   a method is given on the command line. */
+	char quiet_args[] = "quiet=1";
+	if (method == NULL &&
+	    (mode == PROGRAM_MODE_SIMULATE ||
+	     (mode == PROGRAM_MODE_CONTINUAL && idle_duration > 0.0))) {
+		method = find_gamma_method("dummy");
+		method_args = quiet_args;
+	}
+
+	/* Settings from the command line are kept for reloading the
+	   config file. */
+	transition_scheme_t cli_scheme = scheme;
+
 	/* Load settings from config file. */
+	double config_start = trace_begin();
 	config_ini_state_t config_state;
 	r = config_ini_init(&config_state, config_filepath);
 	if (r < 0) {
@@ -1183,85 +2505,38 @@ main(int argc, char *argv[])
 	if (section != NULL) {
 		config_ini_setting_t *setting = section->settings;
 		while (setting != NULL) {
-			if (strcasecmp(setting->name, "temp-day") == 0) {
-				if (scheme.day.temperature < 0) {
-					scheme.day.temperature =
-						atoi(setting->value);
-				}
-			} else if (strcasecmp(setting->name,
-					      "temp-night") == 0) {
-				if (scheme.night.temperature < 0) {
-					scheme.night.temperature =
-						atoi(setting->value);
-				}
+			r = read_scheme_setting(&scheme, setting);
+			if (r < 0) {
+				exit(EXIT_FAILURE);
+			} else if (r > 0) {
+				/* Setting of the color scheme. */
 			} else if (strcasecmp(setting->name,
 					      "transition") == 0) {
 				if (transition < 0) {
 					transition = !!atoi(setting->value);
 				}
 			} else if (strcasecmp(setting->name,
-					      "brightness") == 0) {
-				if (isnan(scheme.day.brightness)) {
-					scheme.day.brightness =
-						atof(setting->value);
-				}
-				if (isnan(scheme.night.brightness)) {
-					scheme.night.brightness =
+					      "location-timeout") == 0) {
+				if (isnan(location_timeout)) {
+					location_timeout =
 						atof(setting->value);
 				}
 			} else if (strcasecmp(setting->name,
-					      "brightness-day") == 0) {
-				if (isnan(scheme.day.brightness)) {
-					scheme.day.brightness =
-						atof(setting->value);
-				}
+					      "hook-timeout") == 0) {
+				hook_timeout = atof(setting->value);
 			} else if (strcasecmp(setting->name,
-					      "brightness-night") == 0) {
-				if (isnan(scheme.night.brightness)) {
-					scheme.night.brightness =
-						atof(setting->value);
-				}
+					      "hook-concurrency") == 0) {
+				hook_concurrency = atoi(setting->value);
 			} else if (strcasecmp(setting->name,
-					      "elevation-high") == 0) {
-				scheme.high = atof(setting->value);
+					      "hook-plugin-interval") == 0) {
+				hook_plugin_interval = atof(setting->value);
 			} else if (strcasecmp(setting->name,
-					      "elevation-low") == 0) {
-				scheme.low = atof(setting->value);
-			} else if (strcasecmp(setting->name, "gamma") == 0) {
-				if (isnan(scheme.day.gamma[0])) {
-					r = parse_gamma_string(setting->value,
-							       scheme.day.gamma);
-					if (r < 0) {
-						fputs(_("Malformed gamma"
-							" setting.\n"),
-						      stderr);
-						exit(EXIT_FAILURE);
-					}
-					memcpy(scheme.night.gamma, scheme.day.gamma,
-					       sizeof(scheme.night.gamma));
-				}
-			} else if (strcasecmp(setting->name, "gamma-day") == 0) {
-				if (isnan(scheme.day.gamma[0])) {
-					r = parse_gamma_string(setting->value,
-							       scheme.day.gamma);
-					if (r < 0) {
-						fputs(_("Malformed gamma"
-							" setting.\n"),
-						      stderr);
-						exit(EXIT_FAILURE);
-					}
-				}
-			} else if (strcasecmp(setting->name, "gamma-night") == 0) {
-				if (isnan(scheme.night.gamma[0])) {
-					r = parse_gamma_string(setting->value,
-							       scheme.night.gamma);
-					if (r < 0) {
-						fputs(_("Malformed gamma"
-							" setting.\n"),
-						      stderr);
-						exit(EXIT_FAILURE);
-					}
-				}
+					      "metrics-file") == 0) {
+				free(metrics_path);
+				metrics_path = strdup(setting->value);
+			} else if (strcasecmp(setting->name,
+					      "metrics-interval") == 0) {
+				metrics_interval = atof(setting->value);
 			} else if (strcasecmp(setting->name,
 					      "adjustment-method") == 0) {
 				if (method == NULL) {
@@ -1299,94 +2574,56 @@ main(int argc, char *argv[])
 		}
 	}
 
+	trace_end("config", config_start, "config");
+
 	/* Use default values for settings that were neither defined in
 	   the config file nor on the command line. */
-	if (scheme.day.temperature < 0) {
-		scheme.day.temperature = DEFAULT_DAY_TEMP;
-	}
-	if (scheme.night.temperature < 0) {
-		scheme.night.temperature = DEFAULT_NIGHT_TEMP;
-	}
+	scheme_set_defaults(&scheme);
 
-	if (isnan(scheme.day.brightness)) {
-		scheme.day.brightness = DEFAULT_BRIGHTNESS;
-	}
-	if (isnan(scheme.night.brightness)) {
-		scheme.night.brightness = DEFAULT_BRIGHTNESS;
-	}
+	if (transition < 0) transition = 1;
 
-	if (isnan(scheme.day.gamma[0])) {
-		scheme.day.gamma[0] = DEFAULT_GAMMA;
-		scheme.day.gamma[1] = DEFAULT_GAMMA;
-		scheme.day.gamma[2] = DEFAULT_GAMMA;
-	}
-	if (isnan(scheme.night.gamma[0])) {
-		scheme.night.gamma[0] = DEFAULT_GAMMA;
-		scheme.night.gamma[1] = DEFAULT_GAMMA;
-		scheme.night.gamma[2] = DEFAULT_GAMMA;
+	if (isnan(location_timeout) || location_timeout <= 0.0) {
+		location_timeout = DEFAULT_LOCATION_TIMEOUT;
 	}
 
-	if (transition < 0) transition = 1;
-
 	location_t loc = { NAN, NAN };
 
-	/* Initialize location provider. If provider is NULL
-	   try all providers until one that works is found. */
-	location_state_t location_state;
-
-	/* Location is not needed for reset mode and manual mode. */
+	/* The location provider can take seconds to respond, so it is
+	   queried in the background while the adjustment method starts.
+	   Location is not needed for reset, manual and benchmark mode. */
+	location_task_t location_task;
+	location_task_t *locating = NULL;
+	location_report_t location_report = { verbose, jsonl, 0 };
 	if (mode != PROGRAM_MODE_RESET &&
-	    mode != PROGRAM_MODE_MANUAL) {
-		if (provider != NULL) {
-			/* Use provider specified on command line. */
-			r = provider_try_start(provider, &location_state,
-					       &config_state, provider_args);
-			if (r < 0) exit(EXIT_FAILURE);
-		} else {
-			/* Try all providers, use the first that works. */
-			for (int i = 0;
-			     location_providers[i].name != NULL; i++) {
-				const location_provider_t *p =
-					&location_providers[i];
-				fprintf(stderr,
-					_("Trying location provider `%s'...\n"),
-					p->name);
-				r = provider_try_start(p, &location_state,
-						       &config_state, NULL);
-				if (r < 0) {
-					fputs(_("Trying next provider...\n"),
-					      stderr);
-					continue;
-				}
-
-				/* Found provider that works. */
-				printf(_("Using provider `%s'.\n"), p->name);
-				provider = p;
-				break;
-			}
-
-			/* Failure if no providers were successful at this
-			   point. */
-			if (provider == NULL) {
-				fputs(_("No more location providers"
-					" to try.\n"), stderr);
-				exit(EXIT_FAILURE);
+	    mode != PROGRAM_MODE_MANUAL &&
+	    mode != PROGRAM_MODE_BENCH) {
+		/* Simulations, replays and benchmarks do not describe
+		   where the user is, so they leave the cache alone. */
+		location_report.cache = mode != PROGRAM_MODE_SIMULATE &&
+			replay_path == NULL && idle_duration <= 0.0;
+
+		/* Without a provider selected all of them are tried. */
+		const location_provider_t *providers = provider;
+		int count = 1;
+		if (provider == NULL) {
+			providers = location_providers;
+			count = 0;
+			while (location_providers[count].name != NULL) {
+				count += 1;
 			}
 		}
 
-		/* Get current location. */
-		r = provider->get_location(&location_state, &loc);
-		if (r < 0) {
-		        fputs(_("Unable to get location from provider.\n"),
-		              stderr);
-		        exit(EXIT_FAILURE);
-		}
-
-		provider->free(&location_state);
+		r = location_task_start(&location_task, providers, count,
+					sizeof(location_state_t),
+					provider == NULL, provider_args,
+					&config_state,
+					mode == PROGRAM_MODE_CONTINUAL,
+					location_timeout, location_report_fix,
+					&location_report);
+		if (r < 0) exit(EXIT_FAILURE);
+		locating = &location_task;
 
 		if (verbose) {
-			print_location(&loc);
-
 			printf(_("Temperatures: %dK at day, %dK at night\n"),
 			       scheme.day.temperature,
 			       scheme.night.temperature);
@@ -1395,43 +2632,6 @@ main(int argc, char *argv[])
 			printf(_("Solar elevations: day above %.1f, night below %.1f\n"),
 			       scheme.high, scheme.low);
 		}
-
-		/* Latitude */
-		if (loc.lat < MIN_LAT || loc.lat > MAX_LAT) {
-		        /* TRANSLATORS: Append degree symbols if possible. */
-		        fprintf(stderr,
-		                _("Latitude must be between %.1f and %.1f.\n"),
-		                MIN_LAT, MAX_LAT);
-		        exit(EXIT_FAILURE);
-		}
-
-		/* Longitude */
-		if (loc.lon < MIN_LON || loc.lon > MAX_LON) {
-		        /* TRANSLATORS: Append degree symbols if possible. */
-		        fprintf(stderr,
-		                _("Longitude must be between"
-		                  " %.1f and %.1f.\n"), MIN_LON, MAX_LON);
-		        exit(EXIT_FAILURE);
-		}
-
-		/* Color temperature */
-		if (scheme.day.temperature < MIN_TEMP ||
-		    scheme.day.temperature > MAX_TEMP ||
-		    scheme.night.temperature < MIN_TEMP ||
-		    scheme.night.temperature > MAX_TEMP) {
-			fprintf(stderr,
-				_("Temperature must be between %uK and %uK.\n"),
-				MIN_TEMP, MAX_TEMP);
-			exit(EXIT_FAILURE);
-		}
-
-		/* Solar elevations */
-		if (scheme.high < scheme.low) {
-		        fprintf(stderr,
-		                _("High transition elevation cannot be lower than"
-				  " the low transition elevation.\n"));
-		        exit(EXIT_FAILURE);
-		}
 	}
 
 	if (mode == PROGRAM_MODE_MANUAL) {
@@ -1444,32 +2644,11 @@ main(int argc, char *argv[])
 		}
 	}
 
-	/* Brightness */
-	if (scheme.day.brightness < MIN_BRIGHTNESS ||
-	    scheme.day.brightness > MAX_BRIGHTNESS ||
-	    scheme.night.brightness < MIN_BRIGHTNESS ||
-	    scheme.night.brightness > MAX_BRIGHTNESS) {
-		fprintf(stderr,
-			_("Brightness values must be between %.1f and %.1f.\n"),
-			MIN_BRIGHTNESS, MAX_BRIGHTNESS);
-		exit(EXIT_FAILURE);
-	}
+	if (!scheme_is_valid(&scheme, locating != NULL)) exit(EXIT_FAILURE);
 
 	if (verbose) {
 		printf(_("Brightness: %.2f:%.2f\n"),
 		       scheme.day.brightness, scheme.night.brightness);
-	}
-
-	/* Gamma */
-	if (!gamma_is_valid(scheme.day.gamma) ||
-	    !gamma_is_valid(scheme.night.gamma)) {
-		fprintf(stderr,
-			_("Gamma value must be between %.1f and %.1f.\n"),
-			MIN_GAMMA, MAX_GAMMA);
-		exit(EXIT_FAILURE);
-	}
-
-	if (verbose) {
 		/* TRANSLATORS: The string in parenthesis is either
 		   Daytime or Night (translated). */
 		printf(_("Gamma (%s): %.3f, %.3f, %.3f\n"),
@@ -1480,44 +2659,180 @@ main(int argc, char *argv[])
 		       scheme.night.gamma[1], scheme.night.gamma[2]);
 	}
 
-	/* Initialize gamma adjustment method. If method is NULL
-	   try all methods until one that works is found. */
-	gamma_state_t state;
+	/* Every display gets its own adjustment state while the solar
+	   computation, ramp cache and event loop are shared. Without
+	   --displays there is one display chosen by the method. */
+	int display_count = display_list.count > 0 ? display_list.count : 1;
+	display_t *displays = calloc(display_count, sizeof(display_t));
+	if (displays == NULL) {
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < display_list.count; i++) {
+		displays[i].name = display_list.names[i];
+	}
+	display_stats = display_list.count > 0 && (verbose || jsonl != NULL);
 
 	/* Gamma adjustment not needed for print mode */
 	if (mode != PROGRAM_MODE_PRINT) {
-		if (method != NULL) {
-			/* Use method specified on command line. */
-			r = method_try_start(method, &state, &config_state,
-					     method_args);
-			if (r < 0) exit(EXIT_FAILURE);
-		} else {
-			/* Try all methods, use the first that works. */
-			for (int i = 0; gamma_methods[i].name != NULL; i++) {
-				const gamma_method_t *m = &gamma_methods[i];
-				if (!m->autostart) continue;
+		int started = 0;
+		for (int i = 0; i < display_count; i++) {
+			display_t *display = &displays[i];
+			long rss = displays_get_rss();
+
+#if defined(ENABLE_VIDMODE) && !defined(HAVE_XSETIOERROREXITHANDLER)
+			/* Older Xlib exits the process when a connection is
+			   lost, so one VidMode display would take all the
+			   others down with it. */
+			if (i > 0 && strcmp(method->name, "vidmode") == 0) {
+				fputs(_("This version of Xlib cannot adjust"
+					" several displays with VidMode;"
+					" use randr with --displays.\n"),
+				      stderr);
+				displays_close(method, displays,
+					       display_count);
+				exit(EXIT_FAILURE);
+			}
+#endif
 
-				r = method_try_start(m, &state, &config_state, NULL);
-				if (r < 0) {
-					fputs(_("Trying next method...\n"), stderr);
-					continue;
+			/* Options are split in place so each display
+			   needs its own copy. */
+			char *args = NULL;
+			if (method_args != NULL) {
+				args = strdup(method_args);
+				if (args == NULL) {
+					perror("strdup");
+					exit(EXIT_FAILURE);
+				}
+			}
+
+			if (method != NULL) {
+				/* Use method specified on command line
+				   or found for the first display. */
+				double start = trace_begin();
+				r = method_try_start(method, &display->state,
+						     display->name,
+						     &config_state, args);
+				trace_end("method", start,
+					  "method_try_start %s", method->name);
+			} else {
+				/* Try all methods, use the first that
+				   works. */
+				for (int j = 0; gamma_methods[j].name != NULL;
+				     j++) {
+					const gamma_method_t *m =
+						&gamma_methods[j];
+					if (!m->autostart) continue;
+
+					double start = trace_begin();
+					r = method_try_start(m, &display->state,
+							     display->name,
+							     &config_state,
+							     NULL);
+					trace_end("method", start,
+						  "method_try_start %s",
+						  m->name);
+					if (r < 0) {
+						fputs(_("Trying next method...\n"),
+						      stderr);
+						continue;
+					}
+
+					/* Found method that works. */
+					printf(_("Using method `%s'.\n"),
+					       m->name);
+					method = m;
+					break;
 				}
 
-				/* Found method that works. */
-				printf(_("Using method `%s'.\n"), m->name);
-				method = m;
-				break;
+				/* Failure if no methods were successful
+				   at this point. */
+				if (method == NULL) {
+					fputs(_("No more methods to try.\n"),
+					      stderr);
+					exit(EXIT_FAILURE);
+				}
 			}
 
-			/* Failure if no methods were successful at this point. */
-			if (method == NULL) {
-				fputs(_("No more methods to try.\n"), stderr);
-				exit(EXIT_FAILURE);
+			free(args);
+
+			if (r < 0) {
+				/* A single broken display does not stop
+				   the others from being served. */
+				if (display_list.count <= 1) exit(EXIT_FAILURE);
+				fprintf(stderr, _("Skipping display `%s'.\n"),
+					display->name);
+				display->failed = 1;
+				continue;
+			}
+
+			long rss_after = displays_get_rss();
+			display->memory = rss >= 0 && rss_after >= 0 ?
+				rss_after - rss : -1;
+			display->started = 1;
+			started += 1;
+		}
+
+		if (started == 0) {
+			fputs(_("No display could be adjusted.\n"), stderr);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (verbose && mode != PROGRAM_MODE_PRINT) {
+		print_startup_phase(_("adjustment method ready"));
+	}
+
+	/* In continual mode a provisional location is used if the
+	   provider has not responded yet. It is replaced as soon as the
+	   provider delivers a location. Other modes wait here. */
+	if (locating != NULL && mode == PROGRAM_MODE_CONTINUAL) {
+		r = location_task_poll(locating, &loc);
+		if (r < 0) {
+			displays_close(method, displays, display_count);
+			exit(EXIT_FAILURE);
+		} else if (locating->pending) {
+			location_cache_entry_t cached;
+			if (location_cache_load(&cached) == 0) {
+				loc = cached.loc;
+				locating->fallback = 1;
+				if (verbose) {
+					printf(_("Using cached location from"
+						 " `%s' until the provider"
+						 " responds.\n"),
+					       cached.source);
+				}
+			} else {
+				get_provisional_location(&loc);
+				if (verbose) {
+					fputs(_("Using provisional location"
+						" until the provider"
+						" responds.\n"), stdout);
+				}
 			}
+			if (verbose) print_location(&loc);
+		}
+	} else if (locating != NULL) {
+		r = location_task_wait(locating, &loc);
+		if (r < 0) {
+			displays_close(method, displays, display_count);
+			exit(EXIT_FAILURE);
 		}
 	}
 
-	config_ini_free(&config_state);
+	/* Settings sent to the method can be recorded for replay. */
+	record_t record_state;
+	record_t *record = NULL;
+	if (record_path != NULL && (mode == PROGRAM_MODE_CONTINUAL ||
+				    mode == PROGRAM_MODE_SIMULATE)) {
+		r = record_open(&record_state, record_path);
+		if (r < 0) {
+			displays_close(method, displays, display_count);
+			exit(EXIT_FAILURE);
+		}
+		record = &record_state;
+	}
 
 	switch (mode) {
 	case PROGRAM_MODE_ONE_SHOT:
@@ -1528,7 +2843,7 @@ main(int argc, char *argv[])
 		r = systemtime_get_time(&now);
 		if (r < 0) {
 			fputs(_("Unable to read system time.\n"), stderr);
-			method->free(&state);
+			displays_close(method, displays, display_count);
 			exit(EXIT_FAILURE);
 		}
 
@@ -1556,17 +2871,30 @@ main(int argc, char *argv[])
 			       interp.brightness);
 		}
 
+		if (jsonl != NULL) {
+			output_jsonl_period(jsonl,
+					    get_period(&scheme, elevation),
+					    get_transition_progress(&scheme,
+								    elevation));
+			output_jsonl_color(jsonl, &interp);
+		}
+
 		if (mode == PROGRAM_MODE_PRINT) {
+			if (jsonl != NULL) output_jsonl_free(jsonl);
 			exit(EXIT_SUCCESS);
 		}
 
 		/* Adjust temperature */
-		r = method->set_temperature(&state, &interp);
+		double start = trace_begin();
+		r = displays_set_temperature(method, displays, display_count,
+					     &interp, NULL);
 		if (r < 0) {
 			fputs(_("Temperature adjustment failed.\n"), stderr);
-			method->free(&state);
+			displays_close(method, displays, display_count);
 			exit(EXIT_FAILURE);
 		}
+		trace_end("adjust", start, "first set_temperature");
+		trace_end("startup", startup_time, "startup");
 
 		/* In Quartz (OSX) the gamma adjustments will automatically
 		   revert when the process exits. Therefore, we have to loop
@@ -1585,10 +2913,11 @@ main(int argc, char *argv[])
 		color_setting_t manual;
 		memcpy(&manual, &scheme.day, sizeof(color_setting_t));
 		manual.temperature = temp_set;
-		r = method->set_temperature(&state, &manual);
+		r = displays_set_temperature(method, displays, display_count,
+					     &manual, NULL);
 		if (r < 0) {
 			fputs(_("Temperature adjustment failed.\n"), stderr);
-			method->free(&state);
+			displays_close(method, displays, display_count);
 			exit(EXIT_FAILURE);
 		}
 
@@ -1601,14 +2930,40 @@ main(int argc, char *argv[])
 		}
 	}
 	break;
+	case PROGRAM_MODE_BENCH:
+	{
+		/* Replay a recording or apply generated settings. */
+		record_entry_t *entries = NULL;
+		int count = bench_count;
+		if (replay_path != NULL) {
+			r = record_load(replay_path, &entries, &count);
+		} else {
+			entries = bench_generate_settings(count);
+			r = entries != NULL ? 0 : -1;
+		}
+
+		if (r == 0) {
+			r = run_bench_method(method, displays, display_count,
+					     entries, count,
+					     replay_path != NULL ?
+					     replay_speed : 0.0, jsonl);
+		}
+		free(entries);
+		if (r < 0) {
+			displays_close(method, displays, display_count);
+			exit(EXIT_FAILURE);
+		}
+	}
+	break;
 	case PROGRAM_MODE_RESET:
 	{
 		/* Reset screen */
 		color_setting_t reset = { NEUTRAL_TEMP, { 1.0, 1.0, 1.0 }, 1.0 };
-		r = method->set_temperature(&state, &reset);
+		r = displays_set_temperature(method, displays, display_count,
+					     &reset, NULL);
 		if (r < 0) {
 			fputs(_("Temperature adjustment failed.\n"), stderr);
-			method->free(&state);
+			displays_close(method, displays, display_count);
 			exit(EXIT_FAILURE);
 		}
 
@@ -1621,18 +2976,148 @@ main(int argc, char *argv[])
 		}
 	}
 	break;
+	case PROGRAM_MODE_SIMULATE:
+	{
+		/* Counters are kept in memory for the report. */
+		metrics_t metrics;
+		r = metrics_init(&metrics, NULL, 0.0);
+		if (r < 0) {
+			displays_close(method, displays, display_count);
+			exit(EXIT_FAILURE);
+		}
+
+		simulation_start(&simulation);
+		r = run_continual_mode(&loc, &scheme,
+				       method, displays, display_count,
+				       transition, 0, NULL, NULL, NULL, NULL,
+				       NULL, &metrics, &simulation, record,
+				       NULL);
+		simulation_stop(&simulation);
+
+		if (r == 0) simulation_print(&simulation, &metrics, jsonl);
+		metrics_free(&metrics);
+		simulation_free(&simulation);
+		if (r < 0) exit(EXIT_FAILURE);
+	}
+	break;
 	case PROGRAM_MODE_CONTINUAL:
 	{
+		override_state_t override_state;
+		override_state_t *override = NULL;
+		if (override_path != NULL) {
+			r = override_init(&override_state, override_path,
+					  override_timeout);
+			if (r < 0) {
+				displays_close(method, displays,
+					       display_count);
+				exit(EXIT_FAILURE);
+			}
+			override = &override_state;
+		}
+
+		/* Apply changes to the config file while running. */
+		config_reload_t reload_state;
+		config_reload_t *reload = NULL;
+		r = config_reload_init(&reload_state, &config_state,
+				       &cli_scheme, method_args);
+		if (r == 0) reload = &reload_state;
+
+		/* Cache the hooks directory between period changes. */
+		hooks_state_t hooks;
+		r = hooks_init(&hooks);
+		if (r < 0) {
+			if (override != NULL) override_free(override);
+			if (reload != NULL) config_reload_free(reload);
+			displays_close(method, displays, display_count);
+			exit(EXIT_FAILURE);
+		}
+
+		if (!isnan(hook_timeout) && hook_timeout >= 0.0) {
+			hooks.timeout = hook_timeout;
+		}
+		if (hook_concurrency >= 0) {
+			hooks.concurrency = hook_concurrency;
+		}
+		if (!isnan(hook_plugin_interval) &&
+		    hook_plugin_interval >= 0.0) {
+			hooks.plugin_interval = hook_plugin_interval;
+		}
+
+		/* Metrics cost nothing unless a file is configured or
+		   they are needed for the idle benchmark. */
+		metrics_t metrics_state;
+		metrics_t *metrics = NULL;
+		if (metrics_path != NULL && metrics_path[0] != '\0') {
+			r = metrics_init(&metrics_state, metrics_path,
+					 metrics_interval);
+			if (r == 0) metrics = &metrics_state;
+		}
+
+		idle_bench_t idle_state;
+		idle_bench_t *idle = NULL;
+		if (idle_duration > 0.0) {
+			if (metrics == NULL) {
+				r = metrics_init(&metrics_state, NULL, 0.0);
+				if (r < 0) {
+					if (override != NULL) {
+						override_free(override);
+					}
+					if (reload != NULL) {
+						config_reload_free(reload);
+					}
+					hooks_free(&hooks);
+					displays_close(method, displays,
+						       display_count);
+					exit(EXIT_FAILURE);
+				}
+				metrics = &metrics_state;
+			}
+			idle_bench_init(&idle_state, idle_duration);
+			idle = &idle_state;
+		}
+
 		r = run_continual_mode(&loc, &scheme,
-				       method, &state,
-				       transition, verbose);
+				       method, displays, display_count,
+				       transition, verbose, jsonl,
+				       override, locating, reload, &hooks,
+				       metrics, NULL, record, idle);
+		if (r == 0 && idle != NULL) {
+			r = idle_bench_print(idle, method->name, jsonl);
+		}
+		if (override != NULL) override_free(override);
+		if (reload != NULL) config_reload_free(reload);
+		if (metrics != NULL) metrics_free(metrics);
+		hooks_free(&hooks);
 		if (r < 0) exit(EXIT_FAILURE);
 	}
 	break;
 	}
 
+	if (record != NULL) record_close(record);
+
+	if (display_stats) {
+		print_display_stats(displays, display_count, verbose, jsonl);
+	}
+
 	/* Clean up gamma adjustment state */
-	method->free(&state);
+	displays_close(method, displays, display_count);
+	free(displays);
+	displays_free(&display_list);
+
+	/* A provider that never responded may still be using the
+	   configuration. */
+	if (locating == NULL || location_task_free(locating) == 0) {
+		config_ini_free(&config_state);
+	}
+
+	if (jsonl != NULL) output_jsonl_free(jsonl);
+	free(override_path);
+	free(metrics_path);
+	free(record_path);
+	free(replay_path);
+
+	trace_write();
+	trace_free();
 
 	return EXIT_SUCCESS;
 }
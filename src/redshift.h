@@ -30,6 +30,12 @@ typedef struct {
 	float lon;
 } location_t;
 
+/* Bounds of locations. */
+#define MIN_LAT   -90.0
+#define MAX_LAT    90.0
+#define MIN_LON  -180.0
+#define MAX_LON   180.0
+
 /* Periods of day. */
 typedef enum {
 	PERIOD_NONE = 0,
@@ -45,6 +51,22 @@ typedef struct {
 	float brightness;
 } color_setting_t;
 
+/* Bounds of color settings. */
+#define MIN_TEMP   1000
+#define MAX_TEMP  25000
+#define MIN_BRIGHTNESS  0.1
+#define MAX_BRIGHTNESS  1.0
+#define MIN_GAMMA   0.1
+#define MAX_GAMMA  10.0
+
+
+/* Counters of the requests sent by a gamma adjustment method. */
+typedef struct {
+	/* Waits for a reply from the display server or kernel. */
+	unsigned long round_trips;
+	/* Size of the gamma requests including protocol headers. */
+	unsigned long bytes_sent;
+} gamma_method_stats_t;
 
 /* Gamma adjustment method */
 typedef int gamma_method_init_func(void *state);
@@ -56,6 +78,8 @@ typedef int gamma_method_set_option_func(void *state, const char *key,
 typedef void gamma_method_restore_func(void *state);
 typedef int gamma_method_set_temperature_func(void *state,
 					      const color_setting_t *setting);
+typedef void gamma_method_get_stats_func(void *state,
+					 gamma_method_stats_t *stats);
 
 typedef struct {
 	char *name;
@@ -79,6 +103,10 @@ typedef struct {
 	gamma_method_restore_func *restore;
 	/* Set a specific color temperature. */
 	gamma_method_set_temperature_func *set_temperature;
+
+	/* Get request counters, or NULL if the method does not keep
+	   them. */
+	gamma_method_get_stats_func *get_stats;
 } gamma_method_t;
 
 
@@ -90,6 +118,9 @@ typedef void location_provider_print_help_func(FILE *f);
 typedef int location_provider_set_option_func(void *state, const char *key,
 					      const char *value);
 typedef int location_provider_get_location_func(void *state, location_t *loc);
+typedef int location_provider_get_fd_func(void *state);
+typedef int location_provider_handle_func(void *state, location_t *loc,
+					  int *available);
 
 typedef struct {
 	char *name;
@@ -108,6 +139,13 @@ typedef struct {
 
 	/* Get current location. */
 	location_provider_get_location_func *get_location;
+
+	/* Providers that keep following the location after start set
+	   these, others leave them NULL. The file descriptor becomes
+	   readable when an update is ready; handle then returns the
+	   latest location without blocking. */
+	location_provider_get_fd_func *get_fd;
+	location_provider_handle_func *handle;
 } location_provider_t;
 
 
@@ -23,8 +23,11 @@
 #endif
 
 #include <stdio.h>
+#include <errno.h>
 #if defined(HAVE_SIGNAL_H) && !defined(__WIN32__)
 # include <signal.h>
+# include <unistd.h>
+# include <fcntl.h>
 #endif
 
 #include "signals.h"
@@ -34,6 +37,10 @@
 
 volatile sig_atomic_t exiting = 0;
 volatile sig_atomic_t disable = 0;
+volatile sig_atomic_t dump_metrics = 0;
+
+/* Self-pipe that becomes readable when a child process exits. */
+static int child_pipe[2] = { -1, -1 };
 
 
 /* Signal handler for exit signals */
@@ -50,10 +57,30 @@ sigdisable(int signo)
 	disable = 1;
 }
 
+/* Signal handler for metrics signal */
+static void
+sigmetrics(int signo)
+{
+	dump_metrics = 1;
+}
+
+/* Signal handler for CHLD signal */
+static void
+sigchild(int signo)
+{
+	int saved_errno = errno;
+	char c = 0;
+	if (write(child_pipe[1], &c, 1) < 0) {
+		/* Pipe is full so the main loop will wake up anyway. */
+	}
+	errno = saved_errno;
+}
+
 #else /* ! HAVE_SIGNAL_H || __WIN32__ */
 
 int disable = 0;
 int exiting = 0;
+int dump_metrics = 0;
 
 #endif /* ! HAVE_SIGNAL_H || __WIN32__ */
 
@@ -95,12 +122,36 @@ signals_install_handlers(void)
 		return -1;
 	}
 
-	/* Ignore CHLD signal. This causes child processes
-	   (hooks) to be reaped automatically. */
-	sigact.sa_handler = SIG_IGN;
+	/* Install signal handler for USR2 signal */
+	sigact.sa_handler = sigmetrics;
 	sigact.sa_mask = sigset;
 	sigact.sa_flags = 0;
 
+	r = sigaction(SIGUSR2, &sigact, NULL);
+	if (r < 0) {
+		perror("sigaction");
+		return -1;
+	}
+
+	/* Install signal handler for CHLD signal. Child processes
+	   (hooks) are reaped from the main loop when the self-pipe
+	   becomes readable. */
+	r = pipe(child_pipe);
+	if (r < 0) {
+		perror("pipe");
+		return -1;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		fcntl(child_pipe[i], F_SETFD, FD_CLOEXEC);
+		fcntl(child_pipe[i], F_SETFL,
+		      fcntl(child_pipe[i], F_GETFL) | O_NONBLOCK);
+	}
+
+	sigact.sa_handler = sigchild;
+	sigact.sa_mask = sigset;
+	sigact.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+
 	r = sigaction(SIGCHLD, &sigact, NULL);
 	if (r < 0) {
 		perror("sigaction");
@@ -110,3 +161,26 @@ signals_install_handlers(void)
 
 	return 0;
 }
+
+/* Return file descriptor that becomes readable when a child process
+   exits, or -1 if not available. */
+int
+signals_get_child_fd(void)
+{
+#if defined(HAVE_SIGNAL_H) && !defined(__WIN32__)
+	return child_pipe[0];
+#else
+	return -1;
+#endif
+}
+
+/* Drain pending notifications from the child process pipe. */
+void
+signals_clear_child(void)
+{
+#if defined(HAVE_SIGNAL_H) && !defined(__WIN32__)
+	char buf[64];
+	if (child_pipe[0] < 0) return;
+	while (read(child_pipe[0], buf, sizeof(buf)) > 0);
+#endif
+}
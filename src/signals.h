@@ -25,14 +25,18 @@
 
 extern volatile sig_atomic_t exiting;
 extern volatile sig_atomic_t disable;
+extern volatile sig_atomic_t dump_metrics;
 
 #else /* ! HAVE_SIGNAL_H || __WIN32__ */
 extern int exiting;
 extern int disable;
+extern int dump_metrics;
 #endif /* ! HAVE_SIGNAL_H || __WIN32__ */
 
 
 int signals_install_handlers(void);
+int signals_get_child_fd(void);
+void signals_clear_child(void);
 
 
 #endif /* REDSHIFT_SIGNALS_H */
@@ -0,0 +1,282 @@
+/* simulate.c -- Virtual clock simulation source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef ENABLE_NLS
+# include <libintl.h>
+# define _(s) gettext(s)
+#else
+# define _(s) s
+#endif
+
+#include "simulate.h"
+#include "systemtime.h"
+
+#define SECONDS_PER_DAY  86400.0
+
+
+static const char *period_names[] = {
+	"none",
+	"daytime",
+	"night",
+	"transition"
+};
+
+
+/* Parse a time given as a local date (YYYY-MM-DD) or as seconds since
+   the epoch. */
+static int
+parse_time(const char *s, double *t)
+{
+	int year, month, day, len = 0;
+	if (sscanf(s, "%d-%d-%d%n", &year, &month, &day, &len) == 3 &&
+	    s[len] == '\0') {
+		struct tm tm;
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_year = year - 1900;
+		tm.tm_mon = month - 1;
+		tm.tm_mday = day;
+		tm.tm_isdst = -1;
+		time_t time = mktime(&tm);
+		if (time == (time_t)-1) return -1;
+		*t = time;
+		return 0;
+	}
+
+	char *end;
+	*t = strtod(s, &end);
+	if (end == s || *end != '\0') return -1;
+	return 0;
+}
+
+static void
+get_local_time(double t, struct tm *tm)
+{
+	time_t time = (time_t)t;
+#ifndef _WIN32
+	localtime_r(&time, tm);
+#else
+	*tm = *localtime(&time);
+#endif
+}
+
+/* Parse START:END[:SPEED]. */
+int
+simulation_parse(simulation_t *sim, const char *spec)
+{
+	memset(sim, 0, sizeof(simulation_t));
+
+	char *s = strdup(spec);
+	if (s == NULL) {
+		perror("strdup");
+		return -1;
+	}
+
+	char *end = strchr(s, ':');
+	char *speed = NULL;
+	if (end != NULL) {
+		*(end++) = '\0';
+		speed = strchr(end, ':');
+		if (speed != NULL) *(speed++) = '\0';
+	}
+
+	int r = -1;
+	if (end == NULL ||
+	    parse_time(s, &sim->start) < 0 ||
+	    parse_time(end, &sim->end) < 0) {
+		fputs(_("Malformed simulation argument.\n"), stderr);
+	} else if (sim->end <= sim->start) {
+		fputs(_("End of simulation must be after the start.\n"),
+		      stderr);
+	} else if (speed != NULL &&
+		   (sim->speed = atof(speed)) < 0.0) {
+		fputs(_("Simulation speed must not be negative.\n"), stderr);
+	} else {
+		r = 0;
+	}
+
+	free(s);
+	return r;
+}
+
+void
+simulation_free(simulation_t *sim)
+{
+	free(sim->changes);
+	sim->changes = NULL;
+	sim->change_count = 0;
+	sim->change_size = 0;
+}
+
+/* Switch to the virtual clock at the start of the simulation. */
+void
+simulation_start(simulation_t *sim)
+{
+	if (systemtime_real_clock.get_monotonic_time(&sim->real_start) < 0) {
+		sim->real_start = 0.0;
+	}
+
+	systemtime_virtual_set(sim->start, sim->speed);
+	systemtime_set_clock(&systemtime_virtual_clock);
+}
+
+void
+simulation_stop(simulation_t *sim)
+{
+	systemtime_set_clock(&systemtime_real_clock);
+
+	if (systemtime_real_clock.get_monotonic_time(&sim->real_end) < 0) {
+		sim->real_end = sim->real_start;
+	}
+}
+
+int
+simulation_done(const simulation_t *sim, double now)
+{
+	return now >= sim->end;
+}
+
+/* Remember that PERIOD started at NOW. */
+void
+simulation_record_period(simulation_t *sim, double now, period_t period)
+{
+	if (sim->change_count == sim->change_size) {
+		int size = sim->change_size > 0 ? 2*sim->change_size : 256;
+		simulation_change_t *changes = realloc(
+			sim->changes, size * sizeof(simulation_change_t));
+		if (changes == NULL) {
+			perror("realloc");
+			return;
+		}
+		sim->changes = changes;
+		sim->change_size = size;
+	}
+
+	simulation_change_t *change = &sim->changes[sim->change_count++];
+	change->time = now;
+	change->period = period;
+}
+
+/* Print the period changes of one day, CHANGES[FIRST] up to
+   CHANGES[LAST - 1], with the time spent in transition that started on
+   that day. */
+static void
+print_day(const simulation_t *sim, int first, int last,
+	  output_jsonl_state_t *jsonl)
+{
+	char date[16];
+	struct tm tm;
+	get_local_time(sim->changes[first].time, &tm);
+	strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+
+	double transition = 0.0;
+	char list[384];
+	size_t len = 0;
+	list[0] = '\0';
+
+	for (int i = first; i < last; i++) {
+		const simulation_change_t *change = &sim->changes[i];
+		if (change->period == PERIOD_TRANSITION) {
+			double until = i + 1 < sim->change_count ?
+				sim->changes[i+1].time : sim->end;
+			transition += until - change->time;
+		}
+
+		get_local_time(change->time, &tm);
+		if (len >= sizeof(list)) continue;
+		if (jsonl != NULL) {
+			len += snprintf(&list[len], sizeof(list) - len,
+					"%s{\"time\":%.0f,\"period\":\"%s\"}",
+					i > first ? "," : "", change->time,
+					period_names[change->period]);
+		} else {
+			len += snprintf(&list[len], sizeof(list) - len,
+					"  %02d:%02d %s", tm.tm_hour,
+					tm.tm_min,
+					period_names[change->period]);
+		}
+	}
+	if (len >= sizeof(list)) len = sizeof(list) - 1;
+
+	if (jsonl != NULL) {
+		output_jsonl_event(jsonl, "simulation_day",
+				   ",\"date\":\"%s\",\"changes\":[%s],"
+				   "\"transition_seconds\":%.0f",
+				   date, list, transition);
+		output_jsonl_flush(jsonl);
+	} else {
+		printf("%s%s  (%.0f min)\n", date, list, transition / 60.0);
+	}
+}
+
+/* Report the totals of the simulation and the period changes of every
+   simulated day. */
+void
+simulation_print(const simulation_t *sim, const metrics_t *metrics,
+		 output_jsonl_state_t *jsonl)
+{
+	double days = (sim->end - sim->start) / SECONDS_PER_DAY;
+	double real = sim->real_end - sim->real_start;
+
+	if (jsonl != NULL) {
+		output_jsonl_event(jsonl, "simulation",
+				   ",\"start\":%.0f,\"end\":%.0f,"
+				   "\"seconds\":%.3f,\"ticks\":%lu,"
+				   "\"writes\":%lu,\"skipped_writes\":%lu,"
+				   "\"wakeups\":%lu",
+				   sim->start, sim->end, real,
+				   metrics->ticks, metrics->writes,
+				   metrics->skipped_writes,
+				   metrics->wakeups);
+		output_jsonl_flush(jsonl);
+	} else {
+		printf(_("Simulated %.1f days in %.2f s.\n"), days, real);
+		printf(_("Ticks: %lu\n"), metrics->ticks);
+		printf(_("Writes: %lu (%lu skipped)\n"), metrics->writes,
+		       metrics->skipped_writes);
+		printf(_("Wakeups: %lu (%.0f per day)\n"), metrics->wakeups,
+		       metrics->wakeups / days);
+		fputs(_("Period changes (local time, time in"
+			" transition):\n"), stdout);
+	}
+
+	/* Group the changes by local date. */
+	int first = 0;
+	while (first < sim->change_count) {
+		struct tm tm;
+		get_local_time(sim->changes[first].time, &tm);
+		int yday = tm.tm_yday;
+		int year = tm.tm_year;
+
+		int last = first + 1;
+		while (last < sim->change_count) {
+			get_local_time(sim->changes[last].time, &tm);
+			if (tm.tm_yday != yday || tm.tm_year != year) break;
+			last += 1;
+		}
+
+		print_day(sim, first, last, jsonl);
+		first = last;
+	}
+}
@@ -0,0 +1,62 @@
+/* simulate.h -- Virtual clock simulation header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_SIMULATE_H
+#define REDSHIFT_SIMULATE_H
+
+#include "redshift.h"
+#include "metrics.h"
+#include "output-jsonl.h"
+
+typedef struct {
+	double time;
+	period_t period;
+} simulation_change_t;
+
+typedef struct {
+	/* Simulated span (seconds since the epoch) and speed relative
+	   to real time, zero for as fast as possible. */
+	double start;
+	double end;
+	double speed;
+
+	/* Real time taken (monotonic). */
+	double real_start;
+	double real_end;
+
+	simulation_change_t *changes;
+	int change_count;
+	int change_size;
+} simulation_t;
+
+
+int simulation_parse(simulation_t *sim, const char *spec);
+void simulation_free(simulation_t *sim);
+
+void simulation_start(simulation_t *sim);
+void simulation_stop(simulation_t *sim);
+int simulation_done(const simulation_t *sim, double now);
+void simulation_record_period(simulation_t *sim, double now,
+			      period_t period);
+
+void simulation_print(const simulation_t *sim, const metrics_t *metrics,
+		      output_jsonl_state_t *jsonl);
+
+
+#endif /* ! REDSHIFT_SIMULATE_H */
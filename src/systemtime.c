@@ -34,9 +34,16 @@
 #include "systemtime.h"
 
 
+/* State of the virtual clock. */
+static double virtual_now = 0.0;
+static double virtual_speed = 0.0;
+
+static const systemtime_clock_t *clock_source = &systemtime_real_clock;
+
+
 /* Return current time in T as the number of seconds since the epoch. */
-int
-systemtime_get_time(double *t)
+static int
+real_get_time(double *t)
 {
 #if defined(_WIN32) /* Windows */
 	FILETIME now;
@@ -70,16 +77,156 @@ systemtime_get_time(double *t)
 	return 0;
 }
 
-/* Sleep for a number of milliseconds. */
-void
-systemtime_msleep(unsigned int msecs)
+/* Return time in T (seconds) from a clock that is not affected by
+   changes of the system time. Only differences are meaningful. */
+static int
+real_get_monotonic_time(double *t)
+{
+#if !defined(_WIN32) && _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+	struct timespec now;
+	int r = clock_gettime(CLOCK_MONOTONIC, &now);
+	if (r < 0) {
+		perror("clock_gettime");
+		return -1;
+	}
+
+	*t = now.tv_sec + (now.tv_nsec / 1000000000.0);
+	return 0;
+#else
+	return real_get_time(t);
+#endif
+}
+
+/* Return processor time consumed by this process in T (seconds). */
+int
+systemtime_get_cpu_time(double *t)
+{
+#if defined(_WIN32) /* Windows */
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit,
+			     &kernel, &user)) {
+		return -1;
+	}
+
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	*t = (k.QuadPart + u.QuadPart) / 10000000.0;
+#elif _POSIX_TIMERS > 0 && defined(CLOCK_PROCESS_CPUTIME_ID)
+	struct timespec now;
+	int r = clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	if (r < 0) {
+		perror("clock_gettime");
+		return -1;
+	}
+
+	*t = now.tv_sec + (now.tv_nsec / 1000000000.0);
+#else /* other platforms */
+	*t = clock() / (double)CLOCKS_PER_SEC;
+#endif
+
+	return 0;
+}
+
+static void
+real_sleep(double seconds)
 {
+	if (seconds <= 0.0) return;
 #ifndef _WIN32
 	struct timespec sleep;
-	sleep.tv_sec = msecs / 1000;
-	sleep.tv_nsec = (msecs % 1000)*1000000;
+	sleep.tv_sec = (time_t)seconds;
+	sleep.tv_nsec = (seconds - sleep.tv_sec) * 1000000000.0;
 	nanosleep(&sleep, NULL);
 #else
-	Sleep(msecs);
+	Sleep(seconds * 1000.0);
 #endif
 }
+
+const systemtime_clock_t systemtime_real_clock = {
+	"real",
+	real_get_time,
+	real_get_monotonic_time,
+	real_sleep,
+	0
+};
+
+static int
+virtual_get_time(double *t)
+{
+	*t = virtual_now;
+	return 0;
+}
+
+/* Virtual time passes only while sleeping. At a SPEED above zero the
+   sleep is also taken in real time, scaled down by SPEED. */
+static void
+virtual_sleep(double seconds)
+{
+	if (seconds <= 0.0) return;
+	if (virtual_speed > 0.0) real_sleep(seconds / virtual_speed);
+	virtual_now += seconds;
+}
+
+const systemtime_clock_t systemtime_virtual_clock = {
+	"virtual",
+	virtual_get_time,
+	virtual_get_time,
+	virtual_sleep,
+	1
+};
+
+/* Read time from CLOCK from now on. */
+void
+systemtime_set_clock(const systemtime_clock_t *clock)
+{
+	clock_source = clock;
+}
+
+/* Return non-zero if time only advances by sleeping. */
+int
+systemtime_is_simulated(void)
+{
+	return clock_source->simulated;
+}
+
+/* Set the virtual clock to START (seconds since the epoch) and let it
+   run SPEED times faster than real time, or as fast as possible if
+   SPEED is zero. */
+void
+systemtime_virtual_set(double start, double speed)
+{
+	virtual_now = start;
+	virtual_speed = speed;
+}
+
+/* Return current time in T as the number of seconds since the epoch,
+   read from the active clock. */
+int
+systemtime_get_time(double *t)
+{
+	return clock_source->get_time(t);
+}
+
+/* Return time in T (seconds) from a clock that is not affected by
+   changes of the system time. Only differences are meaningful. */
+int
+systemtime_get_monotonic_time(double *t)
+{
+	return clock_source->get_monotonic_time(t);
+}
+
+/* Sleep for a number of seconds. */
+void
+systemtime_sleep(double seconds)
+{
+	clock_source->sleep(seconds);
+}
+
+/* Sleep for a number of milliseconds. */
+void
+systemtime_msleep(unsigned int msecs)
+{
+	clock_source->sleep(msecs / 1000.0);
+}
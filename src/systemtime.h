@@ -21,7 +21,28 @@
 #define REDSHIFT_SYSTEMTIME_H
 
 
+/* Source of wall clock and monotonic time. SIMULATED is set for
+   clocks that only advance by sleeping. */
+typedef struct {
+	const char *name;
+	int (*get_time)(double *t);
+	int (*get_monotonic_time)(double *t);
+	void (*sleep)(double seconds);
+	int simulated;
+} systemtime_clock_t;
+
+extern const systemtime_clock_t systemtime_real_clock;
+extern const systemtime_clock_t systemtime_virtual_clock;
+
+
+void systemtime_set_clock(const systemtime_clock_t *clock);
+int systemtime_is_simulated(void);
+void systemtime_virtual_set(double start, double speed);
+
 int systemtime_get_time(double *now);
+int systemtime_get_monotonic_time(double *t);
+int systemtime_get_cpu_time(double *t);
+void systemtime_sleep(double seconds);
 void systemtime_msleep(unsigned int msecs);
 
 #endif /* ! REDSHIFT_SYSTEMTIME_H */
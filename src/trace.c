@@ -0,0 +1,243 @@
+/* trace.c -- Startup trace source
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#include "trace.h"
+#include "systemtime.h"
+
+/* Threads beyond this share the last track. */
+#define TRACE_MAX_THREADS  16
+
+typedef struct {
+	char name[TRACE_NAME_MAX];
+	const char *category;
+	double start;
+	double end;
+	int tid;
+} trace_event_t;
+
+/* The trace is global so phases can be recorded from anywhere,
+   including the location threads. Recording costs a single test of
+   PATH when tracing is off. */
+static char *path = NULL;
+static double origin = 0.0;
+static trace_event_t events[TRACE_MAX_EVENTS];
+static int event_count = 0;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t threads[TRACE_MAX_THREADS];
+static int thread_count = 0;
+#endif
+
+
+/* Start recording, writing the trace to FILENAME. Timestamps are
+   relative to ORIGIN (monotonic time). */
+int
+trace_init(const char *filename, double start)
+{
+	path = strdup(filename);
+	if (path == NULL) {
+		perror("strdup");
+		return -1;
+	}
+
+	origin = start;
+	event_count = 0;
+#ifdef HAVE_PTHREAD_H
+	threads[0] = pthread_self();
+	thread_count = 1;
+#endif
+
+	return 0;
+}
+
+void
+trace_free(void)
+{
+	free(path);
+	path = NULL;
+}
+
+/* Return the start time of a phase, NAN if not tracing. */
+double
+trace_begin(void)
+{
+	double now;
+	if (path == NULL || systemtime_get_monotonic_time(&now) < 0) {
+		return NAN;
+	}
+	return now;
+}
+
+/* Track of the calling thread. The thread that started tracing is
+   track zero. Must be called with the lock held. */
+static int
+trace_get_tid(void)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_t self = pthread_self();
+	for (int i = 0; i < thread_count; i++) {
+		if (pthread_equal(threads[i], self)) return i;
+	}
+	if (thread_count == TRACE_MAX_THREADS) return thread_count - 1;
+	threads[thread_count] = self;
+	return thread_count++;
+#else
+	return 0;
+#endif
+}
+
+static void
+trace_add(const char *category, double start, double end,
+	  const char *fmt, va_list ap)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&lock);
+#endif
+	if (event_count < TRACE_MAX_EVENTS) {
+		trace_event_t *event = &events[event_count++];
+		vsnprintf(event->name, sizeof(event->name), fmt, ap);
+		event->category = category;
+		event->start = start;
+		event->end = end;
+		event->tid = trace_get_tid();
+	}
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&lock);
+#endif
+}
+
+/* Record a phase from START (as returned by trace_begin) until now.
+   The name is formatted from FMT. */
+void
+trace_end(const char *category, double start, const char *fmt, ...)
+{
+	if (path == NULL || isnan(start)) return;
+
+	double now;
+	if (systemtime_get_monotonic_time(&now) < 0) return;
+
+	va_list ap;
+	va_start(ap, fmt);
+	trace_add(category, start, now, fmt, ap);
+	va_end(ap);
+}
+
+/* Record a phase between two monotonic timestamps. */
+void
+trace_span(const char *category, double start, double end,
+	   const char *fmt, ...)
+{
+	if (path == NULL || isnan(start) || isnan(end)) return;
+
+	va_list ap;
+	va_start(ap, fmt);
+	trace_add(category, start, end, fmt, ap);
+	va_end(ap);
+}
+
+static void
+print_json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(f, "\\%c", *s);
+		} else if ((unsigned char)*s < 0x20) {
+			fprintf(f, "\\u%04x", *s);
+		} else {
+			fputc(*s, f);
+		}
+	}
+	fputc('"', f);
+}
+
+/* Write the events recorded so far as Chrome trace event JSON, which
+   can be opened in Perfetto or chrome://tracing. The file is rewritten
+   on every call so phases that end late are added later. */
+int
+trace_write(void)
+{
+	if (path == NULL) return 0;
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&lock);
+#endif
+
+	long pid = (long)getpid();
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+		"\"tid\":0,\"args\":{\"name\":\"redshift\"}}", pid);
+	fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,"
+		"\"tid\":0,\"args\":{\"name\":\"main\"}}", pid);
+#ifdef HAVE_PTHREAD_H
+	for (int i = 1; i < thread_count; i++) {
+		fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+			"\"pid\":%ld,\"tid\":%d,"
+			"\"args\":{\"name\":\"background %d\"}}",
+			pid, i, i);
+	}
+#endif
+
+	for (int i = 0; i < event_count; i++) {
+		const trace_event_t *event = &events[i];
+		fputs(",\n{\"name\":", f);
+		print_json_string(f, event->name);
+		fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+			"\"dur\":%.3f,\"pid\":%ld,\"tid\":%d}",
+			event->category,
+			(event->start - origin) * 1000000.0,
+			(event->end - event->start) * 1000000.0,
+			pid, event->tid);
+	}
+
+	fputs("\n]}\n", f);
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_unlock(&lock);
+#endif
+
+	if (fclose(f) != 0) {
+		perror(path);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,41 @@
+/* trace.h -- Startup trace header
+   This file is part of Redshift.
+
+   Redshift is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Redshift is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Redshift.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright (c) 2016  Jon Lund Steffensen <jonlst@gmail.com>
+*/
+
+#ifndef REDSHIFT_TRACE_H
+#define REDSHIFT_TRACE_H
+
+#include <math.h>
+
+/* Events after this many are dropped. */
+#define TRACE_MAX_EVENTS  128
+#define TRACE_NAME_MAX  64
+
+
+int trace_init(const char *path, double origin);
+void trace_free(void);
+
+double trace_begin(void);
+void trace_end(const char *category, double start, const char *fmt, ...);
+void trace_span(const char *category, double start, double end,
+		const char *fmt, ...);
+
+int trace_write(void);
+
+
+#endif /* ! REDSHIFT_TRACE_H */